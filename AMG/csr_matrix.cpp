@@ -9,6 +9,9 @@
 #include <vector>
 #include <cuda_runtime.h>
 
+// Kernels
+extern "C" void vector_scale(Float*, const Float, const int, cudaStream_t);
+
 // Namespaces
 using namespace amg;
 
@@ -23,6 +26,8 @@ CSR_Matrix::CSR_Matrix()
     col = NULL;
     val = NULL;
 
+    element_operator = NULL;
+
     dtype = (typeid(Float) == typeid(double)) ? CUDA_R_64F : CUDA_R_32F;
 }
 
@@ -65,6 +70,7 @@ void CSR_Matrix::initialize(const char *mem_loc_, int num_rows_, int num_cols_,
     num_rows = num_rows_;
     num_cols = num_cols_;
     num_nnz  = num_nnz_;
+    stream   = stream_;
 
     if ((num_rows > 0) and (num_cols > 0) and (num_nnz > 0))
     {
@@ -83,8 +89,6 @@ void CSR_Matrix::initialize(const char *mem_loc_, int num_rows_, int num_cols_,
         }
         else
         {
-            stream = stream_;
-
             cudaMalloc((void**)(&ptr), (num_rows + 1) * sizeof(int));
             cudaMalloc((void**)(&col), num_nnz * sizeof(int));
             cudaMalloc((void**)(&val), num_nnz * sizeof(Float));
@@ -111,7 +115,14 @@ void CSR_Matrix::initialize(const char *mem_loc_, int num_rows_, int num_cols_,
  */
 void CSR_Matrix::matvec(Vector &y, const Vector &x, const Float alpha, const Float beta)
 {
-    if (strcmp(mem_loc, "host") == 0)
+    if (num_nnz <= 0)
+    {
+        if (strcmp(mem_loc, "host") == 0)
+            for (int row = 0; row < num_rows; row++) y.data[row] = (beta == 0.0) ? 0.0 : beta * y.data[row];
+        else
+            vector_scale(y.data, beta, num_rows, stream);
+    }
+    else if (strcmp(mem_loc, "host") == 0)
     {
         for (int row = 0; row < num_rows; row++)
         {
@@ -131,6 +142,8 @@ void CSR_Matrix::matvec(Vector &y, const Vector &x, const Float alpha, const Flo
         cusparseSpMV(cusparse_handle, CUSPARSE_OPERATION_NON_TRANSPOSE, &alpha, desc, x.desc, &beta, y.desc, dtype, CUSPARSE_CSRMV_ALG1, buffer_data);
 #endif
     }
+
+    if (element_operator != NULL) element_operator->apply(y, x, alpha);
 }
 
 /*
@@ -144,11 +157,14 @@ void CSR_Matrix::matvec(Vector &z, const Vector &x, const Vector &y, const Float
         {
             Float Ax = 0.0;
 
-            for (int idx = ptr[row]; idx < ptr[row + 1]; idx++)
-                Ax += val[idx] * x.data[col[idx]];
+            if (num_nnz > 0)
+                for (int idx = ptr[row]; idx < ptr[row + 1]; idx++)
+                    Ax += val[idx] * x.data[col[idx]];
 
             z.data[row] = alpha * Ax + beta * y.data[row];
         }
+
+        if (element_operator != NULL) element_operator->apply(z, x, alpha);
     }
     else
     {
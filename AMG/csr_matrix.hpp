@@ -7,6 +7,7 @@
 #include <cusparse.h>
 #include "AMG/config.hpp"
 #include "AMG/vector.hpp"
+#include "AMG/element_operator.hpp"
 
 // Class declaration
 #ifndef AMG_CSR_MATRIX_HPP
@@ -37,6 +38,9 @@ class CSR_Matrix
         size_t buffer_size;
         void *buffer_data;
 
+        // Matrix-free part added to the stored entries on every matvec (not owned)
+        Element_Operator *element_operator;
+
         // Constructors
         CSR_Matrix();
 
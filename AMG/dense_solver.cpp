@@ -0,0 +1,232 @@
+/*
+ * Dense_Solver source file
+ */
+
+// Class headers
+#include "dense_solver.hpp"
+
+// Headers
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+// Namespaces
+using namespace amg;
+
+// Constructors
+Dense_Solver::Dense_Solver()
+{
+    size = 0;
+    use_inverse = false;
+}
+
+// Destructor
+Dense_Solver::~Dense_Solver()
+{
+
+}
+
+// Functions
+/*
+ * Factorizes A = P L U with partial pivoting. Levels with at most 'inverse_cutoff' rows
+ * keep the explicit inverse instead, so the solve becomes a single matrix-vector product
+ */
+void Dense_Solver::initialize(const CSR_Matrix &A, int inverse_cutoff)
+{
+    if (strcmp(A.mem_loc, "host") != 0)
+    {
+        printf("Dense solver requires a matrix in 'host' memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    size = std::max(A.num_rows, 0);
+    use_inverse = (size <= inverse_cutoff);
+
+    LU.assign((size_t)(size) * size, 0.0);
+    pivot.resize(size);
+    null_pivot.assign(size, 0);
+    work.resize(size);
+
+    if (A.ptr != NULL)
+        for (int row = 0; row < size; row++)
+            for (int idx = A.ptr[row]; idx < A.ptr[row + 1]; idx++)
+                LU[(size_t)(row) * size + A.col[idx]] += A.val[idx];
+
+    // Pivots below round-off of the matrix norm are treated as singular
+    Float A_norm = 0.0;
+
+    for (int row = 0; row < size; row++)
+    {
+        Float row_sum = 0.0;
+        for (int j = 0; j < size; j++) row_sum += std::abs(LU[(size_t)(row) * size + j]);
+        A_norm = std::max(A_norm, row_sum);
+    }
+
+    Float pivot_tolerance = size * std::numeric_limits<Float>::epsilon() * A_norm;
+
+    // Factorization
+    for (int k = 0; k < size; k++)
+    {
+        int p = k;
+        Float p_max = std::abs(LU[(size_t)(k) * size + k]);
+
+        for (int i = k + 1; i < size; i++)
+        {
+            if (std::abs(LU[(size_t)(i) * size + k]) > p_max)
+            {
+                p = i;
+                p_max = std::abs(LU[(size_t)(i) * size + k]);
+            }
+        }
+
+        pivot[k] = p;
+
+        if (p != k)
+            std::swap_ranges(LU.begin() + (size_t)(k) * size, LU.begin() + (size_t)(k + 1) * size, LU.begin() + (size_t)(p) * size);
+
+        // Singular directions (e.g. floating coarse dofs) are decoupled and left out of the solution
+        if (p_max <= pivot_tolerance)
+        {
+            for (int i = k + 1; i < size; i++) LU[(size_t)(i) * size + k] = 0.0;
+            for (int j = k + 1; j < size; j++) LU[(size_t)(k) * size + j] = 0.0;
+
+            LU[(size_t)(k) * size + k] = 1.0;
+            null_pivot[k] = 1;
+            continue;
+        }
+
+        Float inv_pivot = 1.0 / LU[(size_t)(k) * size + k];
+
+        #pragma omp parallel for
+        for (int i = k + 1; i < size; i++)
+        {
+            Float l_ik = LU[(size_t)(i) * size + k] * inv_pivot;
+            LU[(size_t)(i) * size + k] = l_ik;
+
+            if (l_ik != 0.0)
+                for (int j = k + 1; j < size; j++)
+                    LU[(size_t)(i) * size + j] -= l_ik * LU[(size_t)(k) * size + j];
+        }
+    }
+
+    // Explicit inverse
+    if (use_inverse)
+    {
+        A_inv.assign((size_t)(size) * size, 0.0);
+
+        #pragma omp parallel
+        {
+            std::vector<Float> x(size);
+
+            #pragma omp for
+            for (int j = 0; j < size; j++)
+            {
+                std::fill(x.begin(), x.end(), 0.0);
+                x[j] = 1.0;
+
+                for (int k = 0; k < size; k++)
+                    if (pivot[k] != k) std::swap(x[k], x[pivot[k]]);
+
+                for (int i = 0; i < size; i++)
+                    for (int k = 0; k < i; k++)
+                        x[i] -= LU[(size_t)(i) * size + k] * x[k];
+
+                for (int i = size - 1; i >= 0; i--)
+                {
+                    for (int k = i + 1; k < size; k++)
+                        x[i] -= LU[(size_t)(i) * size + k] * x[k];
+
+                    x[i] = null_pivot[i] ? 0.0 : x[i] / LU[(size_t)(i) * size + i];
+                }
+
+                for (int i = 0; i < size; i++)
+                    A_inv[(size_t)(i) * size + j] = x[i];
+            }
+        }
+
+        std::vector<Float>().swap(LU);
+    }
+}
+
+/*
+ * Solves A u = f with both vectors in 'host' memory
+ */
+void Dense_Solver::solve(Vector &u, const Vector &f)
+{
+    if (use_inverse)
+    {
+        #pragma omp parallel for
+        for (int i = 0; i < size; i++)
+        {
+            Float A_inv_f = 0.0;
+
+            for (int j = 0; j < size; j++)
+                A_inv_f += A_inv[(size_t)(i) * size + j] * f.data[j];
+
+            u.data[i] = A_inv_f;
+        }
+    }
+    else
+    {
+        memcpy(work.data(), f.data, size * sizeof(Float));
+
+        for (int k = 0; k < size; k++)
+            if (pivot[k] != k) std::swap(work[k], work[pivot[k]]);
+
+        // Blocked substitutions: a serial solve of each diagonal block, then a threaded update of the remaining rows
+        const int block = 64;
+
+        for (int b_start = 0; b_start < size; b_start += block)
+        {
+            int b_end = std::min(b_start + block, size);
+
+            for (int i = b_start; i < b_end; i++)
+                for (int k = b_start; k < i; k++)
+                    work[i] -= LU[(size_t)(i) * size + k] * work[k];
+
+            #pragma omp parallel for
+            for (int i = b_end; i < size; i++)
+            {
+                Float x_i = work[i];
+
+                for (int k = b_start; k < b_end; k++)
+                    x_i -= LU[(size_t)(i) * size + k] * work[k];
+
+                work[i] = x_i;
+            }
+        }
+
+        for (int b_end = size; b_end > 0; b_end -= block)
+        {
+            int b_start = std::max(b_end - block, 0);
+
+            for (int i = b_end - 1; i >= b_start; i--)
+            {
+                Float x_i = work[i];
+
+                for (int k = i + 1; k < b_end; k++)
+                    x_i -= LU[(size_t)(i) * size + k] * work[k];
+
+                work[i] = null_pivot[i] ? 0.0 : x_i / LU[(size_t)(i) * size + i];
+            }
+
+            #pragma omp parallel for
+            for (int i = 0; i < b_start; i++)
+            {
+                Float x_i = work[i];
+
+                for (int k = b_start; k < b_end; k++)
+                    x_i -= LU[(size_t)(i) * size + k] * work[k];
+
+                work[i] = x_i;
+            }
+        }
+
+        memcpy(u.data, work.data(), size * sizeof(Float));
+    }
+}
+
+long long Dense_Solver::memory_usage()
+{
+    return (long long)((LU.capacity() + A_inv.capacity() + work.capacity()) * sizeof(Float) + pivot.capacity() * sizeof(int) + null_pivot.capacity());
+}
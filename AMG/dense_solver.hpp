@@ -0,0 +1,47 @@
+/*
+ * Dense_Solver header
+ */
+
+// Headers
+#include <vector>
+#include "AMG/config.hpp"
+#include "AMG/vector.hpp"
+#include "AMG/csr_matrix.hpp"
+
+// Class declaration
+#ifndef AMG_DENSE_SOLVER_HPP
+#define AMG_DENSE_SOLVER_HPP
+
+namespace amg
+{
+
+class Dense_Solver
+{
+    private:
+        // Member variables
+        std::vector<Float> LU;
+        std::vector<Float> A_inv;
+        std::vector<int> pivot;
+        std::vector<char> null_pivot;
+        std::vector<Float> work;
+
+    public:
+        // Member variables
+        int size;
+        bool use_inverse;
+
+        // Constructors
+        Dense_Solver();
+
+        // Destructor
+        ~Dense_Solver();
+
+        // Functions
+        void initialize(const CSR_Matrix&, int = 1024);
+        void solve(Vector&, const Vector&);
+        long long memory_usage();
+};
+
+}
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * Element_Operator source file
+ */
+
+// Class headers
+#include "element_operator.hpp"
+
+// Headers
+#include <cuda_runtime.h>
+
+// Kernels
+extern "C" void element_operator_apply(Float*, const Float*, const Float*, const int*, const int*, const int*, const int*, const int, const int, const Float, const int, cudaStream_t);
+
+// Namespaces
+using namespace amg;
+
+// Constructors
+Element_Operator::Element_Operator()
+{
+    num_rows = -1;
+    num_cells = -1;
+    num_points = -1;
+    num_simplices = -1;
+
+    cell_points = NULL;
+    simplices = NULL;
+    row_map = NULL;
+    col_map = NULL;
+    coords = NULL;
+}
+
+// Destructor
+Element_Operator::~Element_Operator()
+{
+    void *buffers[5] = { cell_points, simplices, row_map, col_map, coords };
+
+    for (auto buffer : buffers)
+    {
+        if (buffer != NULL)
+        {
+            if (strcmp(mem_loc, "host") == 0) free(buffer);
+            else cudaFree(buffer);
+        }
+    }
+
+    cell_points = NULL;
+    simplices = NULL;
+    row_map = NULL;
+    col_map = NULL;
+    coords = NULL;
+}
+
+// Functions
+void Element_Operator::initialize(const char *mem_loc_, int dim_, int num_rows_, int num_cells_, int num_points_, int num_simplices_, 
+                                  const int *cell_points_, const int *simplices_, const int *row_map_, const int *col_map_, const Float *coords_, cudaStream_t stream_)
+{
+    if (not ((strcmp(mem_loc_, "host") == 0) or (strcmp(mem_loc_, "device") == 0)))
+    {
+        printf("Memory location '%s' is not supported\n", mem_loc_);
+        exit(EXIT_FAILURE);
+    }
+
+    mem_loc = mem_loc_;
+    dim = dim_;
+    num_rows = num_rows_;
+    num_cells = num_cells_;
+    num_points = num_points_;
+    num_simplices = num_simplices_;
+    stream = stream_;
+
+    if (num_cells <= 0) return;
+
+    int num_corners = 1 << dim;
+    int num_verts = dim + 1;
+
+    size_t bytes_cells = (size_t)(num_cells) * num_corners * sizeof(int);
+    size_t bytes_simplices = (size_t)(num_simplices) * num_verts * sizeof(int);
+    size_t bytes_maps = (size_t)(num_points) * sizeof(int);
+    size_t bytes_coords = (size_t)(num_points) * dim * sizeof(Float);
+
+    if (strcmp(mem_loc, "host") == 0)
+    {
+        cell_points = (int*)(malloc(bytes_cells));
+        simplices = (int*)(malloc(bytes_simplices));
+        row_map = (int*)(malloc(bytes_maps));
+        col_map = (int*)(malloc(bytes_maps));
+        coords = (Float*)(malloc(bytes_coords));
+
+        memcpy(cell_points, cell_points_, bytes_cells);
+        memcpy(simplices, simplices_, bytes_simplices);
+        memcpy(row_map, row_map_, bytes_maps);
+        memcpy(col_map, col_map_, bytes_maps);
+        memcpy(coords, coords_, bytes_coords);
+    }
+    else
+    {
+        cudaMalloc((void**)(&cell_points), bytes_cells);
+        cudaMalloc((void**)(&simplices), bytes_simplices);
+        cudaMalloc((void**)(&row_map), bytes_maps);
+        cudaMalloc((void**)(&col_map), bytes_maps);
+        cudaMalloc((void**)(&coords), bytes_coords);
+
+        cudaMemcpyAsync(cell_points, cell_points_, bytes_cells, cudaMemcpyHostToDevice, stream);
+        cudaMemcpyAsync(simplices, simplices_, bytes_simplices, cudaMemcpyHostToDevice, stream);
+        cudaMemcpyAsync(row_map, row_map_, bytes_maps, cudaMemcpyHostToDevice, stream);
+        cudaMemcpyAsync(col_map, col_map_, bytes_maps, cudaMemcpyHostToDevice, stream);
+        cudaMemcpyAsync(coords, coords_, bytes_coords, cudaMemcpyHostToDevice, stream);
+
+        cudaStreamSynchronize(stream);
+    }
+}
+
+/*
+ * Accumulation of the form: y = y + alpha A x
+ */
+void Element_Operator::apply(Vector &y, const Vector &x, const Float alpha)
+{
+    if (num_cells <= 0) return;
+
+    if (strcmp(mem_loc, "host") == 0)
+    {
+        int num_corners = 1 << dim;
+        int num_verts = dim + 1;
+
+        for (int cell = 0; cell < num_cells; cell++)
+        {
+            for (int s = 0; s < num_simplices; s++)
+            {
+                int point[4];
+                Float X[4][3];
+                Float u[4];
+                Float Ku[4];
+
+                for (int a = 0; a < num_verts; a++)
+                {
+                    point[a] = cell_points[cell * num_corners + simplices[s * num_verts + a]];
+
+                    for (int m = 0; m < dim; m++) X[a][m] = coords[point[a] * dim + m];
+                    u[a] = (col_map[point[a]] >= 0) ? x.data[col_map[point[a]]] : 0.0;
+                }
+
+                simplex_stiffness(Ku, X, u, dim);
+
+                for (int a = 0; a < num_verts; a++)
+                    if (row_map[point[a]] >= 0)
+                        y.data[row_map[point[a]]] += alpha * scale * Ku[a];
+            }
+        }
+    }
+    else
+    {
+        element_operator_apply(y.data, x.data, coords, cell_points, simplices, row_map, col_map, num_simplices, dim, alpha * scale, num_cells, stream);
+    }
+}
+
+long long Element_Operator::memory_usage()
+{
+    if (num_cells <= 0) return 0;
+
+    return (long long)(num_cells) * (1 << dim) * sizeof(int) + (long long)(num_simplices) * (dim + 1) * sizeof(int) 
+         + (long long)(num_points) * (2 * sizeof(int) + dim * sizeof(Float));
+}
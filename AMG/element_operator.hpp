@@ -0,0 +1,119 @@
+/*
+ * Element_Operator header
+ */
+
+// Headers
+#include <cstring>
+#include "AMG/config.hpp"
+#include "AMG/vector.hpp"
+
+// Class declaration
+#ifndef AMG_ELEMENT_OPERATOR_HPP
+#define AMG_ELEMENT_OPERATOR_HPP
+
+#ifdef __CUDACC__
+#define AMG_HOST_DEVICE __host__ __device__
+#else
+#define AMG_HOST_DEVICE
+#endif
+
+namespace amg
+{
+
+/*
+ * Stiffness of a linear simplex (triangle or tetrahedron) applied to its vertex values: Ku = |T| D^T G D u
+ */
+inline AMG_HOST_DEVICE void simplex_stiffness(Float *Ku, const Float X[4][3], const Float *u, const int dim)
+{
+    if (dim == 2)
+    {
+        Float H[4] = { X[1][0] - X[0][0], X[2][0] - X[0][0], X[1][1] - X[0][1], X[2][1] - X[0][1] };
+        Float det = H[0] * H[3] - H[1] * H[2];
+        Float inv[4] = { H[3] / det, - H[1] / det, - H[2] / det, H[0] / det };
+        Float g[2] = { u[1] - u[0], u[2] - u[0] };
+        Float h[2];
+
+        for (int m = 0; m < 2; m++)
+        {
+            h[m] = 0.0;
+
+            for (int n = 0; n < 2; n++)
+                h[m] += 0.5 * det * (inv[m * 2 + 0] * inv[n * 2 + 0] + inv[m * 2 + 1] * inv[n * 2 + 1]) * g[n];
+        }
+
+        Ku[0] = - h[0] - h[1];
+        Ku[1] = h[0];
+        Ku[2] = h[1];
+    }
+    else
+    {
+        Float H[9];
+
+        for (int m = 0; m < 3; m++)
+            for (int n = 0; n < 3; n++)
+                H[m * 3 + n] = X[n][m] - X[3][m];
+
+        Float det = H[0] * (H[4] * H[8] - H[5] * H[7]) - H[1] * (H[3] * H[8] - H[5] * H[6]) + H[2] * (H[3] * H[7] - H[4] * H[6]);
+        Float inv[9] = { (H[4] * H[8] - H[7] * H[5]) / det, (H[2] * H[7] - H[8] * H[1]) / det, (H[1] * H[5] - H[4] * H[2]) / det,
+                         (H[5] * H[6] - H[8] * H[3]) / det, (H[0] * H[8] - H[6] * H[2]) / det, (H[2] * H[3] - H[5] * H[0]) / det,
+                         (H[3] * H[7] - H[6] * H[4]) / det, (H[1] * H[6] - H[7] * H[0]) / det, (H[0] * H[4] - H[3] * H[1]) / det };
+        Float g[3] = { u[0] - u[3], u[1] - u[3], u[2] - u[3] };
+        Float h[3];
+
+        for (int m = 0; m < 3; m++)
+        {
+            h[m] = 0.0;
+
+            for (int n = 0; n < 3; n++)
+                h[m] += (det / 6.0) * (inv[m * 3 + 0] * inv[n * 3 + 0] + inv[m * 3 + 1] * inv[n * 3 + 1] + inv[m * 3 + 2] * inv[n * 3 + 2]) * g[n];
+        }
+
+        Ku[0] = h[0];
+        Ku[1] = h[1];
+        Ku[2] = h[2];
+        Ku[3] = - h[0] - h[1] - h[2];
+    }
+}
+
+/*
+ * Matrix-free low-order FEM operator on the GLL sub-grid of conforming elements. Each cell (sub-quad or sub-hex) 
+ * is split into simplices whose stiffness is recomputed from the point coordinates on every application.
+ */
+class Element_Operator
+{
+    public:
+        // Member variables
+        const char* mem_loc;
+
+        int dim;
+        int num_rows;
+        int num_cells;
+        int num_points;
+        int num_simplices;
+
+        int *cell_points;
+        int *simplices;
+        int *row_map;
+        int *col_map;
+        Float *coords;
+
+        // Coefficient of the stiffness (h1 of a Helmholtz operator)
+        Float scale = 1.0;
+
+        cudaStream_t stream;
+
+        // Constructors
+        Element_Operator();
+
+        // Destructor
+        ~Element_Operator();
+
+        // Functions
+        void initialize(const char*, int, int, int, int, int, const int*, const int*, const int*, const int*, const Float*, cudaStream_t = NULL);
+        void apply(Vector&, const Vector&, const Float = 1.0);
+        long long memory_usage();
+};
+
+}
+
+#endif
@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "AMG/config.hpp"
+#include "AMG/element_operator.hpp"
 
 // Functions definition
 __global__ void vector_set_to_value_kernel(Float *data, const Float value, const int size)
@@ -92,3 +93,58 @@ extern "C" void vector_multiplication(Float *uv, const Float *u, const Float *v,
 
     vector_multiplication_kernel<<<num_blocks, BLOCK_SIZE, 0, stream>>>(uv, u, v, size);
 }
+
+__global__ void vector_scale_kernel(Float *data, const Float alpha, const int size)
+{
+    int idx = threadIdx.x + blockIdx.x * blockDim.x;
+
+    if (idx < size) data[idx] = (alpha == 0.0) ? 0.0 : alpha * data[idx];
+}
+
+extern "C" void vector_scale(Float *data, const Float alpha, const int size, cudaStream_t stream)
+{
+    int num_blocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    vector_scale_kernel<<<num_blocks, BLOCK_SIZE, 0, stream>>>(data, alpha, size);
+}
+
+// Matrix-free low-order operator (one thread per cell, rows shared between cells are accumulated atomically)
+__global__ void element_operator_apply_kernel(Float *y, const Float *x, const Float *coords, const int *cell_points, const int *simplices, const int *row_map, const int *col_map, const int num_simplices, const int dim, const Float alpha, const int num_cells)
+{
+    int cell = threadIdx.x + blockIdx.x * blockDim.x;
+
+    if (cell < num_cells)
+    {
+        int num_corners = 1 << dim;
+        int num_verts = dim + 1;
+
+        for (int s = 0; s < num_simplices; s++)
+        {
+            int point[4];
+            Float X[4][3];
+            Float u[4];
+            Float Ku[4];
+
+            for (int a = 0; a < num_verts; a++)
+            {
+                point[a] = cell_points[cell * num_corners + simplices[s * num_verts + a]];
+
+                for (int m = 0; m < dim; m++) X[a][m] = coords[point[a] * dim + m];
+                u[a] = (col_map[point[a]] >= 0) ? x[col_map[point[a]]] : 0.0;
+            }
+
+            amg::simplex_stiffness(Ku, X, u, dim);
+
+            for (int a = 0; a < num_verts; a++)
+                if (row_map[point[a]] >= 0)
+                    atomicAdd(&y[row_map[point[a]]], alpha * Ku[a]);
+        }
+    }
+}
+
+extern "C" void element_operator_apply(Float *y, const Float *x, const Float *coords, const int *cell_points, const int *simplices, const int *row_map, const int *col_map, const int num_simplices, const int dim, const Float alpha, const int num_cells, cudaStream_t stream)
+{
+    int num_blocks = (num_cells + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    element_operator_apply_kernel<<<num_blocks, BLOCK_SIZE, 0, stream>>>(y, x, coords, cell_points, simplices, row_map, col_map, num_simplices, dim, alpha, num_cells);
+}
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <unordered_map>
 #include <mpi.h>
+#include <omp.h>
 #include <occa.hpp>
 
 extern "C"
@@ -31,6 +32,7 @@ extern "C"
 
 #define rstdout(...) { if (proc_id == 0) { printf(__VA_ARGS__); fflush(stdout); } }
 
+// OCCA mode: 0 = Serial, 1 = CUDA, 2 = OpenMP (one thread per core of the rank, pinned)
 #ifndef OCCA_TYPE
 #define OCCA_TYPE 1
 #endif
@@ -41,8 +43,136 @@ extern "C"
 
 #define BINARY_INPUT true
 
+// Gather-scatter: 0 = gslib on MPI_COMM_WORLD, 1 = node-aware with intra-node reduction in shared memory
+#ifndef GATHER_SCATTER
+#define GATHER_SCATTER 0
+#endif
+
+// Coarse grid exchange: 0 = MPI_Allgatherv of all ranks, 1 = MPI_Neighbor_alltoallv of superdomain data only
+#ifndef COARSE_EXCHANGE
+#define COARSE_EXCHANGE 0
+#endif
+
+// Preconditioner communication (tree exchanges and stitching): 0 = DType words, 1 = float words, 2 = 16-bit mantissas with one exponent per message (summing exchanges use float)
+#ifndef PRECONDITIONER_WIRE
+#define PRECONDITIONER_WIRE 0
+#endif
+
 #define VISUALIZATION 0
 
+// Visualization output: 0 = Silo files written by the calling thread, 1 = written by a background thread from a host snapshot
+#ifndef ASYNC_OUTPUT
+#define ASYNC_OUTPUT 1
+#endif
+
+// Polynomial degree of the visualization output (0 = degree of the solution, otherwise interpolated down to it)
+#ifndef OUTPUT_DEGREE
+#define OUTPUT_DEGREE 0
+#endif
+
+// Mesh reordering: 0 = input order, 1 = Hilbert curve element order and RCM node numbering
+#ifndef REORDER_MESH
+#define REORDER_MESH 0
+#endif
+
+// Repartitioning: 0 = partition of the input files, 1 = weighted Hilbert curve partition with element migration
+#ifndef REPARTITION
+#define REPARTITION 0
+#endif
+
+// Kernel builds: 0 = rank 0 compiles into the OCCA cache first, 1 = cache already populated by 'poisson --prebuild'
+#ifndef KERNEL_CACHE_WARM
+#define KERNEL_CACHE_WARM 0
+#endif
+
+// Host memory: 0 = keep host mesh and setup data, 1 = release host copies after setup
+#ifndef LEAN_MODE
+#define LEAN_MODE 0
+#endif
+
+// Over-decomposition: subdomains per rank and threads solving them concurrently
+#ifndef SUBDOMAINS_PER_RANK
+#define SUBDOMAINS_PER_RANK 1
+#endif
+
+#ifndef SUBDOMAIN_THREADS
+#define SUBDOMAIN_THREADS SUBDOMAINS_PER_RANK
+#endif
+
+// Subdomain stiffness operator: 0 = one launch over all levels, 1 = one degree-specialized launch per level
+#ifndef LEVEL_KERNELS
+#define LEVEL_KERNELS 1
+#endif
+
+// Per level launches on their own CUDA streams (one subdomain per rank only, costs two host synchronizations per application)
+#ifndef LEVEL_STREAMS
+#define LEVEL_STREAMS 0
+#endif
+
+// Stored element matrices on subdomain levels up to this degree, kept only where they beat the matrix-free kernels at setup (0 = always matrix-free)
+#ifndef ELEMENT_MATRIX_DEGREE
+#define ELEMENT_MATRIX_DEGREE 0
+#endif
+
+// Subdomain tree restriction: 0 = three launches per level, 1 = one fused launch for all levels when the element fits in shared memory
+#ifndef FUSED_RESTRICTION
+#define FUSED_RESTRICTION 1
+#endif
+
+// Subdomain GMRES: 0 = Arnoldi with one reduction per projection, 1 = s-step basis orthogonalized with one Gram matrix per cycle
+#ifndef SUBDOMAIN_S_STEP
+#define SUBDOMAIN_S_STEP 0
+#endif
+
+// Domain GMRES: harmonic Ritz vectors kept across restarts (0 = plain restart)
+#ifndef GMRES_DEFLATION
+#define GMRES_DEFLATION 0
+#endif
+
+// Inner solve tolerance: 0 = fixed, 1 = loosened as the outer residual decreases (inexact Krylov bound)
+#ifndef INNER_TOLERANCE
+#define INNER_TOLERANCE 0
+#endif
+
+// Finest low-order FEM level: 0 = assembled CSR, 1 = conforming elements applied matrix-free (assembled only for the AMG setup)
+#ifndef MATRIX_FREE_FEM
+#define MATRIX_FREE_FEM 0
+#endif
+
+// Operator coefficients of (h1 A + h2 B) u: h2 = 0 is the Poisson operator
+#ifndef HELMHOLTZ_H1
+#define HELMHOLTZ_H1 1.0
+#endif
+
+#ifndef HELMHOLTZ_H2
+#define HELMHOLTZ_H2 0.0
+#endif
+
+// Keep the separate stiffness and mass parts of the subdomain operators for refresh_coefficients (only needed away from Poisson)
+#ifndef HELMHOLTZ_REFRESH
+#define HELMHOLTZ_REFRESH ((HELMHOLTZ_H1 != 1.0) || (HELMHOLTZ_H2 != 0.0))
+#endif
+
+// Default subdomain preconditioner: 0 = low-order FEM with AMG V-cycles, 1 = fast diagonalization Schwarz with the AMG coarse space (overridden from the command line)
+#ifndef SUBDOMAIN_PRECONDITIONER
+#define SUBDOMAIN_PRECONDITIONER 0
+#endif
+
+// Hardware counters on the timer regions through Linux perf_event (CPU backends): 0 = off, 1 = cycles, instructions, LLC misses and vector instructions
+#ifndef PERF_COUNTERS
+#define PERF_COUNTERS 0
+#endif
+
+// Raw perf event counted as vector instructions (model specific, e.g. 0x10c7 for 256-bit packed double FP_ARITH_INST_RETIRED on Intel; 0 = not counted)
+#ifndef PERF_VECTOR_EVENT
+#define PERF_VECTOR_EVENT 0
+#endif
+
+// Peak memory bandwidth of a rank in GB/s for the achieved fraction (0 = measured with a triad at startup)
+#ifndef PEAK_BANDWIDTH
+#define PEAK_BANDWIDTH 0
+#endif
+
 #ifndef GLOBALS_READY
 #define GLOBALS_READY
 int dim;
@@ -61,9 +191,35 @@ void quit()
     exit(EXIT_SUCCESS);
 }
 
+// Device allocation (in OpenMP mode pages are first touched by the threads that later work on them)
+template<typename T>
+occa::memory device_malloc(size_t num_values)
+{
+    occa::memory buffer = device.malloc<T>(num_values);
+
+#if OCCA_TYPE == 2
+    char *bytes = (char*)(buffer.ptr());
+    long long num_bytes = num_values * sizeof(T);
+
+    #pragma omp parallel for schedule(static)
+    for (long long b = 0; b < num_bytes; b++) bytes[b] = 0;
+#endif
+
+    return buffer;
+}
+
 #include "timer.hpp"
 Timer<double> timer;
 
+#include "memory.hpp"
+Memory<long long> memory;
+
+#include "memory_arena.hpp"
+Memory_Arena<long long> arena;
+
+#include "kernel_registry.hpp"
+Kernel_Registry<occa::kernel> kernel_registry;
+
 #else
 extern int dim;
 extern int proc_id;
@@ -75,6 +231,9 @@ extern char pstdout_name[80];
 extern FILE *pstdout_file;
 
 extern Timer<STYPE> timer;
+extern Memory<long long> memory;
+extern Memory_Arena<long long> arena;
+extern Kernel_Registry<occa::kernel> kernel_registry;
 
 void quit();
 
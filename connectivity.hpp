@@ -0,0 +1,31 @@
+/*
+ * Mesh connectivity header file
+ */
+
+// Headers
+#include <vector>
+#include <omp.h>
+
+// Class declaration
+#ifndef CONNECTIVITY_HPP
+#define CONNECTIVITY_HPP
+
+// Elements sharing each entity (vertex, edge or face) of every element, CSR over slots e * num_entities + entity
+struct Entity_Connectivity
+{
+    int num_entities = 0;
+    std::vector<int> ptr;
+    std::vector<int> neighbors;
+};
+
+template<typename IType, typename Compare>
+void parallel_sort(IType, IType, Compare);
+
+void entity_connectivity(Entity_Connectivity&, const std::vector<long long>&, int, int, const std::vector<std::vector<int>>&);
+
+template<typename DType>
+void dense_ranking(std::vector<DType>&, int);
+
+#include "connectivity.tpp"
+
+#endif
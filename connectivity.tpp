@@ -0,0 +1,154 @@
+/*
+ * Mesh connectivity template file
+ */
+
+// Headers
+#include <algorithm>
+#include <functional>
+#include <tuple>
+#include "connectivity.hpp"
+
+// Sort of independent chunks followed by rounds of pairwise merges
+template<typename IType, typename Compare>
+void parallel_sort(IType first, IType last, Compare compare)
+{
+    long long size = last - first;
+    int num_chunks = (int)(std::min((long long)(omp_get_max_threads()), std::max(size / 4096, 1LL)));
+
+    if (num_chunks <= 1)
+    {
+        std::sort(first, last, compare);
+        return;
+    }
+
+    std::vector<long long> bound(num_chunks + 1);
+    for (int c = 0; c <= num_chunks; c++) bound[c] = (size * c) / num_chunks;
+
+    #pragma omp parallel for schedule(static, 1)
+    for (int c = 0; c < num_chunks; c++)
+        std::sort(first + bound[c], first + bound[c + 1], compare);
+
+    for (int width = 1; width < num_chunks; width *= 2)
+    {
+        #pragma omp parallel for schedule(static, 1)
+        for (int c = 0; c < num_chunks - width; c += 2 * width)
+            std::inplace_merge(first + bound[c], first + bound[c + width], first + bound[std::min(c + 2 * width, num_chunks)], compare);
+    }
+}
+
+void entity_connectivity(Entity_Connectivity &conn, const std::vector<long long> &geometry_mesh, int num_elements, int num_vertices, const std::vector<std::vector<int>> &entity_vertices)
+{
+    struct Entity_Record
+    {
+        long long key[4];
+        int slot;
+    };
+
+    int num_entities = (int)(entity_vertices.size());
+    int num_slots = num_elements * num_entities;
+
+    conn.num_entities = num_entities;
+    conn.ptr.assign(num_slots + 1, 0);
+    conn.neighbors.clear();
+
+    if (num_slots == 0) return;
+
+    // One record per element entity, keyed by its sorted global vertex numbers
+    std::vector<Entity_Record> records(num_slots);
+
+    #pragma omp parallel for schedule(static)
+    for (int e = 0; e < num_elements; e++)
+    {
+        for (int id = 0; id < num_entities; id++)
+        {
+            auto &record = records[e * num_entities + id];
+            int size = (int)(entity_vertices[id].size());
+
+            for (int k = 0; k < 4; k++)
+                record.key[k] = (k < size) ? geometry_mesh[(long long)(e) * num_vertices + entity_vertices[id][k]] : -1;
+
+            std::sort(record.key, record.key + size);
+            record.slot = e * num_entities + id;
+        }
+    }
+
+    auto same_key = [](const Entity_Record &a, const Entity_Record &b)
+    {
+        return (a.key[0] == b.key[0]) and (a.key[1] == b.key[1]) and (a.key[2] == b.key[2]) and (a.key[3] == b.key[3]);
+    };
+
+    parallel_sort(records.begin(), records.end(), [](const Entity_Record &a, const Entity_Record &b)
+    {
+        return std::tie(a.key[0], a.key[1], a.key[2], a.key[3], a.slot) < std::tie(b.key[0], b.key[1], b.key[2], b.key[3], b.slot);
+    });
+
+    // Range of records sharing the entity of every record
+    std::vector<int> group_start(num_slots);
+    std::vector<int> group_end(num_slots);
+
+    for (int i = 0; i < num_slots; i++)
+        group_start[i] = ((i > 0) and same_key(records[i], records[i - 1])) ? group_start[i - 1] : i;
+
+    for (int i = num_slots - 1; i >= 0; i--)
+        group_end[i] = ((i < num_slots - 1) and same_key(records[i], records[i + 1])) ? group_end[i + 1] : i + 1;
+
+    // Other elements of the group (an element may touch an entity twice, so the list is deduplicated)
+    auto group_neighbors = [&](int i, std::vector<int> &list)
+    {
+        int e = records[i].slot / num_entities;
+        list.clear();
+
+        for (int j = group_start[i]; j < group_end[i]; j++)
+        {
+            int e_j = records[j].slot / num_entities;
+            if (e_j != e) list.push_back(e_j);
+        }
+
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    };
+
+    #pragma omp parallel
+    {
+        std::vector<int> list;
+
+        #pragma omp for schedule(static)
+        for (int i = 0; i < num_slots; i++)
+        {
+            group_neighbors(i, list);
+            conn.ptr[records[i].slot + 1] = (int)(list.size());
+        }
+    }
+
+    for (int s = 0; s < num_slots; s++) conn.ptr[s + 1] += conn.ptr[s];
+    conn.neighbors.resize(conn.ptr[num_slots]);
+
+    #pragma omp parallel
+    {
+        std::vector<int> list;
+
+        #pragma omp for schedule(static)
+        for (int i = 0; i < num_slots; i++)
+        {
+            group_neighbors(i, list);
+            std::copy(list.begin(), list.end(), conn.neighbors.begin() + conn.ptr[records[i].slot]);
+        }
+    }
+}
+
+// Replaces every value by the rank of its distinct value (zero keeps rank 0, otherwise ranks start at 1)
+template<typename DType>
+void dense_ranking(std::vector<DType> &data, int size)
+{
+    if (size == 0) return;
+
+    std::vector<DType> values(data.begin(), data.begin() + size);
+    parallel_sort(values.begin(), values.end(), std::less<DType>());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+
+    DType base = (values[0] == 0.0) ? 0.0 : 1.0;
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < size; i++)
+        data[i] = base + (DType)(std::lower_bound(values.begin(), values.end(), data[i]) - values.begin());
+}
@@ -5,6 +5,7 @@
 // Headers
 #include <tuple>
 #include <vector>
+#include <omp.h>
 #include <occa.hpp>
 #include "config.hpp"
 
@@ -38,21 +39,40 @@ class CSR_Matrix
         occa::memory col;
         occa::memory val;
 
+        // Host copy (kept only by matrices assembled with 'assemble_host')
+        std::vector<int> host_ptr;
+        std::vector<int> host_col;
+        std::vector<DType> host_val;
+
         // Constructor and destructor
         CSR_Matrix();
         CSR_Matrix(int, int);
         ~CSR_Matrix();
 
         // Functions
-        void initialize(int, int);
+        void initialize(int, int, bool = true);
         void add_entry(int, int, DType);
         void assemble();
+        void assemble_host();
+        void upload();
         void print(FILE* = NULL, int = 0);
         void multiply(occa::memory&, occa::memory&);
         void multiply_range(occa::memory&, occa::memory&, int, int);
         void multiply_weight(occa::memory&, occa::memory&, occa::memory&);
         void transpose(CSR_Matrix&);
         void diagonal(occa::memory);
+        long long memory_usage();
+
+        // Host products
+        template<typename VType>
+        void assign_host(int, int, const int*, const int*, const VType*);
+        void transpose_host(CSR_Matrix&);
+        void product_symbolic(CSR_Matrix&, const CSR_Matrix&);
+        void product_numeric(CSR_Matrix&, const CSR_Matrix&);
+        void product(CSR_Matrix&, const CSR_Matrix&);
+        void triple_product_symbolic(CSR_Matrix&, const CSR_Matrix&, const CSR_Matrix&);
+        void triple_product_numeric(CSR_Matrix&, const CSR_Matrix&, const CSR_Matrix&);
+        void triple_product(CSR_Matrix&, const CSR_Matrix&, const CSR_Matrix&);
 };
 
 #include "csr_matrix.tpp"
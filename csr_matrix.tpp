@@ -25,45 +25,32 @@ CSR_Matrix<DType>::~CSR_Matrix()
 }
 
 template<typename DType>
-void CSR_Matrix<DType>::initialize(int num_rows_, int num_cols_)
+void CSR_Matrix<DType>::initialize(int num_rows_, int num_cols_, bool build_kernels)
 {
     num_rows = num_rows_;
     num_cols = num_cols_;
     num_nnz = 0;
 
-    int proc_id; MPI_Comm_rank(MPI_COMM_WORLD, &proc_id);
-
-    occa::properties properties;
-
     if (typeid(DType) == typeid(double))
-        properties["defines/DType"] = "double";
+        sparse_tolerance = 1.0e-12;
     else
-        properties["defines/DType"] = "float";
-
-    if (proc_id == 0)
-    {
-        multiply_kernel = device.buildKernel("csr_matrix.okl", "multiply", properties);
-        multiply_range_kernel = device.buildKernel("csr_matrix.okl", "multiply_range", properties);
-        multiply_weight_kernel = device.buildKernel("csr_matrix.okl", "multiply_weight", properties);
-    }
+        sparse_tolerance = 1.0e-6;
 
-    MPI_Barrier(MPI_COMM_WORLD);
+    is_initialized = true;
 
-    if (proc_id > 0)
-    {
-        multiply_kernel = device.buildKernel("csr_matrix.okl", "multiply", properties);
-        multiply_range_kernel = device.buildKernel("csr_matrix.okl", "multiply_range", properties);
-        multiply_weight_kernel = device.buildKernel("csr_matrix.okl", "multiply_weight", properties);
-    }
+    // Host-only matrices (setup products) never run on the device
+    if (not build_kernels) return;
 
-    MPI_Barrier(MPI_COMM_WORLD);
+    occa::properties properties;
 
     if (typeid(DType) == typeid(double))
-        sparse_tolerance = 1.0e-12;
+        properties["defines/DType"] = "double";
     else
-        sparse_tolerance = 1.0e-6;
+        properties["defines/DType"] = "float";
 
-    is_initialized = true;
+    multiply_kernel = kernel_registry.get("csr_matrix.okl", "multiply", properties);
+    multiply_range_kernel = kernel_registry.get("csr_matrix.okl", "multiply_range", properties);
+    multiply_weight_kernel = kernel_registry.get("csr_matrix.okl", "multiply_weight", properties);
 }
 
 template<typename DType>
@@ -95,9 +82,28 @@ void CSR_Matrix<DType>::assemble()
 {
     if ((num_rows == 0) or (num_cols == 0) or (entries.size() == 0)) return;
 
+    assemble_host();
+    upload();
+
+    // Free memory
+    host_ptr.clear(); host_ptr.shrink_to_fit();
+    host_col.clear(); host_col.shrink_to_fit();
+    host_val.clear(); host_val.shrink_to_fit();
+}
+
+template<typename DType>
+void CSR_Matrix<DType>::assemble_host()
+{
     // Check if initialized
     initialization_check();
 
+    host_ptr.assign(num_rows + 1, 0);
+    host_col.clear();
+    host_val.clear();
+    num_nnz = 0;
+
+    if (entries.size() == 0) return;
+
     // Sort entries by row first and column second
     std::sort(entries.begin(), entries.end(), [](const std::tuple<int, int, DType> &a, const std::tuple<int, int, DType> &b)
     {
@@ -113,37 +119,12 @@ void CSR_Matrix<DType>::assemble()
                     return false;
     });
 
-    // Count how many non-zeros there are
+    // Assemble (repeated entries are added)
     std::tuple<int, int, DType> current = entries[0];
-    num_nnz = 1;
-
-    for (unsigned int i = 1; i < entries.size(); i++)
-    {
-        std::tuple<int, int, DType> &entry = entries[i];
-
-        if ((std::get<0>(entry) != std::get<0>(current)) or (std::get<1>(entry) != std::get<1>(current)))
-        {
-            current = entry;
-            num_nnz++;
-        }
-    }
 
-    // Allocate memory
-    ptr = device.malloc<int>(num_rows + 1);
-    col = device.malloc<int>(num_nnz);
-    val = device.malloc<DType>(num_nnz);
-
-    // Assemble
-    int count = 0;
-    int *ptr_hst = new int[num_rows + 1]();
-    int *col_hst = new int[num_nnz];
-    DType *val_hst = new DType[num_nnz];
-
-    current = entries[0];
-
-    ptr_hst[std::get<0>(current) + 1]++;
-    col_hst[count] = std::get<1>(current);
-    val_hst[count] = std::get<2>(current);
+    host_ptr[std::get<0>(current) + 1]++;
+    host_col.push_back(std::get<1>(current));
+    host_val.push_back(std::get<2>(current));
 
     for (unsigned int i = 1; i < entries.size(); i++)
     {
@@ -152,31 +133,36 @@ void CSR_Matrix<DType>::assemble()
         if ((std::get<0>(entry) != std::get<0>(current)) or (std::get<1>(entry) != std::get<1>(current)))
         {
             current = entry;
-            count++;
 
-            ptr_hst[std::get<0>(entry) + 1]++;
-            col_hst[count] = std::get<1>(entry);
-            val_hst[count] = std::get<2>(entry);
+            host_ptr[std::get<0>(entry) + 1]++;
+            host_col.push_back(std::get<1>(entry));
+            host_val.push_back(std::get<2>(entry));
         }
         else
         {
-            val_hst[count] += std::get<2>(entry);
+            host_val.back() += std::get<2>(entry);
         }
     }
 
     for (int i = 1; i <= num_rows; i++)
-        ptr_hst[i] += ptr_hst[i - 1];
+        host_ptr[i] += host_ptr[i - 1];
 
-    ptr.copyFrom(ptr_hst, (num_rows + 1) * sizeof(int));
-    col.copyFrom(col_hst, num_nnz * sizeof(int));
-    val.copyFrom(val_hst, num_nnz * sizeof(DType));
+    num_nnz = (int)(host_col.size());
 
     // Free memory
     entries.clear();
+}
 
-    delete[] ptr_hst;
-    delete[] col_hst;
-    delete[] val_hst;
+template<typename DType>
+void CSR_Matrix<DType>::upload()
+{
+    ptr = device_malloc<int>(num_rows + 1);
+    col = device_malloc<int>(num_nnz);
+    val = device_malloc<DType>(num_nnz);
+
+    ptr.copyFrom(host_ptr.data(), (num_rows + 1) * sizeof(int));
+    col.copyFrom(host_col.data(), num_nnz * sizeof(int));
+    val.copyFrom(host_val.data(), num_nnz * sizeof(DType));
 }
 
 template<typename DType>
@@ -339,3 +325,238 @@ void CSR_Matrix<DType>::multiply_weight(occa::memory &Au, occa::memory &u, occa:
     // Multiply
     multiply_weight_kernel(Au, ptr, col, val, u, weight, num_rows);
 }
+
+template<typename DType>
+long long CSR_Matrix<DType>::memory_usage()
+{
+    return (long long)(ptr.size() + col.size() + val.size());
+}
+
+// Host products (the symbolic phase builds the pattern and the numeric phase only the values, so a pattern is reused when values change)
+template<typename DType>
+template<typename VType>
+void CSR_Matrix<DType>::assign_host(int num_rows_, int num_cols_, const int *ptr_, const int *col_, const VType *val_)
+{
+    initialize(num_rows_, num_cols_, false);
+
+    num_nnz = ptr_[num_rows];
+    host_ptr.assign(ptr_, ptr_ + num_rows + 1);
+    host_col.assign(col_, col_ + num_nnz);
+    host_val.assign(val_, val_ + num_nnz);
+}
+
+template<typename DType>
+void CSR_Matrix<DType>::transpose_host(CSR_Matrix &At)
+{
+    At.initialize(num_cols, num_rows, false);
+    At.num_nnz = num_nnz;
+    At.host_ptr.assign(num_cols + 1, 0);
+    At.host_col.resize(num_nnz);
+    At.host_val.resize(num_nnz);
+
+    for (int p = 0; p < num_nnz; p++) At.host_ptr[host_col[p] + 1]++;
+    for (int j = 1; j <= num_cols; j++) At.host_ptr[j] += At.host_ptr[j - 1];
+
+    std::vector<int> position(At.host_ptr.begin(), At.host_ptr.end() - 1);
+
+    for (int i = 0; i < num_rows; i++)
+    {
+        for (int p = host_ptr[i]; p < host_ptr[i + 1]; p++)
+        {
+            int q = position[host_col[p]]++;
+            At.host_col[q] = i;
+            At.host_val[q] = host_val[p];
+        }
+    }
+}
+
+template<typename DType>
+void CSR_Matrix<DType>::product_symbolic(CSR_Matrix &C, const CSR_Matrix &B)
+{
+    C.initialize(num_rows, B.num_cols, false);
+    C.host_ptr.assign(num_rows + 1, 0);
+
+    // Columns of a row of C are the columns of the rows of B it references (one dense marker per thread)
+    auto row_pattern = [&](int i, std::vector<int> &marker, int *cols)
+    {
+        int count = 0;
+
+        for (int p = host_ptr[i]; p < host_ptr[i + 1]; p++)
+        {
+            for (int q = B.host_ptr[host_col[p]]; q < B.host_ptr[host_col[p] + 1]; q++)
+            {
+                int j = B.host_col[q];
+
+                if (marker[j] != i)
+                {
+                    marker[j] = i;
+                    if (cols != NULL) cols[count] = j;
+                    count++;
+                }
+            }
+        }
+
+        return count;
+    };
+
+    #pragma omp parallel
+    {
+        std::vector<int> marker(B.num_cols, - 1);
+
+        #pragma omp for schedule(dynamic, 256)
+        for (int i = 0; i < num_rows; i++)
+            C.host_ptr[i + 1] = row_pattern(i, marker, NULL);
+    }
+
+    for (int i = 1; i <= num_rows; i++) C.host_ptr[i] += C.host_ptr[i - 1];
+
+    C.num_nnz = C.host_ptr[num_rows];
+    C.host_col.resize(C.num_nnz);
+    C.host_val.assign(C.num_nnz, 0.0);
+
+    #pragma omp parallel
+    {
+        std::vector<int> marker(B.num_cols, - 1);
+
+        #pragma omp for schedule(dynamic, 256)
+        for (int i = 0; i < num_rows; i++)
+        {
+            row_pattern(i, marker, C.host_col.data() + C.host_ptr[i]);
+            std::sort(C.host_col.begin() + C.host_ptr[i], C.host_col.begin() + C.host_ptr[i + 1]);
+        }
+    }
+}
+
+template<typename DType>
+void CSR_Matrix<DType>::product_numeric(CSR_Matrix &C, const CSR_Matrix &B)
+{
+    #pragma omp parallel
+    {
+        std::vector<DType> accumulator(B.num_cols, 0.0);
+
+        #pragma omp for schedule(dynamic, 256)
+        for (int i = 0; i < num_rows; i++)
+        {
+            for (int p = host_ptr[i]; p < host_ptr[i + 1]; p++)
+                for (int q = B.host_ptr[host_col[p]]; q < B.host_ptr[host_col[p] + 1]; q++)
+                    accumulator[B.host_col[q]] += host_val[p] * B.host_val[q];
+
+            for (int c = C.host_ptr[i]; c < C.host_ptr[i + 1]; c++)
+            {
+                C.host_val[c] = accumulator[C.host_col[c]];
+                accumulator[C.host_col[c]] = 0.0;
+            }
+        }
+    }
+}
+
+template<typename DType>
+void CSR_Matrix<DType>::product(CSR_Matrix &C, const CSR_Matrix &B)
+{
+    product_symbolic(C, B);
+    product_numeric(C, B);
+}
+
+template<typename DType>
+void CSR_Matrix<DType>::triple_product_symbolic(CSR_Matrix &PtAP, const CSR_Matrix &P, const CSR_Matrix &Pt)
+{
+    PtAP.initialize(Pt.num_rows, P.num_cols, false);
+    PtAP.host_ptr.assign(Pt.num_rows + 1, 0);
+
+    // Row I of Pt A P without forming A P or Pt A
+    auto row_pattern = [&](int I, std::vector<int> &marker, int *cols)
+    {
+        int count = 0;
+
+        for (int p = Pt.host_ptr[I]; p < Pt.host_ptr[I + 1]; p++)
+        {
+            int i = Pt.host_col[p];
+
+            for (int q = host_ptr[i]; q < host_ptr[i + 1]; q++)
+            {
+                int k = host_col[q];
+
+                for (int r = P.host_ptr[k]; r < P.host_ptr[k + 1]; r++)
+                {
+                    int J = P.host_col[r];
+
+                    if (marker[J] != I)
+                    {
+                        marker[J] = I;
+                        if (cols != NULL) cols[count] = J;
+                        count++;
+                    }
+                }
+            }
+        }
+
+        return count;
+    };
+
+    #pragma omp parallel
+    {
+        std::vector<int> marker(P.num_cols, - 1);
+
+        #pragma omp for schedule(dynamic, 64)
+        for (int I = 0; I < Pt.num_rows; I++)
+            PtAP.host_ptr[I + 1] = row_pattern(I, marker, NULL);
+    }
+
+    for (int I = 1; I <= Pt.num_rows; I++) PtAP.host_ptr[I] += PtAP.host_ptr[I - 1];
+
+    PtAP.num_nnz = PtAP.host_ptr[Pt.num_rows];
+    PtAP.host_col.resize(PtAP.num_nnz);
+    PtAP.host_val.assign(PtAP.num_nnz, 0.0);
+
+    #pragma omp parallel
+    {
+        std::vector<int> marker(P.num_cols, - 1);
+
+        #pragma omp for schedule(dynamic, 64)
+        for (int I = 0; I < Pt.num_rows; I++)
+        {
+            row_pattern(I, marker, PtAP.host_col.data() + PtAP.host_ptr[I]);
+            std::sort(PtAP.host_col.begin() + PtAP.host_ptr[I], PtAP.host_col.begin() + PtAP.host_ptr[I + 1]);
+        }
+    }
+}
+
+template<typename DType>
+void CSR_Matrix<DType>::triple_product_numeric(CSR_Matrix &PtAP, const CSR_Matrix &P, const CSR_Matrix &Pt)
+{
+    #pragma omp parallel
+    {
+        std::vector<DType> accumulator(P.num_cols, 0.0);
+
+        #pragma omp for schedule(dynamic, 64)
+        for (int I = 0; I < Pt.num_rows; I++)
+        {
+            for (int p = Pt.host_ptr[I]; p < Pt.host_ptr[I + 1]; p++)
+            {
+                int i = Pt.host_col[p];
+
+                for (int q = host_ptr[i]; q < host_ptr[i + 1]; q++)
+                {
+                    DType PtA_iq = Pt.host_val[p] * host_val[q];
+                    int k = host_col[q];
+
+                    for (int r = P.host_ptr[k]; r < P.host_ptr[k + 1]; r++)
+                        accumulator[P.host_col[r]] += PtA_iq * P.host_val[r];
+                }
+            }
+
+            for (int c = PtAP.host_ptr[I]; c < PtAP.host_ptr[I + 1]; c++)
+            {
+                PtAP.host_val[c] = accumulator[PtAP.host_col[c]];
+                accumulator[PtAP.host_col[c]] = 0.0;
+            }
+        }
+    }
+}
+
+template<typename DType>
+void CSR_Matrix<DType>::triple_product(CSR_Matrix &PtAP, const CSR_Matrix &P, const CSR_Matrix &Pt)
+{
+    triple_product_symbolic(PtAP, P, Pt);
+    triple_product_numeric(PtAP, P, Pt);
+}
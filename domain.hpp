@@ -5,24 +5,13 @@
 // Headers
 #include "config.hpp"
 
-extern "C"
-{
-    #define PREFIX gslib_
-    #define MPI
-    #define GLOBAL_LONG_LONG
-    #include "name.h"
-    #include "fail.h"
-    #include "c99.h"
-    #include "types.h"
-    #include "comm.h"
-    #include "gs_defs.h"
-    #include "mem.h"
-    #include "gs.h"
-}
-
 #include "element.hpp"
+#include "gather_scatter.hpp"
+#include "partition.hpp"
 #include "csr_matrix.hpp"
 #include "math.hpp"
+#include "multivector.hpp"
+#include "silo_writer.hpp"
 #include "special_functions.hpp"
 #include "timer.hpp"
 
@@ -47,11 +36,15 @@ class Domain
         CSR_Matrix<DType> Qt;
         occa::memory assembled_weight;
 
+        // Partition (the cost model follows the subdomain hierarchy built on top of this domain)
+        int poly_reduction = 1;
+        int subdomain_overlap = 1;
+        int superdomain_overlap = 1;
+        double element_cost(const Element<DType>&, const int*);
+
         // Gather scatter
         int num_bdary_nodes;
-        struct comm gs_comm;
-        struct gs_data *gs_handle;
-        gs_dom gs_type = (typeid(DType) == typeid(double)) ? gs_double : gs_float;
+        Gather_Scatter<DType> gather_scatter;
 
         // Solver
         occa::memory u_k;
@@ -61,8 +54,9 @@ class Domain
         occa::memory z_k;
         occa::memory p_k;
 
-        std::vector<occa::memory> V;
-        std::vector<occa::memory> Z;
+        Multivector<DType> V;
+        Multivector<DType> Z;
+        std::vector<DType> basis_coefs;
         std::vector<std::vector<DType>> H;
         std::vector<DType> c_gmres;
         std::vector<DType> s_gmres;
@@ -74,13 +68,28 @@ class Domain
         void inner_product_flexible(DType&, occa::memory&, occa::memory&, occa::memory&);
         void residual_and_search_update(occa::memory&, occa::memory&, occa::memory&, occa::memory&, DType);
         void assembled_inner_product(DType&, occa::memory&, occa::memory&);
+        void assembled_inner_products(DType*, occa::memory&, Multivector<DType>&, int);
+
+        // Deflated restarting (unrotated Hessenberg matrix and right-hand side of the current cycle)
+        std::vector<occa::memory> W_deflation;
+        std::vector<std::vector<double>> H_raw;
+        std::vector<double> gamma_raw;
+
+        int deflated_restart(int);
+
+        // Inexact preconditioning
+        template<typename PType>
+        void inner_tolerance(PType&, DType, DType, DType, bool);
 
         // Utility functions
         Math<DType> math;
+        Silo_Writer<DType> silo_writer;
 
         // Kernels
         occa::kernel stiffness_matrix_1_kernel;
         occa::kernel stiffness_matrix_2_kernel;
+        occa::kernel stiffness_matrix_1_element_kernel;
+        occa::kernel stiffness_matrix_2_element_kernel;
         occa::kernel initialize_arrays_kernel;
         occa::kernel residual_norm_kernel;
         occa::kernel projection_inner_products_kernel;
@@ -92,7 +101,7 @@ class Domain
     public:
         // Member variables
         char *directory;
-        int poly_degree;
+        int poly_degree = 0;
         const char *data_type = (typeid(DType) == typeid(double)) ? "double" : "float";
 
         int num_total_elements;
@@ -105,33 +114,43 @@ class Domain
 
         int num_elem_points;
 
-        // Elements
+        // Elements (curve_order[e] is the local input index of element e)
         std::vector<Element<DType>> elements;
+        std::vector<int> curve_order;
+        Migration_Plan migration;
 
         // Solver
         int num_blocks;
         int num_iterations = 0;
         int num_vectors = 20;
+        int num_deflation = GMRES_DEFLATION;
         int max_iterations = 500;
         int preconditioner_type = 1;
         bool use_preconditioner = true;
         DType tolerance = (typeid(DType) == typeid(double)) ? 1.0e-07 : 1.0e-04;
+        DType inner_tolerance_max = 0.5;
 
         // Operator
         occa::memory D_hat;
         occa::memory geom_fact[NUM_GEOM_FACTS];
         occa::memory geom_fact_ptr;
+        occa::memory mass_fact;
+
+        // Helmholtz coefficients of (h1 A + h2 B) u (h2 = 0 is the Poisson operator)
+        DType h1 = 1.0;
+        DType h2 = 0.0;
 
         // Constructor and destructor
         Domain();
         Domain(char*, int);
         ~Domain();
 
-        void initialize(char*, int);
+        void initialize(char*, int, Domain<DType>* = NULL);
+        void build_kernels();
 
         // Member functions
         void initial_function(occa::memory&, int = 0);
-        void direct_stiffness_summation(occa::memory&, occa::memory&, bool = true, bool = false);
+        void direct_stiffness_summation(occa::memory&, occa::memory&, bool = true, bool = false, bool = false);
         void stiffness_matrix(occa::memory&, occa::memory&, bool = false);
 
         template<typename PType>
@@ -140,6 +159,10 @@ class Domain
         template<typename PType>
         void generalized_minimum_residual(occa::memory&, occa::memory&, PType&, bool = true);
 
+        // Memory
+        void memory_usage();
+        void release_host_data(bool = false);
+
         // Visit output
         void output(std::string, int = 0, ...);
 };
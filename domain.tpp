@@ -3,10 +3,12 @@
  */
 
 // Headers
+#include <cmath>
 #include <cstdarg>
 #include <cstring>
-#include <silo.h>
 #include <unordered_map>
+#include "reordering.hpp"
+#include "partition.hpp"
 
 // Constructor and destructor
 template<typename DType>
@@ -28,7 +30,7 @@ Domain<DType>::~Domain()
 }
 
 template<typename DType>
-void Domain<DType>::initialize(char *directory_, int poly_degree_)
+void Domain<DType>::initialize(char *directory_, int poly_degree_, Domain<DType> *reference)
 {
     // Arguments
     directory = directory_;
@@ -53,19 +55,6 @@ void Domain<DType>::initialize(char *directory_, int poly_degree_)
     num_local_points = num_local_elements * num_elem_points;
     num_total_points = num_total_elements * num_elem_points;
 
-    // Initialize work arrays
-    int num_work_hst = dim;
-    work_hst.resize(num_work_hst);
-    for (int w = 0; w < num_work_hst; w++) work_hst[w].resize(num_local_points);
-
-    int num_work_dev = dim;
-    work_dev.resize(num_work_dev);
-    for (int w = 0; w < num_work_dev; w++) work_dev[w] = device.malloc<DType>(num_local_points);
-
-    for (int w = 0; w < num_work_dev; w++) ((DType**)(work_hst[0].data()))[w] = (DType*)(work_dev[w].ptr());
-    work_dev_ptr = device.malloc<DType*>(num_work_dev);
-    work_dev_ptr.copyFrom(work_hst[0].data(), num_work_dev * sizeof(DType*));
-
     // Initialize elements
     elements.reserve(num_local_elements);
 
@@ -155,10 +144,6 @@ void Domain<DType>::initialize(char *directory_, int poly_degree_)
 
     fclose(file_ptr);
 
-    for (auto &elem : elements)
-        for (int v = 0; v < elem.num_points; v++)
-            elem.loc_num[v] = elem.offset + v;
-
     // Node degree
     std::vector<int> node_degree(num_local_points);
     sprintf(file_name, "%s/lx1_%d/node_degree_%d.%d.dat", directory, poly_degree + 1, proc_id, poly_degree);
@@ -189,10 +174,6 @@ void Domain<DType>::initialize(char *directory_, int poly_degree_)
 
     fclose(file_ptr);
 
-    for (auto &elem : elements) memcpy(work_hst[0].data() + elem.offset, elem.dirichlet_mask.data(), elem.num_points * sizeof(DType));
-    dirichlet_mask = device.malloc<DType>(num_local_points);
-    dirichlet_mask.copyFrom(work_hst[0].data(), num_local_points * sizeof(DType));
-
     // Geometric factors
     for (int g = 0; g < NUM_GEOM_FACTS; g++)
     {
@@ -212,15 +193,88 @@ void Domain<DType>::initialize(char *directory_, int poly_degree_)
         }
 
         fclose(file_ptr);
+    }
+
+#if REPARTITION == 1
+    // Cost-balanced partition computed on the finest level and followed by the coarser ones
+    if (reference == NULL)
+    {
+        std::vector<double> weight(num_local_elements);
+        for (auto &elem : elements) weight[elem.id] = element_cost(elem, node_degree.data() + elem.offset);
+
+        weighted_curve_partition(migration, elements, weight, dim);
+    }
+    else
+    {
+        migration = reference->migration;
+    }
+
+    migrate_elements(elements, node_degree, migration, dim, poly_degree);
+
+    num_local_elements = elements.size();
+    num_local_points = num_local_elements * num_elem_points;
+#elif REORDER_MESH == 1
+    // Hilbert order computed on the finest level and followed by the coarser ones, so element ids match across levels
+    if (reference == NULL)
+        space_filling_curve_order(curve_order, elements, dim);
+    else
+        curve_order = reference->curve_order;
+
+    permute_elements(elements, node_degree, curve_order);
+#endif
+
+    for (auto &elem : elements)
+        for (int v = 0; v < elem.num_points; v++)
+            elem.loc_num[v] = elem.offset + v;
+
+    // Initialize work arrays
+    int num_work_hst = dim;
+    work_hst.resize(num_work_hst);
+    for (int w = 0; w < num_work_hst; w++) work_hst[w].resize(num_local_points);
+
+    // Coarser domains only feed the subdomain setup, so their workspaces are dead in the solve
+    int last_phase = (reference == NULL) ? PHASE_SOLVE : PHASE_SUBDOMAIN_SETUP;
+
+    // Workspaces of every phase are requested together and planned once (the solver ones are empty on the coarser domains)
+    int num_work_dev = dim;
+    std::vector<int> work_handle(num_work_dev);
+    for (int w = 0; w < num_work_dev; w++) work_handle[w] = arena.request("domain.work", num_local_points * sizeof(DType), PHASE_DOMAIN_SETUP, last_phase);
+
+    std::vector<int> solver_handle(5);
+    for (auto &handle : solver_handle) handle = arena.request("domain.solver", num_local_points * sizeof(DType), PHASE_SOLVE, last_phase);
+
+    V.request(num_local_points, num_vectors + 1, PHASE_SOLVE, last_phase);
+    Z.request(num_local_points, num_vectors, PHASE_SOLVE, last_phase);
+
+    num_deflation = std::min(num_deflation, num_vectors - 1);
+
+    std::vector<int> deflation_handle((num_deflation > 0) ? num_deflation + 1 : 0);
+    for (auto &handle : deflation_handle) handle = arena.request("domain.deflation", num_local_points * sizeof(DType), PHASE_SOLVE, last_phase);
+
+    arena.plan();
 
+    work_dev.resize(num_work_dev);
+    for (int w = 0; w < num_work_dev; w++) work_dev[w] = arena.get<DType>(work_handle[w]);
+
+    for (int w = 0; w < num_work_dev; w++) ((DType**)(work_hst[0].data()))[w] = (DType*)(work_dev[w].ptr());
+    work_dev_ptr = device_malloc<DType*>(num_work_dev);
+    work_dev_ptr.copyFrom(work_hst[0].data(), num_work_dev * sizeof(DType*));
+
+    // Device data
+    for (auto &elem : elements) memcpy(work_hst[0].data() + elem.offset, elem.dirichlet_mask.data(), elem.num_points * sizeof(DType));
+    dirichlet_mask = device_malloc<DType>(num_local_points);
+    dirichlet_mask.copyFrom(work_hst[0].data(), num_local_points * sizeof(DType));
+
+    for (int g = 0; g < NUM_GEOM_FACTS; g++)
+    {
         for (auto &elem : elements) memcpy(work_hst[0].data() + elem.offset, elem.geom_fact[g].data(), elem.num_points * sizeof(DType));
-        geom_fact[g] = device.malloc<DType>(num_local_points);
+        geom_fact[g] = device_malloc<DType>(num_local_points);
         geom_fact[g].copyFrom(work_hst[0].data(), num_local_points * sizeof(DType));
     }
 
     std::vector<DType*> geom_fact_ptr_hst(NUM_GEOM_FACTS);
     for (int g = 0; g < NUM_GEOM_FACTS; g++) geom_fact_ptr_hst[g] = (DType*)(geom_fact[g].ptr());
-    geom_fact_ptr = device.malloc<DType*>(NUM_GEOM_FACTS);
+    geom_fact_ptr = device_malloc<DType*>(NUM_GEOM_FACTS);
     geom_fact_ptr.copyFrom(geom_fact_ptr_hst.data(), NUM_GEOM_FACTS * sizeof(DType*));
 
     // Done reading data
@@ -280,8 +334,16 @@ void Domain<DType>::initialize(char *directory_, int poly_degree_)
         }
     }
 
-    comm_init(&gs_comm, MPI_COMM_WORLD);
-    gs_handle = gslib_gs_setup(boundary_nodes.data(), num_bdary_nodes, &gs_comm, 0, gs_auto, 1);
+#if REORDER_MESH == 1
+    // Boundary nodes stay first for the gather-scatter, so each block is renumbered on its own
+    renumber_nodes(local_node_idx, elements, 0, num_bdary_nodes);
+    renumber_nodes(local_node_idx, elements, num_bdary_nodes, count);
+
+    for (auto &it : local_node_idx)
+        if (it.second < num_bdary_nodes) boundary_nodes[it.second] = it.first;
+#endif
+
+    gather_scatter.setup(boundary_nodes.data(), num_bdary_nodes);
 
     num_local_nodes = local_node_degree.size();
     Q.initialize(num_local_points, num_local_nodes);
@@ -293,11 +355,11 @@ void Domain<DType>::initialize(char *directory_, int poly_degree_)
     Q.assemble();
     Q.transpose(Qt);
 
-    assembled_weight = device.malloc<DType>(num_local_nodes);
+    assembled_weight = device_malloc<DType>(num_local_nodes);
     math.set_to_value(work_dev[0], 1.0, num_local_points);
     Qt.multiply(assembled_weight, work_dev[0]);
     assembled_weight.copyTo(work_hst[0].data(), num_bdary_nodes * sizeof(DType));
-    gslib_gs(work_hst[0].data(), gs_type, gs_add, 0, gs_handle, NULL);
+    gather_scatter.apply(work_hst[0].data());
     assembled_weight.copyFrom(work_hst[0].data(), num_bdary_nodes * sizeof(DType));
     math.invert_vector_elements(assembled_weight, num_local_nodes);
 
@@ -312,194 +374,188 @@ void Domain<DType>::initialize(char *directory_, int poly_degree_)
     dgll_(Dt_gll.data(), D_gll.data(), r_gll.data(), &num_gll_points, &num_gll_points);
 
     for (int ij = 0; ij < num_gll_points * num_gll_points; ij++) ((DType*)(work_hst[0].data()))[ij] = (DType)(D_gll[ij]);
-    D_hat = device.malloc<DType>(num_gll_points * num_gll_points);
+    D_hat = device_malloc<DType>(num_gll_points * num_gll_points);
     D_hat.copyFrom(work_hst[0].data(), num_gll_points * num_gll_points * sizeof(DType));
 
-    // Solver
-    r_k = device.malloc<DType>(num_local_points);
-    r_kp1 = device.malloc<DType>(num_local_points);
-    q_k = device.malloc<DType>(num_local_points);
-    z_k = device.malloc<DType>(num_local_points);
-    p_k = device.malloc<DType>(num_local_points);
+    // Mass matrix diagonal of the Helmholtz operator (h1 A + h2 B)
+    for (auto &elem : elements) elem.mass_factor(D_gll, w_gll);
 
-    V.resize(num_vectors + 1); for (int i = 0; i < num_vectors + 1; i++) V[i] = device.malloc<DType>(num_local_points);
-    Z.resize(num_vectors); for (int i = 0; i < num_vectors; i++) Z[i] = device.malloc<DType>(num_local_points);
+    for (auto &elem : elements) memcpy(work_hst[0].data() + elem.offset, elem.mass_fact.data(), elem.num_points * sizeof(DType));
+    mass_fact = device_malloc<DType>(num_local_points);
+    mass_fact.copyFrom(work_hst[0].data(), num_local_points * sizeof(DType));
+
+    // Solver (empty on the coarser domains)
+    r_k = arena.get<DType>(solver_handle[0]);
+    r_kp1 = arena.get<DType>(solver_handle[1]);
+    q_k = arena.get<DType>(solver_handle[2]);
+    z_k = arena.get<DType>(solver_handle[3]);
+    p_k = arena.get<DType>(solver_handle[4]);
+
+    V.initialize(num_local_points, num_vectors + 1);
+    Z.initialize(num_local_points, num_vectors);
+    basis_coefs.resize(num_vectors + 1);
     H.resize(num_vectors); for (int i = 0; i < num_vectors; i++) H[i].resize(num_vectors);
     c_gmres.resize(num_vectors);
     s_gmres.resize(num_vectors);
     gamma.resize(num_vectors + 1);
 
-    // Kernels
-    occa::properties properties;
+    if (num_deflation > 0)
+    {
+        W_deflation.resize(num_deflation + 1); for (int i = 0; i < num_deflation + 1; i++) W_deflation[i] = arena.get<DType>(deflation_handle[i]);
+        H_raw.assign(num_vectors + 1, std::vector<double>(num_vectors, 0.0));
+        gamma_raw.assign(num_vectors + 1, 0.0);
+    }
 
+    // Kernels
     num_blocks = (num_local_points + BLOCK_SIZE - 1) / BLOCK_SIZE;
 
+    build_kernels();
+}
+
+template<typename DType>
+void Domain<DType>::build_kernels()
+{
+    occa::properties properties;
+
     properties["defines/DType"] = data_type;
     properties["defines/DIM"] = dim;
     properties["defines/OCCA_TYPE"] = OCCA_TYPE;
     properties["defines/BLOCK_SIZE"] = BLOCK_SIZE;
 
-    if (proc_id == 0)
+    stiffness_matrix_1_kernel = kernel_registry.get("domain.okl", "stiffness_matrix_1", properties);
+    stiffness_matrix_2_kernel = kernel_registry.get("domain.okl", "stiffness_matrix_2", properties);
+    initialize_arrays_kernel = kernel_registry.get("domain.okl", "initialize_arrays", properties);
+    residual_norm_kernel = kernel_registry.get("domain.okl", "residual_norm", properties);
+    projection_inner_products_kernel = kernel_registry.get("domain.okl", "projection_inner_products", properties);
+    solution_and_residual_update_kernel = kernel_registry.get("domain.okl", "solution_and_residual_update", properties);
+    inner_product_flexible_kernel = kernel_registry.get("domain.okl", "inner_product_flexible", properties);
+    residual_and_search_update_kernel = kernel_registry.get("domain.okl", "residual_and_search_update", properties);
+    inner_product_kernel = kernel_registry.get("domain.okl", "inner_product", properties);
+
+#if OCCA_TYPE == 2
+    if (poly_degree > 0)
     {
-        stiffness_matrix_1_kernel = device.buildKernel("domain.okl", "stiffness_matrix_1", properties);
-        stiffness_matrix_2_kernel = device.buildKernel("domain.okl", "stiffness_matrix_2", properties);
-        initialize_arrays_kernel = device.buildKernel("domain.okl", "initialize_arrays", properties);
-        residual_norm_kernel = device.buildKernel("domain.okl", "residual_norm", properties);
-        projection_inner_products_kernel = device.buildKernel("domain.okl", "projection_inner_products", properties);
-        solution_and_residual_update_kernel = device.buildKernel("domain.okl", "solution_and_residual_update", properties);
-        inner_product_flexible_kernel = device.buildKernel("domain.okl", "inner_product_flexible", properties);
-        residual_and_search_update_kernel = device.buildKernel("domain.okl", "residual_and_search_update", properties);
-        inner_product_kernel = device.buildKernel("domain.okl", "inner_product", properties);
-    }
+        occa::properties element_properties = properties;
+        element_properties["defines/N_X"] = poly_degree + 1;
 
-    MPI_Barrier(MPI_COMM_WORLD);
-
-    if (proc_id > 0)
-    {
-        stiffness_matrix_1_kernel = device.buildKernel("domain.okl", "stiffness_matrix_1", properties);
-        stiffness_matrix_2_kernel = device.buildKernel("domain.okl", "stiffness_matrix_2", properties);
-        initialize_arrays_kernel = device.buildKernel("domain.okl", "initialize_arrays", properties);
-        residual_norm_kernel = device.buildKernel("domain.okl", "residual_norm", properties);
-        projection_inner_products_kernel = device.buildKernel("domain.okl", "projection_inner_products", properties);
-        solution_and_residual_update_kernel = device.buildKernel("domain.okl", "solution_and_residual_update", properties);
-        inner_product_flexible_kernel = device.buildKernel("domain.okl", "inner_product_flexible", properties);
-        residual_and_search_update_kernel = device.buildKernel("domain.okl", "residual_and_search_update", properties);
-        inner_product_kernel = device.buildKernel("domain.okl", "inner_product", properties);
+        stiffness_matrix_1_element_kernel = kernel_registry.get("domain.okl", "stiffness_matrix_1_element", element_properties);
+        stiffness_matrix_2_element_kernel = kernel_registry.get("domain.okl", "stiffness_matrix_2_element", element_properties);
     }
-
-    MPI_Barrier(MPI_COMM_WORLD);
+#endif
 }
 
-// Visit output
+// Partition
 template<typename DType>
-void Domain<DType>::output(std::string output_name, int num_fields, ...)
+double Domain<DType>::element_cost(const Element<DType> &elem, const int *degree)
 {
-    // Silo database
-    DBSetDeprecateWarnings(0);
-    DBfile *silo_file = NULL;
-    char silo_name[80];
-
-    if (proc_id == 0)
-    {
-        sprintf(silo_name, "%s.silo", output_name.c_str());
-        silo_file = DBCreate(silo_name, DB_CLOBBER, DB_LOCAL, "Field data", DB_PDB);
-    }
+    // Free points and the share of them owned by neighbouring elements (degree is the global multiplicity of each point)
+    double num_free_points = 0.0;
+    double num_shared_points = 0.0;
 
-    if ((silo_file == NULL) and (proc_id == 0))
+    for (int v = 0; v < elem.num_points; v++)
     {
-        printf("ERROR: Couldn't create Silo file\n");
+        if (elem.dirichlet_mask[v] == 0.0) continue;
 
-        MPI_Finalize();
-        exit(EXIT_FAILURE);
+        num_free_points += 1.0;
+        num_shared_points += (double)(degree[v] - 1) / (double)(degree[v]);
     }
 
-    // Mesh
-    int num_vertices = (dim == 2) ? 4 : 8;
-    int num_low_order_elems = num_total_elements * std::pow(poly_degree, dim);
-    int num_low_order_points = num_low_order_elems * num_vertices;
+    double free_fraction = num_free_points / elem.num_points;
+    double shared_fraction = num_shared_points / elem.num_points;
 
-    std::vector<int> low_order_elements(num_low_order_points);
-    int offset = 0;
+    // Points of every tree level: the finest operator works on all of them, the levels of the tree on the free ones
+    double num_tree_points = 0.0;
 
-    if (proc_id == 0)
+    for (int N = poly_degree; ; N = std::max(N - std::max(poly_reduction, 1), 1))
     {
-        if (dim == 2)
-        {
-            int n_x = poly_degree + 1;
-
-            for (int e = 0; e < num_total_elements; e++)
-            {
-                for (int s_y = 0; s_y < poly_degree; s_y++)
-                {
-                    for (int s_x = 0; s_x < poly_degree; s_x++)
-                    {
-                        low_order_elements[offset++] = e * num_elem_points + (s_x + 0) + (s_y + 0) * n_x;
-                        low_order_elements[offset++] = e * num_elem_points + (s_x + 1) + (s_y + 0) * n_x;
-                        low_order_elements[offset++] = e * num_elem_points + (s_x + 1) + (s_y + 1) * n_x;
-                        low_order_elements[offset++] = e * num_elem_points + (s_x + 0) + (s_y + 1) * n_x;
-                    }
-                }
-            }
-        }
-        else
-        {
-            int n_x = poly_degree + 1;
-            int n_xy = n_x * n_x;
+        num_tree_points += std::pow(N + 1, dim);
 
-            for (int e = 0; e < num_total_elements; e++)
-            {
-                for (int s_z = 0; s_z < poly_degree; s_z++)
-                {
-                    for (int s_y = 0; s_y < poly_degree; s_y++)
-                    {
-                        for (int s_x = 0; s_x < poly_degree; s_x++)
-                        {
-                            low_order_elements[offset++] = e * num_elem_points + (s_x + 0) + (s_y + 0) * n_x + (s_z + 0) * n_xy;
-                            low_order_elements[offset++] = e * num_elem_points + (s_x + 1) + (s_y + 0) * n_x + (s_z + 0) * n_xy;
-                            low_order_elements[offset++] = e * num_elem_points + (s_x + 1) + (s_y + 1) * n_x + (s_z + 0) * n_xy;
-                            low_order_elements[offset++] = e * num_elem_points + (s_x + 0) + (s_y + 1) * n_x + (s_z + 0) * n_xy;
-                            low_order_elements[offset++] = e * num_elem_points + (s_x + 0) + (s_y + 0) * n_x + (s_z + 1) * n_xy;
-                            low_order_elements[offset++] = e * num_elem_points + (s_x + 1) + (s_y + 0) * n_x + (s_z + 1) * n_xy;
-                            low_order_elements[offset++] = e * num_elem_points + (s_x + 1) + (s_y + 1) * n_x + (s_z + 1) * n_xy;
-                            low_order_elements[offset++] = e * num_elem_points + (s_x + 0) + (s_y + 1) * n_x + (s_z + 1) * n_xy;
-                        }
-                    }
-                }
-            }
-        }
+        if (N == 1) break;
     }
 
-    std::vector<DType> x_total, y_total, z_total;
+    double cost = elem.num_points + free_fraction * num_tree_points;
 
-    if (proc_id == 0)
-    {
-        if (dim >= 1) x_total.resize(num_total_points);
-        if (dim >= 2) y_total.resize(num_total_points);
-        if (dim >= 3) z_total.resize(num_total_points);
-    }
+    // Extended dofs: each overlap layer copies the whole element into the subdomains of the neighbours it shares points with
+    cost += subdomain_overlap * shared_fraction * num_tree_points;
 
-    std::vector<int> proc_offset(num_procs);
-    std::vector<int> proc_count(num_procs);
-    proc_count[proc_id] = num_local_points;
+    // Superdomain: the vertices shared with neighbours join their composite coarse problems
+    int num_corners = 1 << dim;
+    int N_x = poly_degree + 1;
+    double num_shared_corners = 0.0;
 
-    MPI_Gather(&num_local_points, 1, MPI_INT, proc_count.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
-    if (proc_id == 0) for (int p = 1; p < num_procs; p++) proc_offset[p] = proc_offset[p - 1] + proc_count[p - 1];
-
-    if (dim >= 1)
+    for (int c = 0; c < num_corners; c++)
     {
-        for (auto &elem : elements) memcpy(work_hst[0].data() + elem.offset, elem.x.data(), elem.num_points * sizeof(DType));
+        int v = 0;
+        int stride = 1;
 
-        MPI_Gatherv(work_hst[0].data(), num_local_points, (typeid(DType) == typeid(double)) ? MPI_DOUBLE : MPI_FLOAT, x_total.data(), proc_count.data(), proc_offset.data(), (typeid(DType) == typeid(double)) ? MPI_DOUBLE : MPI_FLOAT, 0, MPI_COMM_WORLD);
-    }
-
-    if (dim >= 2)
-    {
-        for (auto &elem : elements) memcpy(work_hst[0].data() + elem.offset, elem.y.data(), elem.num_points * sizeof(DType));
+        for (int d = 0; d < dim; d++, stride *= N_x) v += ((c >> d) & 1) * (N_x - 1) * stride;
 
-        MPI_Gatherv(work_hst[0].data(), num_local_points, (typeid(DType) == typeid(double)) ? MPI_DOUBLE : MPI_FLOAT, y_total.data(), proc_count.data(), proc_offset.data(), (typeid(DType) == typeid(double)) ? MPI_DOUBLE : MPI_FLOAT, 0, MPI_COMM_WORLD);
+        if (elem.dirichlet_mask[v] != 0.0) num_shared_corners += degree[v] - 1;
     }
 
-    if (dim >= 3)
-    {
-        for (auto &elem : elements) memcpy(work_hst[0].data() + elem.offset, elem.z.data(), elem.num_points * sizeof(DType));
+    cost += superdomain_overlap * num_shared_corners;
 
-        MPI_Gatherv(work_hst[0].data(), num_local_points, (typeid(DType) == typeid(double)) ? MPI_DOUBLE : MPI_FLOAT, z_total.data(), proc_count.data(), proc_offset.data(), (typeid(DType) == typeid(double)) ? MPI_DOUBLE : MPI_FLOAT, 0, MPI_COMM_WORLD);
-    }
+    return cost;
+}
 
-    DType *coordinates[] = { x_total.data(), y_total.data(), z_total.data() };
+// Memory
+template<typename DType>
+void Domain<DType>::memory_usage()
+{
+    // Host
+    for (auto &elem : elements) memory.add("domain.host.mesh", elem.memory_usage());
+    memory.add("domain.host.mesh", migration.send_elements);
+    memory.add("domain.host.mesh", migration.recv_position);
+    memory.add("domain.host.mesh", curve_order);
+    for (auto &work : work_hst) memory.add("domain.host.work", work);
+
+    // Device
+    memory.add("domain.device.operator", Q.memory_usage());
+    memory.add("domain.device.operator", Qt.memory_usage());
+    memory.add("domain.device.operator", assembled_weight);
+    memory.add("domain.device.operator", dirichlet_mask);
+    memory.add("domain.device.operator", D_hat);
+    memory.add("domain.device.operator", mass_fact);
+    for (int g = 0; g < NUM_GEOM_FACTS; g++) memory.add("domain.device.operator", geom_fact[g]);
+    memory.add("domain.device.operator", geom_fact_ptr);
+
+    // Work arrays, solver vectors and bases are reported by the arena
+    memory.add("domain.device.solver", work_dev_ptr);
+    memory.add("domain.device.solver", V.memory_usage());
+    memory.add("domain.device.solver", Z.memory_usage());
+}
 
-    if (proc_id == 0)
+template<typename DType>
+void Domain<DType>::release_host_data(bool keep_mesh)
+{
+    // Everything the solver needs already lives on the device
+    if (keep_mesh)
+    {
+        for (auto &elem : elements) elem.release(true);
+    }
+    else
     {
-        DBPutZonelist(silo_file, "elements", num_low_order_elems, dim, low_order_elements.data(), num_low_order_points, 0, &num_vertices, &num_low_order_elems, 1);
-        DBPutUcdmesh(silo_file, "mesh", dim, NULL, coordinates, num_total_points, num_low_order_elems, "elements", NULL, (typeid(DType) == typeid(double)) ? DB_DOUBLE : DB_FLOAT, NULL);
+        std::vector<Element<DType>>().swap(elements);
+        std::vector<int>().swap(curve_order);
+        migration = Migration_Plan();
     }
+}
+
+// Visit output
+template<typename DType>
+void Domain<DType>::output(std::string output_name, int num_fields, ...)
+{
+    // Each rank writes its own block and rank 0 a multi-block index, so nothing is gathered
+    silo_writer.wait();
+    silo_writer.clear();
 
-    // Fields
+    // Mesh (coordinates do not change between outputs)
+    if (not silo_writer.has_mesh())
+        for (auto &elem : elements) silo_writer.add_element(poly_degree, elem.x.data(), elem.y.data(), elem.z.data());
+
+    // Fields (only the device-to-host copies are synchronous)
     char *field_name;
     occa::memory field_data;
-    std::vector<DType> field_data_total;
-
-    if (proc_id == 0) field_data_total.resize(num_total_points);
 
     va_list args;
     va_start(args, num_fields);
@@ -510,17 +566,13 @@ void Domain<DType>::output(std::string output_name, int num_fields, ...)
         field_data = va_arg(args, occa::memory);
         field_data.copyTo(work_hst[0].data(), num_local_points * sizeof(DType));
 
-        MPI_Gatherv(work_hst[0].data(), num_local_points, (typeid(DType) == typeid(double)) ? MPI_DOUBLE : MPI_FLOAT, field_data_total.data(), proc_count.data(), proc_offset.data(), (typeid(DType) == typeid(double)) ? MPI_DOUBLE : MPI_FLOAT, 0, MPI_COMM_WORLD);
-
-        if (proc_id == 0) DBPutUcdvar1(silo_file, field_name, "mesh", field_data_total.data(), num_total_points, NULL, 0, (typeid(DType) == typeid(double)) ? DB_DOUBLE : DB_FLOAT, DB_NODECENT, NULL);
+        silo_writer.add_field(field_name);
+        for (auto &elem : elements) silo_writer.add_field_values(poly_degree, work_hst[0].data() + elem.offset);
     }
 
     va_end(args);
 
-    // Free data
-    if (proc_id == 0) DBClose(silo_file);
-
-    MPI_Barrier(MPI_COMM_WORLD);
+    silo_writer.write(output_name);
 }
 
 // Member functions
@@ -580,7 +632,7 @@ void Domain<DType>::initial_function(occa::memory &u, int function_id)
 }
 
 template<typename DType>
-void Domain<DType>::direct_stiffness_summation(occa::memory &QQtu, occa::memory &u, bool apply_dirichlet_mask, bool apply_assembled_weight)
+void Domain<DType>::direct_stiffness_summation(occa::memory &QQtu, occa::memory &u, bool apply_dirichlet_mask, bool apply_assembled_weight, bool reduced_wire)
 {
     if (apply_assembled_weight)
         Qt.multiply_weight(work_dev[0], u, assembled_weight);
@@ -589,7 +641,7 @@ void Domain<DType>::direct_stiffness_summation(occa::memory &QQtu, occa::memory
 
     work_dev[0].copyTo(work_hst[0].data(), num_bdary_nodes * sizeof(DType));
 
-    gslib_gs(work_hst[0].data(), gs_type, gs_add, 0, gs_handle, NULL);
+    gather_scatter.apply(work_hst[0].data(), reduced_wire);
 
     work_dev[0].copyFrom(work_hst[0].data(), num_bdary_nodes * sizeof(DType));
 
@@ -602,8 +654,13 @@ void Domain<DType>::direct_stiffness_summation(occa::memory &QQtu, occa::memory
 template<typename DType>
 void Domain<DType>::stiffness_matrix(occa::memory &Au, occa::memory &u, bool apply_dssum)
 {
+#if OCCA_TYPE == 2
+    stiffness_matrix_1_element_kernel(work_dev_ptr, u, D_hat, geom_fact_ptr, num_local_elements);
+    stiffness_matrix_2_element_kernel(Au, work_dev_ptr, D_hat, u, mass_fact, h1, h2, num_local_elements);
+#else
     stiffness_matrix_1_kernel(work_dev_ptr, u, D_hat, geom_fact_ptr, num_local_points, poly_degree);
-    stiffness_matrix_2_kernel(Au, work_dev_ptr, D_hat, num_local_points, poly_degree);
+    stiffness_matrix_2_kernel(Au, work_dev_ptr, D_hat, u, mass_fact, h1, h2, num_local_points, poly_degree);
+#endif
 
     if (apply_dssum) direct_stiffness_summation(Au, Au, true, false);
 }
@@ -636,13 +693,15 @@ void Domain<DType>::flexible_conjugate_gradient(occa::memory &u, occa::memory &f
 
     if (use_preconditioner)
     {
+        inner_tolerance(subdomain, r_0_norm, r_0_norm, r_0_norm, use_relative);
+
         if (preconditioner_type == 0)
             subdomain.flexible_conjugate_gradient(z_k, r_k);
         else
             subdomain.generalized_minimum_residual(z_k, r_k);
 
         timer.start("subdomain.stitching");
-        direct_stiffness_summation(z_k, z_k, true, true);
+        direct_stiffness_summation(z_k, z_k, true, true, PRECONDITIONER_WIRE > 0);
         timer.stop("subdomain.stitching");
     }
     else
@@ -696,13 +755,15 @@ void Domain<DType>::flexible_conjugate_gradient(occa::memory &u, occa::memory &f
         // Update search direction
         if (use_preconditioner)
         {
+            inner_tolerance(subdomain, r_norm, r_norm, r_0_norm, use_relative);
+
             if (preconditioner_type == 0)
                 subdomain.flexible_conjugate_gradient(z_k, r_kp1);
             else
                 subdomain.generalized_minimum_residual(z_k, r_kp1);
 
             timer.start("subdomain.stitching");
-            direct_stiffness_summation(z_k, z_k, true, true);
+            direct_stiffness_summation(z_k, z_k, true, true, PRECONDITIONER_WIRE > 0);
             timer.stop("subdomain.stitching");
         }
         else
@@ -749,6 +810,7 @@ void Domain<DType>::generalized_minimum_residual(occa::memory &u, occa::memory &
     int iter = 0;
     int outer = 0;
     int j;
+    int j_start = 0;
 
     DType alpha_j;
     DType beta_j;
@@ -757,42 +819,55 @@ void Domain<DType>::generalized_minimum_residual(occa::memory &u, occa::memory &
 
     while (iter < max_iterations)
     {
-        if (iter > 0)
+        // A deflated restart already holds the residual in its basis
+        if (j_start == 0)
         {
-            timer.start("domain.operator_application");
-            stiffness_matrix(r_k, u_k);
-            timer.stop("domain.operator_application");
+            if (iter > 0)
+            {
+                timer.start("domain.operator_application");
+                stiffness_matrix(r_k, u_k);
+                timer.stop("domain.operator_application");
+
+                timer.start("domain.vector_operations");
+                math.vector_vector_addition(r_k, 1.0, f, - 1.0, r_k, num_local_points);
+                timer.stop("domain.vector_operations");
+
+                timer.start("domain.residual_norm");
+                residual_norm(r_norm, r_k);
+                timer.stop("domain.residual_norm");
+
+                gamma[0] = r_norm;
+            }
+            else
+            {
+                gamma[0] = r_0_norm;
+            }
 
             timer.start("domain.vector_operations");
-            math.vector_vector_addition(r_k, 1.0, f, - 1.0, r_k, num_local_points);
+            math.vector_scaling(V[0], 1.0 / gamma[0], r_k, num_local_points);
             timer.stop("domain.vector_operations");
 
-            timer.start("domain.residual_norm");
-            residual_norm(r_norm, r_k);
-            timer.stop("domain.residual_norm");
-
-            gamma[0] = r_norm;
-        }
-        else
-        {
-            gamma[0] = r_0_norm;
+            if (num_deflation > 0)
+            {
+                for (auto &row : H_raw) std::fill(row.begin(), row.end(), 0.0);
+                std::fill(gamma_raw.begin(), gamma_raw.end(), 0.0);
+                gamma_raw[0] = gamma[0];
+            }
         }
 
-        timer.start("domain.vector_operations");
-        math.vector_scaling(V[0], 1.0 / gamma[0], r_k, num_local_points);
-        timer.stop("domain.vector_operations");
-
-        for (j = 0; j < num_vectors; j++)
+        for (j = j_start; j < num_vectors; j++)
         {
             if (use_preconditioner)
             {
+                inner_tolerance(subdomain, 1.0, std::abs(gamma[j]), r_0_norm, use_relative);
+
                 if (preconditioner_type == 0)
                     subdomain.flexible_conjugate_gradient(Z[j], V[j]);
                 else
                     subdomain.generalized_minimum_residual(Z[j], V[j]);
 
                 timer.start("subdomain.stitching");
-                direct_stiffness_summation(Z[j], Z[j], true, true);
+                direct_stiffness_summation(Z[j], Z[j], true, true, PRECONDITIONER_WIRE > 0);
                 timer.stop("subdomain.stitching");
             }
             else
@@ -807,20 +882,22 @@ void Domain<DType>::generalized_minimum_residual(occa::memory &u, occa::memory &
             timer.stop("domain.operator_application");
 
             // 2-pass Gram-Schmidt (1st pass)
-            for (int i = 0; i < j + 1; i++)
-            {
-                timer.start("domain.inner_products");
-                assembled_inner_product(H[i][j], q_k, V[i]);
-                timer.stop("domain.inner_products");
-            }
+            timer.start("domain.inner_products");
+            assembled_inner_products(basis_coefs.data(), q_k, V, j + 1);
+            timer.stop("domain.inner_products");
 
             for (int i = 0; i < j + 1; i++)
             {
-                timer.start("domain.vector_operations");
-                math.vector_vector_addition(q_k, 1.0, q_k, - H[i][j], V[i], num_local_points);
-                timer.stop("domain.vector_operations");
+                H[i][j] = basis_coefs[i];
+                basis_coefs[i] = - basis_coefs[i];
             }
 
+            timer.start("domain.vector_operations");
+            V.linear_combination(q_k, basis_coefs.data(), j + 1);
+            timer.stop("domain.vector_operations");
+
+            if (num_deflation > 0) for (int i = 0; i < j + 1; i++) H_raw[i][j] = H[i][j];
+
             // Apply Given's rotation to new column
             for (int i = 0; i < j; i++)
             {
@@ -833,6 +910,8 @@ void Domain<DType>::generalized_minimum_residual(occa::memory &u, occa::memory &
             residual_norm(alpha_j, q_k);
             timer.stop("domain.residual_norm");
 
+            if (num_deflation > 0) H_raw[j + 1][j] = alpha_j;
+
             if (std::abs(alpha_j) == 0.0)
             {
                 converged = true;
@@ -899,20 +978,206 @@ void Domain<DType>::generalized_minimum_residual(occa::memory &u, occa::memory &
         }
 
         // Sum Arnoldi vectors
-        for (int i = 0; i < j + 1; i++)
-        {
-            timer.start("domain.vector_operations");
-            math.vector_vector_addition(u_k, 1.0, u_k, c_gmres[i], Z[i], num_local_points);
-            timer.stop("domain.vector_operations");
-        }
+        timer.start("domain.vector_operations");
+        Z.linear_combination(u_k, c_gmres.data(), j + 1);
+        timer.stop("domain.vector_operations");
 
         if (converged) break;
         outer++;
+
+        // Keep the harmonic Ritz space (0 when disabled or when the restart vectors are degenerate)
+        j_start = (num_deflation > 0) ? deflated_restart(j + 1) : 0;
     }
 
     num_iterations = iter;
 }
 
+template<typename DType>
+int Domain<DType>::deflated_restart(int m)
+{
+    int k = std::min(num_deflation, m - 1);
+
+    // Dense solve with partial pivoting for the small matrices of the cycle
+    auto solve = [](std::vector<std::vector<double>> A, std::vector<double> b)
+    {
+        int n = b.size();
+
+        for (int c = 0; c < n; c++)
+        {
+            int pivot = c;
+            for (int r = c + 1; r < n; r++) if (std::abs(A[r][c]) > std::abs(A[pivot][c])) pivot = r;
+
+            std::swap(A[c], A[pivot]);
+            std::swap(b[c], b[pivot]);
+
+            for (int r = c + 1; r < n; r++)
+            {
+                double l = A[r][c] / A[c][c];
+                for (int i = c; i < n; i++) A[r][i] -= l * A[c][i];
+                b[r] -= l * b[c];
+            }
+        }
+
+        for (int r = n - 1; r >= 0; r--)
+        {
+            for (int i = r + 1; i < n; i++) b[r] -= A[r][i] * b[i];
+            b[r] /= A[r][r];
+        }
+
+        return b;
+    };
+
+    // Residual of the cycle in the V basis: gamma_raw - H_raw y
+    std::vector<double> residual(m + 1);
+
+    for (int i = 0; i < m + 1; i++)
+    {
+        residual[i] = gamma_raw[i];
+        for (int j = 0; j < m; j++) residual[i] -= H_raw[i][j] * c_gmres[j];
+    }
+
+    // Harmonic Ritz matrix H_m + h^2 H_m^{-T} e_m e_m^T
+    std::vector<std::vector<double>> H_m(m, std::vector<double>(m)), H_mt(m, std::vector<double>(m));
+
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < m; j++)
+            H_m[i][j] = H_mt[j][i] = H_raw[i][j];
+
+    std::vector<double> e_m(m, 0.0);
+    e_m[m - 1] = 1.0;
+
+    std::vector<double> f = solve(H_mt, e_m);
+    for (int i = 0; i < m; i++) H_m[i][m - 1] += H_raw[m][m - 1] * H_raw[m][m - 1] * f[i];
+
+    // Invariant subspace of the k smallest harmonic Ritz values (block inverse iteration, so complex pairs need no special care)
+    std::vector<std::vector<double>> P(k + 1, std::vector<double>(m + 1, 0.0));
+
+    for (int c = 0; c < k; c++)
+        for (int i = 0; i < m; i++)
+            P[c][i] = 1.0 / (i + c + 1);
+
+    auto orthonormalize = [&](int c, int length)
+    {
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (int b = 0; b < c; b++)
+            {
+                double dot = 0.0;
+                for (int i = 0; i < length; i++) dot += P[b][i] * P[c][i];
+                for (int i = 0; i < length; i++) P[c][i] -= dot * P[b][i];
+            }
+        }
+
+        double norm = 0.0;
+        for (int i = 0; i < length; i++) norm += P[c][i] * P[c][i];
+        norm = std::sqrt(norm);
+
+        if (not (norm > 0.0)) return false;
+        for (int i = 0; i < length; i++) P[c][i] /= norm;
+
+        return true;
+    };
+
+    for (int sweep = 0; sweep < 100; sweep++)
+    {
+        for (int c = 0; c < k; c++)
+        {
+            std::vector<double> x = solve(H_m, std::vector<double>(P[c].begin(), P[c].begin() + m));
+            std::copy(x.begin(), x.end(), P[c].begin());
+
+            if (not orthonormalize(c, m)) return 0;
+        }
+    }
+
+    // Left basis from H_raw P_k and the cycle residual, so A Z_m P_k = V_{m+1} P H_k holds exactly even for inexact Ritz vectors
+    std::vector<std::vector<double>> P_k(P.begin(), P.begin() + k);
+
+    for (int c = 0; c < k; c++)
+    {
+        P[c].assign(m + 1, 0.0);
+
+        for (int i = 0; i < m + 1; i++)
+            for (int j = 0; j < m; j++)
+                P[c][i] += H_raw[i][j] * P_k[c][j];
+    }
+
+    // H_k = P^T H_raw P_k is upper triangular with a zero last row (the residual is orthogonal to the range of H_raw)
+    std::vector<std::vector<double>> H_k(k + 1, std::vector<double>(k, 0.0));
+
+    for (int c = 0; c < k; c++)
+    {
+        std::vector<double> y = P[c];
+        if (not orthonormalize(c, m + 1)) return 0;
+
+        for (int a = 0; a < c + 1; a++)
+            for (int i = 0; i < m + 1; i++)
+                H_k[a][c] += P[a][i] * y[i];
+    }
+
+    P[k] = residual;
+    if (not orthonormalize(k, m + 1)) return 0;
+
+    // Cycle state for the next Arnoldi steps (the first k columns need no further rotations)
+    for (auto &row : H_raw) std::fill(row.begin(), row.end(), 0.0);
+    std::fill(gamma_raw.begin(), gamma_raw.end(), 0.0);
+    std::fill(gamma.begin(), gamma.end(), 0.0);
+
+    for (int a = 0; a < k + 1; a++)
+    {
+        for (int i = 0; i < m + 1; i++) gamma_raw[a] += P[a][i] * residual[i];
+        gamma[a] = gamma_raw[a];
+    }
+
+    for (int b = 0; b < k; b++)
+    {
+        for (int a = 0; a < b + 1; a++) H_raw[a][b] = H[a][b] = H_k[a][b];
+
+        c_gmres[b] = 1.0;
+        s_gmres[b] = 0.0;
+    }
+
+    // New bases
+    timer.start("domain.vector_operations");
+
+    for (int a = 0; a < k + 1; a++)
+    {
+        for (int i = 0; i < m + 1; i++) basis_coefs[i] = (DType)(P[a][i]);
+
+        math.set_to_value(W_deflation[a], 0.0, num_local_points);
+        V.linear_combination(W_deflation[a], basis_coefs.data(), m + 1);
+    }
+
+    for (int a = 0; a < k + 1; a++) V[a].copyFrom(W_deflation[a], num_local_points * sizeof(DType));
+
+    for (int a = 0; a < k; a++)
+    {
+        for (int i = 0; i < m; i++) basis_coefs[i] = (DType)(P_k[a][i]);
+
+        math.set_to_value(W_deflation[a], 0.0, num_local_points);
+        Z.linear_combination(W_deflation[a], basis_coefs.data(), m);
+    }
+
+    for (int a = 0; a < k; a++) Z[a].copyFrom(W_deflation[a], num_local_points * sizeof(DType));
+
+    timer.stop("domain.vector_operations");
+
+    return k;
+}
+
+template<typename DType>
+template<typename PType>
+void Domain<DType>::inner_tolerance(PType &subdomain, DType rhs_norm, DType r_norm, DType r_0_norm, bool use_relative)
+{
+#if INNER_TOLERANCE == 1
+    // A flexible method still converges when the preconditioner error grows like 1 / ||r_j||, so the
+    // inner solve may stop at a relative residual of target / ||r_j|| (never below the fixed tolerance)
+    DType target = use_relative ? tolerance * r_0_norm : tolerance;
+    DType eta = std::min(inner_tolerance_max, target / r_norm);
+
+    subdomain.set_tolerance(std::max((double)(subdomain.tolerance), (double)(eta * rhs_norm)));
+#endif
+}
+
 template<typename DType>
 void Domain<DType>::residual_norm(DType &r_norm, occa::memory &r)
 {
@@ -946,6 +1211,17 @@ void Domain<DType>::assembled_inner_product(DType &uv, occa::memory &u, occa::me
     MPI_Allreduce(MPI_IN_PLACE, &uv, 1, (typeid(DType) == typeid(double)) ? MPI_DOUBLE : MPI_FLOAT, MPI_SUM, MPI_COMM_WORLD);
 }
 
+// Inner products of u with the first n columns of V (one stiffness summation and one global reduction, the summation being symmetric)
+template<typename DType>
+void Domain<DType>::assembled_inner_products(DType *uv, occa::memory &u, Multivector<DType> &V, int n)
+{
+    direct_stiffness_summation(work_dev[1], u);
+    V.multi_dot(uv, work_dev[1], dirichlet_mask, n);
+
+    // Reduce globally
+    MPI_Allreduce(MPI_IN_PLACE, uv, n, (typeid(DType) == typeid(double)) ? MPI_DOUBLE : MPI_FLOAT, MPI_SUM, MPI_COMM_WORLD);
+}
+
 template<typename DType>
 void Domain<DType>::projection_inner_products(DType &gamma_k, DType &theta_k, occa::memory &z_k, occa::memory &r_k, occa::memory &p_k, occa::memory &q_k)
 {
@@ -4,7 +4,7 @@
 
 // Headers
 #include <unordered_map>
-#include <set>
+#include <vector>
 
 // Definitions
 #ifndef NUM_GEOM_FACTS
@@ -15,6 +15,24 @@
 #ifndef ELEMENT_HPP
 #define ELEMENT_HPP
 
+// Region elements sharing each entity (vertex, edge or face) of an element, CSR over the entities
+struct Element_Connectivity
+{
+    std::vector<int> ptr;
+    std::vector<int> neighbors;
+
+    struct Range
+    {
+        const int *first;
+        const int *last;
+
+        const int* begin() const { return first; }
+        const int* end() const { return last; }
+    };
+
+    Range operator[](int entity) const { return { neighbors.data() + ptr[entity], neighbors.data() + ptr[entity + 1] }; }
+};
+
 template<typename DType>
 class Element
 {
@@ -41,17 +59,27 @@ class Element
         // Geometric factor
         std::vector<DType> geom_fact[NUM_GEOM_FACTS];
 
+        // Mass matrix diagonal (GLL weights times the Jacobian determinant)
+        std::vector<DType> mass_fact;
+
         // Connectivity
         std::vector<int> loc_num;
         std::vector<long long> glo_num;
         std::vector<long long> dof_num;
-        std::vector<std::set<int>> vert_conn;
-        std::vector<std::set<int>> edge_conn;
-        std::vector<std::set<int>> face_conn;
+        Element_Connectivity vert_conn;
+        Element_Connectivity edge_conn;
+        Element_Connectivity face_conn;
 
         // Constructor and destructor
         Element(int, int, int);
         ~Element();
+
+        // Geometry
+        void mass_factor(const std::vector<double>&, const std::vector<double>&);
+
+        // Memory
+        long long memory_usage();
+        void release(bool = false);
 };
 
 #include "element.tpp"
@@ -30,14 +30,16 @@ Element<DType>::Element(int id_, int dim_, int poly_degree_)
     for (int g = 0; g < NUM_GEOM_FACTS; g++)
         geom_fact[g].resize(num_points);
 
+    mass_fact.resize(num_points);
+
     // Connectivity
     loc_num.resize(num_points);
     glo_num.resize(num_points);
     dof_num.resize(num_points);
 
-    vert_conn.resize((dim == 2) ? 4 : 8);
-    edge_conn.resize((dim == 2) ? 4 : 12);
-    face_conn.resize((dim == 2) ? 0 : 6);
+    vert_conn.ptr.assign(((dim == 2) ? 4 : 8) + 1, 0);
+    edge_conn.ptr.assign(((dim == 2) ? 4 : 12) + 1, 0);
+    face_conn.ptr.assign(((dim == 2) ? 0 : 6) + 1, 0);
 }
 
 template<typename DType>
@@ -45,3 +47,104 @@ Element<DType>::~Element()
 {
 
 }
+
+// Geometry
+template<typename DType>
+void Element<DType>::mass_factor(const std::vector<double> &D_gll, const std::vector<double> &w_gll)
+{
+    int n = poly_degree + 1;
+    int n_xy = n * n;
+
+    // Derivatives of the coordinates at the GLL points (D_gll[p + i * n] is the derivative of basis p at point i)
+    for (int v = 0; v < num_points; v++)
+    {
+        int i = v % n;
+        int j = (v / n) % n;
+        int k = v / n_xy;
+
+        double dX[3][3] = { { 0.0 } };
+
+        for (int p = 0; p < n; p++)
+        {
+            int v_r = p + j * n + k * n_xy;
+            int v_s = i + p * n + k * n_xy;
+            int v_t = i + j * n + p * n_xy;
+
+            dX[0][0] += D_gll[p + i * n] * x[v_r];
+            dX[1][0] += D_gll[p + i * n] * y[v_r];
+            dX[0][1] += D_gll[p + j * n] * x[v_s];
+            dX[1][1] += D_gll[p + j * n] * y[v_s];
+
+            if (dim == 3)
+            {
+                dX[2][0] += D_gll[p + i * n] * z[v_r];
+                dX[2][1] += D_gll[p + j * n] * z[v_s];
+                dX[0][2] += D_gll[p + k * n] * x[v_t];
+                dX[1][2] += D_gll[p + k * n] * y[v_t];
+                dX[2][2] += D_gll[p + k * n] * z[v_t];
+            }
+        }
+
+        double jacobian;
+
+        if (dim == 2)
+            jacobian = dX[0][0] * dX[1][1] - dX[0][1] * dX[1][0];
+        else
+            jacobian = dX[0][0] * (dX[1][1] * dX[2][2] - dX[1][2] * dX[2][1]) 
+                     - dX[0][1] * (dX[1][0] * dX[2][2] - dX[1][2] * dX[2][0]) 
+                     + dX[0][2] * (dX[1][0] * dX[2][1] - dX[1][1] * dX[2][0]);
+
+        double weight = w_gll[i] * w_gll[j] * ((dim == 3) ? w_gll[k] : 1.0);
+
+        mass_fact[v] = (DType)(weight * std::abs(jacobian));
+    }
+}
+
+// Memory
+template<typename DType>
+long long Element<DType>::memory_usage()
+{
+    long long num_bytes = 0;
+
+    num_bytes += (x.capacity() + y.capacity() + z.capacity()) * sizeof(DType);
+    num_bytes += dirichlet_mask.capacity() * sizeof(DType);
+
+    for (int g = 0; g < NUM_GEOM_FACTS; g++)
+        num_bytes += geom_fact[g].capacity() * sizeof(DType);
+
+    num_bytes += mass_fact.capacity() * sizeof(DType);
+
+    num_bytes += loc_num.capacity() * sizeof(int);
+    num_bytes += (glo_num.capacity() + dof_num.capacity()) * sizeof(long long);
+
+    for (auto conn : { &vert_conn, &edge_conn, &face_conn })
+        num_bytes += (conn->ptr.capacity() + conn->neighbors.capacity()) * sizeof(int);
+
+    return num_bytes;
+}
+
+template<typename DType>
+void Element<DType>::release(bool keep_mesh)
+{
+    // Coordinates and local numbering are only needed for visualization
+    if (!keep_mesh)
+    {
+        std::vector<DType>().swap(x);
+        std::vector<DType>().swap(y);
+        std::vector<DType>().swap(z);
+        std::vector<int>().swap(loc_num);
+    }
+
+    std::vector<DType>().swap(dirichlet_mask);
+
+    for (int g = 0; g < NUM_GEOM_FACTS; g++)
+        std::vector<DType>().swap(geom_fact[g]);
+
+    std::vector<DType>().swap(mass_fact);
+
+    std::vector<long long>().swap(glo_num);
+    std::vector<long long>().swap(dof_num);
+    vert_conn = Element_Connectivity();
+    edge_conn = Element_Connectivity();
+    face_conn = Element_Connectivity();
+}
@@ -0,0 +1,77 @@
+/*
+ * Gather-scatter header file
+ */
+
+// Headers
+#include <vector>
+#include "config.hpp"
+
+extern "C"
+{
+    #define PREFIX gslib_
+    #define MPI
+    #define GLOBAL_LONG_LONG
+    #include "name.h"
+    #include "fail.h"
+    #include "c99.h"
+    #include "types.h"
+    #include "comm.h"
+    #include "gs_defs.h"
+    #include "mem.h"
+    #include "gs.h"
+}
+
+// Class declaration
+#ifndef GATHER_SCATTER_HPP
+#define GATHER_SCATTER_HPP
+
+template<typename DType>
+class Gather_Scatter
+{
+    private:
+        // Inter-node exchange (every rank when the node-aware mode is off)
+        struct comm gs_comm;
+        struct gs_data *gs_handle = NULL;
+        gs_dom gs_type = (typeid(DType) == typeid(double)) ? gs_double : gs_float;
+
+        // Node communicators
+        MPI_Comm node_comm = MPI_COMM_NULL;
+        MPI_Comm leader_comm = MPI_COMM_NULL;
+        int node_rank = 0;
+        int node_size = 1;
+
+        // Shared window: contributions of all node ranks followed by the node values
+        MPI_Win window;
+        DType *node_contributions = NULL;
+        DType *node_values = NULL;
+
+        int num_values = 0;
+        int num_node_ids = 0;
+        int contribution_offset = 0;
+
+        std::vector<int> node_slot;
+        std::vector<int> reduction_ptr;
+        std::vector<int> reduction_idx;
+        int slot_start = 0;
+        int slot_end = 0;
+
+        // Reduced precision exchange
+        std::vector<float> wire;
+        void exchange(DType*, int, bool);
+
+    public:
+        // Member variables
+        bool node_aware = false;
+
+        // Constructor and destructor
+        Gather_Scatter();
+        ~Gather_Scatter();
+
+        // Member functions
+        void setup(long long*, int, bool = (GATHER_SCATTER == 1));
+        void apply(DType*, bool = false);
+};
+
+#include "gather_scatter.tpp"
+
+#endif
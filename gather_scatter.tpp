@@ -0,0 +1,210 @@
+/*
+ * Gather-scatter template file
+ */
+
+// Headers
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+// Constructor and destructor
+template<typename DType>
+Gather_Scatter<DType>::Gather_Scatter()
+{
+
+}
+
+template<typename DType>
+Gather_Scatter<DType>::~Gather_Scatter()
+{
+    // Handles left after MPI_Finalize can no longer be released
+    int finalized;
+    MPI_Finalized(&finalized);
+
+    if (finalized) return;
+
+    if (gs_handle != NULL)
+    {
+        gslib_gs_free(gs_handle);
+        comm_free(&gs_comm);
+    }
+
+    if (node_aware)
+    {
+        MPI_Win_unlock_all(window);
+        MPI_Win_free(&window);
+    }
+
+    if (leader_comm != MPI_COMM_NULL) MPI_Comm_free(&leader_comm);
+    if (node_comm != MPI_COMM_NULL) MPI_Comm_free(&node_comm);
+}
+
+/*
+ * Same conventions as gslib: an id of zero is ignored and a negative id receives the sum without contributing to it
+ */
+template<typename DType>
+void Gather_Scatter<DType>::setup(long long *ids, int num_values_, bool node_aware_)
+{
+    num_values = num_values_;
+    node_aware = node_aware_;
+
+    if (not node_aware)
+    {
+        comm_init(&gs_comm, MPI_COMM_WORLD);
+        gs_handle = gslib_gs_setup(ids, num_values, &gs_comm, 0, gs_auto, 1);
+
+        return;
+    }
+
+    // Node communicators
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, proc_id, MPI_INFO_NULL, &node_comm);
+    MPI_Comm_rank(node_comm, &node_rank);
+    MPI_Comm_size(node_comm, &node_size);
+    MPI_Comm_split(MPI_COMM_WORLD, (node_rank == 0) ? 0 : MPI_UNDEFINED, proc_id, &leader_comm);
+
+    // Ids of every rank on the node
+    std::vector<int> node_count(node_size);
+    std::vector<int> node_offset(node_size);
+
+    MPI_Allgather(&num_values, 1, MPI_INT, node_count.data(), 1, MPI_INT, node_comm);
+    for (int r = 1; r < node_size; r++) node_offset[r] = node_offset[r - 1] + node_count[r - 1];
+
+    int num_contributions = node_offset[node_size - 1] + node_count[node_size - 1];
+    contribution_offset = node_offset[node_rank];
+
+    std::vector<long long> node_ids(num_contributions);
+    MPI_Allgatherv(ids, num_values, MPI_LONG_LONG, node_ids.data(), node_count.data(), node_offset.data(), MPI_LONG_LONG, node_comm);
+
+    // Node numbering of the unique ids
+    std::vector<long long> unique_ids;
+    unique_ids.reserve(num_contributions);
+
+    for (auto id : node_ids)
+        if (id != 0) unique_ids.push_back(std::abs(id));
+
+    std::sort(unique_ids.begin(), unique_ids.end());
+    unique_ids.erase(std::unique(unique_ids.begin(), unique_ids.end()), unique_ids.end());
+    num_node_ids = (int)(unique_ids.size());
+
+    std::unordered_map<long long, int> slot_of;
+    for (int s = 0; s < num_node_ids; s++) slot_of[unique_ids[s]] = s;
+
+    node_slot.resize(num_values);
+    for (int i = 0; i < num_values; i++) node_slot[i] = (ids[i] != 0) ? slot_of[std::abs(ids[i])] : - 1;
+
+    // Each node rank reduces a contiguous block of slots
+    slot_start = (int)(((long long)(num_node_ids) * node_rank) / node_size);
+    slot_end = (int)(((long long)(num_node_ids) * (node_rank + 1)) / node_size);
+
+    reduction_ptr.assign(slot_end - slot_start + 1, 0);
+
+    for (auto id : node_ids)
+    {
+        if (id <= 0) continue;
+
+        int s = slot_of[id];
+        if ((s >= slot_start) and (s < slot_end)) reduction_ptr[s - slot_start + 1]++;
+    }
+
+    for (int s = 0; s < slot_end - slot_start; s++) reduction_ptr[s + 1] += reduction_ptr[s];
+
+    reduction_idx.resize(reduction_ptr[slot_end - slot_start]);
+    std::vector<int> position(reduction_ptr.begin(), reduction_ptr.end() - 1);
+
+    for (int c = 0; c < num_contributions; c++)
+    {
+        if (node_ids[c] <= 0) continue;
+
+        int s = slot_of[node_ids[c]];
+        if ((s >= slot_start) and (s < slot_end)) reduction_idx[position[s - slot_start]++] = c;
+    }
+
+    // Shared window owned by the node leader
+    MPI_Aint window_size = (node_rank == 0) ? (MPI_Aint)(num_contributions + num_node_ids) * sizeof(DType) : 0;
+    DType *window_base;
+
+    MPI_Win_allocate_shared(window_size, sizeof(DType), MPI_INFO_NULL, node_comm, &window_base, &window);
+
+    int disp_unit;
+    MPI_Win_shared_query(window, 0, &window_size, &disp_unit, &window_base);
+
+    node_contributions = window_base;
+    node_values = window_base + num_contributions;
+
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, window);
+
+    // Inter-node exchange of the node values
+    if (node_rank == 0)
+    {
+        comm_init(&gs_comm, leader_comm);
+        gs_handle = gslib_gs_setup(unique_ids.data(), num_node_ids, &gs_comm, 0, gs_auto, 1);
+    }
+}
+
+/*
+ * A reduced exchange sums float copies and only adds the rounded difference, so values without neighbors stay exact
+ */
+template<typename DType>
+void Gather_Scatter<DType>::exchange(DType *u, int n, bool reduced)
+{
+    if ((not reduced) or (typeid(DType) == typeid(float)))
+    {
+        gslib_gs(u, gs_type, gs_add, 0, gs_handle, NULL);
+
+        return;
+    }
+
+    wire.resize(n);
+    for (int i = 0; i < n; i++) wire[i] = (float)(u[i]);
+
+    gslib_gs(wire.data(), gs_float, gs_add, 0, gs_handle, NULL);
+
+    for (int i = 0; i < n; i++) u[i] += (DType)(wire[i]) - (DType)((float)(u[i]));
+}
+
+template<typename DType>
+void Gather_Scatter<DType>::apply(DType *u, bool reduced)
+{
+    if (not node_aware)
+    {
+        exchange(u, num_values, reduced);
+
+        return;
+    }
+
+    // Publish local values
+    memcpy(node_contributions + contribution_offset, u, num_values * sizeof(DType));
+
+    MPI_Win_sync(window);
+    MPI_Barrier(node_comm);
+    MPI_Win_sync(window);
+
+    // Intra-node reduction
+    for (int s = slot_start; s < slot_end; s++)
+    {
+        DType sum = 0.0;
+
+        for (int idx = reduction_ptr[s - slot_start]; idx < reduction_ptr[s - slot_start + 1]; idx++)
+            sum += node_contributions[reduction_idx[idx]];
+
+        node_values[s] = sum;
+    }
+
+    MPI_Win_sync(window);
+    MPI_Barrier(node_comm);
+
+    // Inter-node reduction (one message per pair of nodes)
+    if (node_rank == 0)
+    {
+        MPI_Win_sync(window);
+        exchange(node_values, num_node_ids, reduced);
+        MPI_Win_sync(window);
+    }
+
+    MPI_Barrier(node_comm);
+    MPI_Win_sync(window);
+
+    // Scatter back
+    for (int i = 0; i < num_values; i++)
+        if (node_slot[i] >= 0) u[i] = node_values[node_slot[i]];
+}
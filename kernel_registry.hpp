@@ -0,0 +1,38 @@
+/*
+ * Kernel registry class declaration
+ */
+
+// Headers
+#include <string>
+#include <occa.hpp>
+#include <unordered_map>
+
+// Class definition
+#ifndef KERNEL_REGISTRY_HPP
+#define KERNEL_REGISTRY_HPP
+
+template<typename KType = occa::kernel>
+class Kernel_Registry
+{
+    private:
+        // Member variables
+        std::unordered_map<std::string, KType> kernels;
+
+    public:
+        // Member variables
+        int scope = 0;
+        int num_builds = 0;
+        int num_lookups = 0;
+
+        // Constructor
+        Kernel_Registry();
+        ~Kernel_Registry();
+
+        // Utility functions
+        KType get(const char*, const char*, const occa::properties&);
+        void clear();
+};
+
+#include "kernel_registry.tpp"
+
+#endif
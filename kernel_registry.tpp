@@ -0,0 +1,57 @@
+/*
+ * Kernel registry definition
+ */
+
+// Headers
+#include "kernel_registry.hpp"
+
+// Functions definition
+template<typename KType>
+Kernel_Registry<KType>::Kernel_Registry()
+{
+
+}
+
+template<typename KType>
+Kernel_Registry<KType>::~Kernel_Registry()
+{
+
+}
+
+template<typename KType>
+KType Kernel_Registry<KType>::get(const char *source, const char *name, const occa::properties &properties)
+{
+    // Objects that run on different threads are given different scopes so they never share a kernel
+    std::string key = std::to_string(scope) + ":" + source + ":" + name + ":" + properties.toString();
+
+    num_lookups++;
+
+    auto it = kernels.find(key);
+    if (it != kernels.end()) return it->second;
+
+    // Every rank asks for the same kernels in the same order, so a miss is collective
+    KType kernel;
+
+#if KERNEL_CACHE_WARM == 1
+    kernel = device.buildKernel(source, name, properties);
+#else
+    if (proc_id == 0) kernel = device.buildKernel(source, name, properties);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    if (proc_id > 0) kernel = device.buildKernel(source, name, properties);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+#endif
+
+    num_builds++;
+    kernels[key] = kernel;
+
+    return kernel;
+}
+
+template<typename KType>
+void Kernel_Registry<KType>::clear()
+{
+    kernels.clear();
+}
@@ -3,6 +3,10 @@
  */
 
 // Headers
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
 #include "config.hpp"
 
 // Functions declaration
@@ -31,6 +35,9 @@ class Math
         void matrix_matrix_multiply(DType*, const DType*, const DType*, int, int, int, bool = false, bool = false);
         void vector_vector_addition(occa::memory&, const DType, const occa::memory&, const DType, const occa::memory&, const int);
         void vector_scaling(occa::memory&, const DType, const occa::memory&, const int);
+
+        template<typename VType>
+        void symmetric_eigensolver(VType*, VType*, const VType*, int);
 };
 
 #include "math.tpp"
@@ -15,25 +15,10 @@ Math<DType>::Math()
 
     properties["defines/BLOCK_SIZE"] = BLOCK_SIZE;
 
-    if (proc_id == 0)
-    {
-        set_to_value_kernel = device.buildKernel("math.okl", "set_to_value", properties);
-        invert_vector_elements_kernel = device.buildKernel("math.okl", "invert_vector_elements", properties);
-        vector_vector_addition_kernel = device.buildKernel("math.okl", "vector_vector_addition", properties);
-        vector_scaling_kernel = device.buildKernel("math.okl", "vector_scaling", properties);
-    }
-    
-    MPI_Barrier(MPI_COMM_WORLD);
-
-    if (proc_id > 0)
-    {
-        set_to_value_kernel = device.buildKernel("math.okl", "set_to_value", properties);
-        invert_vector_elements_kernel = device.buildKernel("math.okl", "invert_vector_elements", properties);
-        vector_vector_addition_kernel = device.buildKernel("math.okl", "vector_vector_addition", properties);
-        vector_scaling_kernel = device.buildKernel("math.okl", "vector_scaling", properties);
-    }
-
-    MPI_Barrier(MPI_COMM_WORLD);
+    set_to_value_kernel = kernel_registry.get("math.okl", "set_to_value", properties);
+    invert_vector_elements_kernel = kernel_registry.get("math.okl", "invert_vector_elements", properties);
+    vector_vector_addition_kernel = kernel_registry.get("math.okl", "vector_vector_addition", properties);
+    vector_scaling_kernel = kernel_registry.get("math.okl", "vector_scaling", properties);
 }
 
 template<typename DType>
@@ -90,3 +75,87 @@ void Math<DType>::matrix_matrix_multiply(DType *C, const DType *A, const DType *
         quit();
     }
 }
+
+// Cyclic Jacobi rotations for small dense symmetric matrices (eigenvalues ascending, V[i * n + k] is entry i of eigenvector k)
+template<typename DType>
+template<typename VType>
+void Math<DType>::symmetric_eigensolver(VType *V, VType *lambda, const VType *A, int n)
+{
+    std::vector<VType> B(A, A + n * n);
+
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+            V[i * n + j] = (i == j) ? 1.0 : 0.0;
+
+    for (int sweep = 0; sweep < 100; sweep++)
+    {
+        VType off = 0.0;
+        VType norm = 0.0;
+
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                if (i != j) off += B[i * n + j] * B[i * n + j];
+                norm += B[i * n + j] * B[i * n + j];
+            }
+        }
+
+        if (off <= std::numeric_limits<VType>::epsilon() * std::numeric_limits<VType>::epsilon() * norm) break;
+
+        for (int p = 0; p < n - 1; p++)
+        {
+            for (int q = p + 1; q < n; q++)
+            {
+                if (B[p * n + q] == 0.0) continue;
+
+                VType theta = (B[q * n + q] - B[p * n + p]) / (2.0 * B[p * n + q]);
+                VType t = ((theta >= 0.0) ? 1.0 : - 1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                VType c = 1.0 / std::sqrt(t * t + 1.0);
+                VType s = t * c;
+
+                for (int k = 0; k < n; k++)
+                {
+                    VType B_kp = B[k * n + p];
+                    VType B_kq = B[k * n + q];
+
+                    B[k * n + p] = c * B_kp - s * B_kq;
+                    B[k * n + q] = s * B_kp + c * B_kq;
+                }
+
+                for (int k = 0; k < n; k++)
+                {
+                    VType B_pk = B[p * n + k];
+                    VType B_qk = B[q * n + k];
+
+                    B[p * n + k] = c * B_pk - s * B_qk;
+                    B[q * n + k] = s * B_pk + c * B_qk;
+                }
+
+                for (int k = 0; k < n; k++)
+                {
+                    VType V_kp = V[k * n + p];
+                    VType V_kq = V[k * n + q];
+
+                    V[k * n + p] = c * V_kp - s * V_kq;
+                    V[k * n + q] = s * V_kp + c * V_kq;
+                }
+            }
+        }
+    }
+
+    // Sort eigenpairs
+    std::vector<int> order(n);
+    for (int k = 0; k < n; k++) order[k] = k;
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return B[a * n + a] < B[b * n + b]; });
+
+    std::vector<VType> V_unsorted(V, V + n * n);
+
+    for (int k = 0; k < n; k++)
+    {
+        lambda[k] = B[order[k] * n + order[k]];
+
+        for (int i = 0; i < n; i++)
+            V[i * n + k] = V_unsorted[i * n + order[k]];
+    }
+}
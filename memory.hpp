@@ -0,0 +1,42 @@
+/*
+ * Memory class declaration
+ */
+
+// Headers
+#include <vector>
+#include <occa.hpp>
+#include <cstring>
+#include <unordered_map>
+
+// Class definition
+#ifndef MEMORY_HPP
+#define MEMORY_HPP
+
+template<typename IType = long long>
+class Memory
+{
+    private:
+        // Member variables
+        std::unordered_map<const char*, std::vector<IType>> m_total;
+
+    public:
+        // Constructor
+        Memory();
+        ~Memory();
+
+        // Utility functions
+        void add(const char*, IType);
+        void add(const char*, occa::memory&);
+        void reset(const char*);
+        void gather(const char*);
+        IType total(const char*);
+        IType total(const char*, const char*);
+        void total(const char*, std::string&);
+
+        template<typename VType>
+        void add(const char*, const std::vector<VType>&);
+};
+
+#include "memory.tpp"
+
+#endif
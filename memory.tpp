@@ -0,0 +1,115 @@
+/*
+ * Memory definition
+ */
+
+// Headers
+#include <algorithm>
+#include "memory.hpp"
+
+// Functions definition
+template<typename IType>
+Memory<IType>::Memory()
+{
+
+}
+
+template<typename IType>
+Memory<IType>::~Memory()
+{
+
+}
+
+template<typename IType>
+void Memory<IType>::add(const char *name, IType num_bytes)
+{
+    if (m_total.find(name) == m_total.end()) m_total[name].resize(num_procs);
+
+    m_total[name][proc_id] += num_bytes;
+}
+
+template<typename IType>
+void Memory<IType>::add(const char *name, occa::memory &data)
+{
+    add(name, (IType)(data.size()));
+}
+
+template<typename IType>
+template<typename VType>
+void Memory<IType>::add(const char *name, const std::vector<VType> &data)
+{
+    add(name, (IType)(data.capacity() * sizeof(VType)));
+}
+
+template<typename IType>
+void Memory<IType>::reset(const char *name)
+{
+    if (m_total.find(name) == m_total.end()) m_total[name].resize(num_procs);
+
+    for (int p = 0; p < num_procs; p++)
+        m_total[name][p] = 0;
+}
+
+template<typename IType>
+void Memory<IType>::gather(const char *name)
+{
+    // Each rank only fills its own entry, so a maximum reduction collects all of them
+    if (m_total.find(name) == m_total.end()) m_total[name].resize(num_procs);
+
+    MPI_Allreduce(MPI_IN_PLACE, m_total[name].data(), num_procs, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+}
+
+template<typename IType>
+IType Memory<IType>::total(const char *name)
+{
+    if (m_total.find(name) == m_total.end()) return 0;
+
+    return m_total[name][proc_id];
+}
+
+template<typename IType>
+IType Memory<IType>::total(const char *name, const char *type)
+{
+    if (m_total.find(name) == m_total.end()) return 0;
+
+    if (!strcmp(type, "mean"))
+    {
+        IType m_sum = 0;
+
+        for (int p = 0; p < num_procs; p++)
+            m_sum += m_total[name][p];
+
+        return m_sum / (IType)(num_procs);
+    }
+    else if (!strcmp(type, "max"))
+    {
+        IType m_max = 0;
+
+        for (int p = 0; p < num_procs; p++)
+            m_max = std::max(m_max, m_total[name][p]);
+
+        return m_max;
+    }
+    else
+    {
+        return - 1;
+    }
+}
+
+template<typename IType>
+void Memory<IType>::total(const char *name, std::string &output)
+{
+    char word[80];
+    output.clear();
+
+    if (m_total.find(name) == m_total.end()) m_total[name].resize(num_procs);
+
+    for (int p = 0; p < num_procs; p++)
+    {
+        if (p < num_procs - 1)
+            sprintf(word, "%10.02f ", (double)(m_total[name][p]) / (1024.0 * 1024.0));
+        else
+            sprintf(word, "%10.02f", (double)(m_total[name][p]) / (1024.0 * 1024.0));
+
+        output += word;
+    }
+}
@@ -0,0 +1,60 @@
+/*
+ * Memory arena header file
+ */
+
+// Headers
+#include <vector>
+#include <occa.hpp>
+
+// Class definition
+#ifndef MEMORY_ARENA_HPP
+#define MEMORY_ARENA_HPP
+
+// Lifetime phases of the arena workspaces (every rank and subdomain part goes through them in this order)
+#define PHASE_DOMAIN_SETUP 0
+#define PHASE_SUBDOMAIN_SETUP 1
+#define PHASE_SOLVE 2
+
+template<typename IType = long long>
+class Memory_Arena
+{
+    private:
+        // Named device workspace live from 'first_phase' to 'last_phase' (inclusive)
+        struct Request
+        {
+            const char *name;
+            IType num_bytes;
+            int first_phase;
+            int last_phase;
+            int chunk = - 1;
+            IType offset = 0;
+        };
+
+        std::vector<Request> requests;
+        std::vector<occa::memory> chunks;
+        std::vector<IType> chunk_size;
+        int num_planned = 0;
+
+        IType first_fit(int, int, IType);
+
+    public:
+        // Constructor
+        Memory_Arena();
+        ~Memory_Arena();
+
+        // Member functions
+        int request(const char*, IType, int, int);
+        void plan();
+
+        template<typename T>
+        occa::memory get(int);
+
+        // Memory
+        IType peak();
+        IType requested();
+        IType live(int);
+};
+
+#include "memory_arena.tpp"
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * Memory arena template file
+ */
+
+// Headers
+#include <algorithm>
+#include "memory_arena.hpp"
+
+// Constructor and destructor
+template<typename IType>
+Memory_Arena<IType>::Memory_Arena()
+{
+
+}
+
+template<typename IType>
+Memory_Arena<IType>::~Memory_Arena()
+{
+
+}
+
+// Member functions
+template<typename IType>
+int Memory_Arena<IType>::request(const char *name, IType num_bytes, int first_phase, int last_phase)
+{
+    Request r;
+
+    r.name = name;
+    r.num_bytes = ((num_bytes + 255) / 256) * 256;
+    r.first_phase = first_phase;
+    r.last_phase = last_phase;
+
+    requests.push_back(r);
+
+    return (int)(requests.size()) - 1;
+}
+
+// Lowest offset of chunk 'c' where request 'r' overlaps no placed request with a common phase (- 1 if it does not fit in 'capacity')
+template<typename IType>
+IType Memory_Arena<IType>::first_fit(int r, int c, IType capacity)
+{
+    std::vector<std::pair<IType, IType>> taken;
+
+    for (auto &other : requests)
+    {
+        if (other.chunk != c) continue;
+        if ((other.last_phase < requests[r].first_phase) or (requests[r].last_phase < other.first_phase)) continue;
+
+        taken.push_back({ other.offset, other.offset + other.num_bytes });
+    }
+
+    std::sort(taken.begin(), taken.end());
+
+    IType offset = 0;
+
+    for (auto &range : taken)
+    {
+        if (offset + requests[r].num_bytes <= range.first) break;
+        offset = std::max(offset, range.second);
+    }
+
+    if ((capacity >= 0) and (offset + requests[r].num_bytes > capacity)) return - 1;
+
+    return offset;
+}
+
+// Places the requests made since the last call (largest first) and allocates a new chunk only for the ones that do not fit
+// (every owner makes all its requests before a single call, so a batch is packed as a whole)
+template<typename IType>
+void Memory_Arena<IType>::plan()
+{
+    std::vector<int> pending;
+
+    for (int r = num_planned; r < (int)(requests.size()); r++)
+        if ((requests[r].num_bytes > 0) and (requests[r].first_phase <= requests[r].last_phase))
+            pending.push_back(r);
+
+    num_planned = requests.size();
+
+    std::stable_sort(pending.begin(), pending.end(), [&](int a, int b) { return requests[a].num_bytes > requests[b].num_bytes; });
+
+    int new_chunk = chunks.size();
+    IType new_size = 0;
+
+    for (auto r : pending)
+    {
+        for (int c = 0; c < new_chunk; c++)
+        {
+            IType offset = first_fit(r, c, chunk_size[c]);
+
+            if (offset >= 0)
+            {
+                requests[r].chunk = c;
+                requests[r].offset = offset;
+                break;
+            }
+        }
+
+        if (requests[r].chunk < 0)
+        {
+            requests[r].offset = first_fit(r, new_chunk, - 1);
+            requests[r].chunk = new_chunk;
+            new_size = std::max(new_size, requests[r].offset + requests[r].num_bytes);
+        }
+    }
+
+    if (new_size > 0)
+    {
+        chunks.push_back(device_malloc<char>(new_size));
+        chunk_size.push_back(new_size);
+    }
+}
+
+// Typed view of a planned request (valid for the whole run, only the phases of the request may touch it)
+template<typename IType>
+template<typename T>
+occa::memory Memory_Arena<IType>::get(int r)
+{
+    if (r >= num_planned)
+    {
+        pstdout("Memory arena request '%s' taken before it was planned\n", requests[r].name);
+        quit();
+    }
+
+    if (requests[r].chunk < 0) return occa::memory();
+
+    return chunks[requests[r].chunk].slice(requests[r].offset, requests[r].num_bytes).cast(occa::dtype::get<T>());
+}
+
+// Memory
+template<typename IType>
+IType Memory_Arena<IType>::peak()
+{
+    IType total = 0;
+    for (auto size : chunk_size) total += size;
+
+    return total;
+}
+
+template<typename IType>
+IType Memory_Arena<IType>::requested()
+{
+    IType total = 0;
+
+    for (auto &r : requests)
+        if (r.first_phase <= r.last_phase)
+            total += r.num_bytes;
+
+    return total;
+}
+
+template<typename IType>
+IType Memory_Arena<IType>::live(int phase)
+{
+    IType total = 0;
+
+    for (auto &r : requests)
+        if ((r.first_phase <= phase) and (phase <= r.last_phase))
+            total += r.num_bytes;
+
+    return total;
+}
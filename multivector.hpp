@@ -0,0 +1,57 @@
+/*
+ * Multivector header file
+ */
+
+// Headers
+#include <vector>
+#include "config.hpp"
+
+// Class declaration
+#ifndef MULTIVECTOR_HPP
+#define MULTIVECTOR_HPP
+
+// Krylov basis stored contiguously by columns (leading dimension padded to 256 bytes)
+template<typename DType>
+class Multivector
+{
+    private:
+        // Storage
+        occa::memory data;
+        std::vector<occa::memory> columns;
+        bool arena_storage = false;
+        int arena_handle = - 1;
+
+        // Coefficients and partial sums of the block kernels
+        occa::memory coefs_dev;
+        occa::memory block_dev;
+        std::vector<DType> block_hst;
+        int num_blocks = 0;
+
+        // Kernels
+        occa::kernel linear_combination_kernel;
+        occa::kernel multi_dot_kernel;
+
+    public:
+        // Member variables
+        int num_rows = 0;
+        int num_cols = 0;
+        int ld = 0;
+
+        // Constructor and destructor
+        Multivector();
+        Multivector(int, int);
+        ~Multivector();
+
+        void request(int, int, int, int);
+        void initialize(int, int);
+
+        // Member functions
+        occa::memory& operator[](int);
+        void linear_combination(occa::memory&, const DType*, int);
+        void multi_dot(DType*, occa::memory&, occa::memory&, int);
+        long long memory_usage();
+};
+
+#include "multivector.tpp"
+
+#endif
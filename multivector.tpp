@@ -0,0 +1,110 @@
+/*
+ * Multivector template file
+ */
+
+// Headers
+#include "multivector.hpp"
+
+// Constructor and destructor
+template<typename DType>
+Multivector<DType>::Multivector()
+{
+
+}
+
+template<typename DType>
+Multivector<DType>::Multivector(int num_rows_, int num_cols_)
+{
+    initialize(num_rows_, num_cols_);
+}
+
+template<typename DType>
+Multivector<DType>::~Multivector()
+{
+
+}
+
+// Arena storage for the lifetime phases (the columns are taken in initialize, once the owner has planned the arena)
+template<typename DType>
+void Multivector<DType>::request(int num_rows_, int num_cols_, int first_phase, int last_phase)
+{
+    int align = 256 / sizeof(DType);
+    long long ld_ = ((num_rows_ + align - 1) / align) * align;
+
+    arena_handle = arena.request("multivector", ld_ * num_cols_ * sizeof(DType), first_phase, last_phase);
+}
+
+// Storage comes from the arena when it was requested beforehand
+template<typename DType>
+void Multivector<DType>::initialize(int num_rows_, int num_cols_)
+{
+    int align = 256 / sizeof(DType);
+
+    num_rows = num_rows_;
+    num_cols = num_cols_;
+    ld = ((num_rows + align - 1) / align) * align;
+    num_blocks = (num_rows + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    arena_storage = (arena_handle >= 0);
+
+    if (arena_storage)
+        data = arena.get<DType>(arena_handle);
+    else
+        data = device_malloc<DType>((long long)(ld) * num_cols);
+
+    // Storage whose lifetime is empty is never allocated and leaves the columns empty
+    columns.assign(num_cols, occa::memory());
+    if (data.isInitialized()) for (int c = 0; c < num_cols; c++) columns[c] = data.slice((long long)(c) * ld, num_rows);
+
+    coefs_dev = device_malloc<DType>(num_cols);
+    block_dev = device_malloc<DType>(num_cols * num_blocks);
+    block_hst.resize(num_cols * num_blocks);
+
+    // Kernels
+    occa::properties properties;
+
+    properties["defines/DType"] = (typeid(DType) == typeid(double)) ? "double" : "float";
+    properties["defines/BLOCK_SIZE"] = BLOCK_SIZE;
+
+    linear_combination_kernel = kernel_registry.get("multivector.okl", "linear_combination", properties);
+    multi_dot_kernel = kernel_registry.get("multivector.okl", "multi_dot", properties);
+}
+
+// Member functions
+template<typename DType>
+occa::memory& Multivector<DType>::operator[](int c)
+{
+    return columns[c];
+}
+
+// u += V(:, 0:n) * c in one pass over u
+template<typename DType>
+void Multivector<DType>::linear_combination(occa::memory &u, const DType *c, int n)
+{
+    if ((n == 0) or (num_rows == 0)) return;
+
+    coefs_dev.copyFrom(c, n * sizeof(DType));
+    linear_combination_kernel(u, data, coefs_dev, ld, num_rows, n);
+}
+
+// uv = V(:, 0:n)^T (weight .* u), reduced on this rank only
+template<typename DType>
+void Multivector<DType>::multi_dot(DType *uv, occa::memory &u, occa::memory &weight, int n)
+{
+    for (int c = 0; c < n; c++) uv[c] = 0.0;
+    if ((n == 0) or (num_rows == 0)) return;
+
+    multi_dot_kernel(block_dev, data, u, weight, ld, num_rows, n, num_blocks);
+    block_dev.copyTo(block_hst.data(), n * num_blocks * sizeof(DType));
+
+    for (int c = 0; c < n; c++)
+        for (int b = 0; b < num_blocks; b++)
+            uv[c] += block_hst[c * num_blocks + b];
+}
+
+template<typename DType>
+long long Multivector<DType>::memory_usage()
+{
+    // Arena storage is reported by the arena
+    return (long long)((arena_storage ? 0 : data.size()) + coefs_dev.size() + block_dev.size());
+}
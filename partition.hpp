@@ -0,0 +1,49 @@
+/*
+ * Partition header file
+ */
+
+// Headers
+#include <cmath>
+#include <vector>
+#include "config.hpp"
+#include "element.hpp"
+#include "reordering.hpp"
+
+// Class declaration
+#ifndef PARTITION_HPP
+#define PARTITION_HPP
+
+struct Migration_Plan
+{
+    std::vector<int> send_elements;
+    std::vector<int> send_count;
+    std::vector<int> recv_count;
+    std::vector<int> recv_position;
+};
+
+// Element on the Hilbert curve, ordered by key and then by its owner's numbering
+struct Curve_Element
+{
+    unsigned long long key;
+    double weight;
+    int owner;
+    int index;
+    int destination;
+
+    bool operator<(const Curve_Element &other) const
+    {
+        if (key != other.key) return key < other.key;
+        if (owner != other.owner) return owner < other.owner;
+        return index < other.index;
+    }
+};
+
+template<typename DType>
+void weighted_curve_partition(Migration_Plan&, const std::vector<Element<DType>>&, const std::vector<double>&, int);
+
+template<typename DType>
+void migrate_elements(std::vector<Element<DType>>&, std::vector<int>&, const Migration_Plan&, int, int);
+
+#include "partition.tpp"
+
+#endif
@@ -0,0 +1,257 @@
+/*
+ * Partition template file
+ */
+
+// Headers
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include "partition.hpp"
+
+// Cut the global Hilbert curve of the element centroids into pieces of equal weight (sample sorted, each rank only holds its own piece)
+template<typename DType>
+void weighted_curve_partition(Migration_Plan &plan, const std::vector<Element<DType>> &elements, const std::vector<double> &weight, int dim)
+{
+    int num_local_elements = elements.size();
+
+    std::vector<unsigned long long> key;
+    hilbert_keys(key, elements, dim, true);
+
+    std::vector<Curve_Element> local(num_local_elements);
+    for (int e = 0; e < num_local_elements; e++) local[e] = { key[e], weight[e], proc_id, e, 0 };
+
+    std::sort(local.begin(), local.end());
+
+    MPI_Datatype curve_type;
+    MPI_Type_contiguous(sizeof(Curve_Element), MPI_BYTE, &curve_type);
+    MPI_Type_commit(&curve_type);
+
+    // Personalized exchange that keeps the order of the elements sent to each rank
+    auto exchange = [&](std::vector<Curve_Element> &recv, const std::vector<Curve_Element> &send, const std::vector<int> &target)
+    {
+        std::vector<int> send_count(num_procs, 0), send_offset(num_procs, 0);
+        std::vector<int> recv_count(num_procs), recv_offset(num_procs, 0);
+
+        for (int t : target) send_count[t]++;
+
+        MPI_Alltoall(send_count.data(), 1, MPI_INT, recv_count.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+        for (int p = 1; p < num_procs; p++)
+        {
+            send_offset[p] = send_offset[p - 1] + send_count[p - 1];
+            recv_offset[p] = recv_offset[p - 1] + recv_count[p - 1];
+        }
+
+        std::vector<Curve_Element> send_grouped(send.size());
+        std::vector<int> position = send_offset;
+
+        for (size_t s = 0; s < send.size(); s++) send_grouped[position[target[s]]++] = send[s];
+
+        recv.resize(recv_offset[num_procs - 1] + recv_count[num_procs - 1]);
+
+        MPI_Alltoallv(send_grouped.data(), send_count.data(), send_offset.data(), curve_type, recv.data(), recv_count.data(), recv_offset.data(), curve_type, MPI_COMM_WORLD);
+    };
+
+    // Splitters from regular samples of the sorted local pieces
+    std::vector<Curve_Element> sample;
+
+    if (num_local_elements > 0)
+        for (int s = 0; s < num_procs; s++)
+            sample.push_back(local[(long long)(s) * num_local_elements / num_procs]);
+
+    int num_samples = sample.size();
+    std::vector<int> sample_count(num_procs);
+    std::vector<int> sample_offset(num_procs, 0);
+
+    MPI_Allgather(&num_samples, 1, MPI_INT, sample_count.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    for (int p = 1; p < num_procs; p++) sample_offset[p] = sample_offset[p - 1] + sample_count[p - 1];
+
+    int num_total_samples = sample_offset[num_procs - 1] + sample_count[num_procs - 1];
+    std::vector<Curve_Element> sample_total(num_total_samples);
+
+    MPI_Allgatherv(sample.data(), num_samples, curve_type, sample_total.data(), sample_count.data(), sample_offset.data(), curve_type, MPI_COMM_WORLD);
+    std::sort(sample_total.begin(), sample_total.end());
+
+    std::vector<Curve_Element> splitter;
+
+    if (num_total_samples > 0)
+        for (int p = 1; p < num_procs; p++)
+            splitter.push_back(sample_total[(long long)(p) * num_total_samples / num_procs]);
+
+    // Every rank gets a contiguous segment of the curve
+    std::vector<int> target(num_local_elements);
+    for (int e = 0; e < num_local_elements; e++) target[e] = std::upper_bound(splitter.begin(), splitter.end(), local[e]) - splitter.begin();
+
+    std::vector<Curve_Element> segment;
+    exchange(segment, local, target);
+    std::sort(segment.begin(), segment.end());
+
+    // Curve position and weight in front of the segment
+    int num_segment_elements = segment.size();
+    double segment_weight = 0.0;
+    for (auto &elem : segment) segment_weight += elem.weight;
+
+    int segment_start = 0;
+    double weight_start = 0.0;
+
+    MPI_Exscan(&num_segment_elements, &segment_start, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Exscan(&segment_weight, &weight_start, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    if (proc_id == 0)
+    {
+        segment_start = 0;
+        weight_start = 0.0;
+    }
+
+    int num_total_elements;
+    double total_weight;
+
+    MPI_Allreduce(&num_segment_elements, &num_total_elements, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(&segment_weight, &total_weight, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    // Element midpoints along the curve decide the destination, keeping at least one element per rank
+    double prefix_weight = weight_start;
+
+    for (int s = 0; s < num_segment_elements; s++)
+    {
+        int k = segment_start + s;
+        int dest = (int)((prefix_weight + 0.5 * segment[s].weight) * num_procs / total_weight);
+
+        dest = std::min({ dest, k, num_procs - 1 });
+        dest = std::max(dest, num_procs - (num_total_elements - k));
+
+        segment[s].destination = dest;
+        prefix_weight += segment[s].weight;
+    }
+
+    // Segments arrive in rank order, so both lists below come back in curve order
+    std::vector<Curve_Element> owned;
+    std::vector<Curve_Element> incoming;
+
+    target.resize(num_segment_elements);
+
+    for (int s = 0; s < num_segment_elements; s++) target[s] = segment[s].owner;
+    exchange(owned, segment, target);
+
+    for (int s = 0; s < num_segment_elements; s++) target[s] = segment[s].destination;
+    exchange(incoming, segment, target);
+
+    MPI_Type_free(&curve_type);
+
+    // Send list (grouped by destination because destinations grow along the curve)
+    plan.send_elements.clear();
+    plan.send_count.assign(num_procs, 0);
+    plan.recv_count.assign(num_procs, 0);
+
+    for (auto &elem : owned)
+    {
+        plan.send_elements.push_back(elem.index);
+        plan.send_count[elem.destination]++;
+    }
+
+    for (auto &elem : incoming) plan.recv_count[elem.owner]++;
+
+    // Receive list in curve order
+    std::vector<int> recv_offset(num_procs, 0);
+    for (int p = 1; p < num_procs; p++) recv_offset[p] = recv_offset[p - 1] + plan.recv_count[p - 1];
+
+    plan.recv_position.clear();
+
+    for (auto &elem : incoming) plan.recv_position.push_back(recv_offset[elem.owner]++);
+}
+
+// Exchange element data following a migration plan
+template<typename DType>
+void migrate_elements(std::vector<Element<DType>> &elements, std::vector<int> &node_degree, const Migration_Plan &plan, int dim, int poly_degree)
+{
+    int num_points = std::pow(poly_degree + 1, dim);
+    long long elem_size = (long long)(num_points) * ((4 + NUM_GEOM_FACTS) * sizeof(DType) + sizeof(long long) + sizeof(int));
+
+    if (elem_size > INT_MAX)
+    {
+        pstdout("ERROR: Element record of %lld bytes is too large to migrate\n", elem_size);
+        quit();
+    }
+
+    int elem_bytes = elem_size;
+
+    auto pack = [&](char *buffer, const Element<DType> &elem, const int *degree)
+    {
+        memcpy(buffer, elem.x.data(), num_points * sizeof(DType)); buffer += num_points * sizeof(DType);
+        memcpy(buffer, elem.y.data(), num_points * sizeof(DType)); buffer += num_points * sizeof(DType);
+        memcpy(buffer, elem.z.data(), num_points * sizeof(DType)); buffer += num_points * sizeof(DType);
+        memcpy(buffer, elem.dirichlet_mask.data(), num_points * sizeof(DType)); buffer += num_points * sizeof(DType);
+
+        for (int g = 0; g < NUM_GEOM_FACTS; g++)
+        {
+            memcpy(buffer, elem.geom_fact[g].data(), num_points * sizeof(DType));
+            buffer += num_points * sizeof(DType);
+        }
+
+        memcpy(buffer, elem.glo_num.data(), num_points * sizeof(long long)); buffer += num_points * sizeof(long long);
+        memcpy(buffer, degree, num_points * sizeof(int));
+    };
+
+    auto unpack = [&](Element<DType> &elem, int *degree, const char *buffer)
+    {
+        memcpy(elem.x.data(), buffer, num_points * sizeof(DType)); buffer += num_points * sizeof(DType);
+        memcpy(elem.y.data(), buffer, num_points * sizeof(DType)); buffer += num_points * sizeof(DType);
+        memcpy(elem.z.data(), buffer, num_points * sizeof(DType)); buffer += num_points * sizeof(DType);
+        memcpy(elem.dirichlet_mask.data(), buffer, num_points * sizeof(DType)); buffer += num_points * sizeof(DType);
+
+        for (int g = 0; g < NUM_GEOM_FACTS; g++)
+        {
+            memcpy(elem.geom_fact[g].data(), buffer, num_points * sizeof(DType));
+            buffer += num_points * sizeof(DType);
+        }
+
+        memcpy(elem.glo_num.data(), buffer, num_points * sizeof(long long)); buffer += num_points * sizeof(long long);
+        memcpy(degree, buffer, num_points * sizeof(int));
+    };
+
+    // Pack
+    int num_send = plan.send_elements.size();
+    int num_recv = plan.recv_position.size();
+
+    std::vector<char> send_buffer((size_t)(num_send) * elem_bytes);
+    std::vector<char> recv_buffer((size_t)(num_recv) * elem_bytes);
+
+    for (int s = 0; s < num_send; s++)
+    {
+        const Element<DType> &elem = elements[plan.send_elements[s]];
+        pack(send_buffer.data() + (size_t)(s) * elem_bytes, elem, node_degree.data() + elem.offset);
+    }
+
+    // Exchange whole element records, so counts and displacements stay in elements and cannot overflow as bytes past 2 GiB
+    std::vector<int> send_offset(num_procs, 0);
+    std::vector<int> recv_offset(num_procs, 0);
+
+    for (int p = 1; p < num_procs; p++)
+    {
+        send_offset[p] = send_offset[p - 1] + plan.send_count[p - 1];
+        recv_offset[p] = recv_offset[p - 1] + plan.recv_count[p - 1];
+    }
+
+    MPI_Datatype elem_type;
+    MPI_Type_contiguous(elem_bytes, MPI_BYTE, &elem_type);
+    MPI_Type_commit(&elem_type);
+
+    MPI_Alltoallv(send_buffer.data(), plan.send_count.data(), send_offset.data(), elem_type, recv_buffer.data(), plan.recv_count.data(), recv_offset.data(), elem_type, MPI_COMM_WORLD);
+
+    MPI_Type_free(&elem_type);
+
+    // Unpack in curve order
+    std::vector<Element<DType>>().swap(elements);
+    elements.reserve(num_recv);
+    node_degree.assign((size_t)(num_recv) * num_points, 0);
+
+    for (int e = 0; e < num_recv; e++)
+    {
+        elements.push_back(Element<DType>(e, dim, poly_degree));
+
+        Element<DType> &elem = elements.back();
+        elem.offset = e * num_points;
+
+        unpack(elem, node_degree.data() + elem.offset, recv_buffer.data() + (size_t)(plan.recv_position[e]) * elem_bytes);
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * Hardware performance counters header file
+ */
+
+// Headers
+#include <vector>
+#include <unordered_map>
+#include <linux/perf_event.h>
+
+// Class definition
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+// Counted events (the vector event is only opened when PERF_VECTOR_EVENT is set)
+#define EVENT_CYCLES 0
+#define EVENT_INSTRUCTIONS 1
+#define EVENT_LLC_MISSES 2
+#define EVENT_VECTOR 3
+#define NUM_EVENTS 4
+
+template<typename IType = long long>
+class Perf_Counters
+{
+    private:
+        // Member variables (one counter group per OpenMP thread, read from the timing thread)
+        std::vector<std::vector<int>> c_fd;
+        std::unordered_map<const char*, std::vector<IType>> c_start;
+        std::unordered_map<const char*, std::vector<IType>> c_total;
+        std::unordered_map<const char*, IType> c_calls;
+
+        int open_event(int, unsigned long long, int);
+        void read_events(std::vector<IType>&);
+        double measure_bandwidth();
+
+    public:
+        // Member variables
+        bool enabled = false;
+        int line_size = 64;
+        double peak_bandwidth = 0.0;
+        IType num_dofs = 1;
+
+        // Constructor
+        Perf_Counters();
+        ~Perf_Counters();
+
+        // Utility functions
+        void initialize();
+        void start(const char*);
+        void stop(const char*);
+        IType total(const char*, int);
+        IType calls(const char*);
+        std::vector<const char*> regions();
+};
+
+#include "perf_counters.tpp"
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * Hardware performance counters template file
+ */
+
+// Headers
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "perf_counters.hpp"
+
+// Constructor and destructor
+template<typename IType>
+Perf_Counters<IType>::Perf_Counters()
+{
+
+}
+
+template<typename IType>
+Perf_Counters<IType>::~Perf_Counters()
+{
+    for (auto &fd : c_fd)
+        for (auto f : fd)
+            if (f >= 0) close(f);
+}
+
+// Member functions
+template<typename IType>
+int Perf_Counters<IType>::open_event(int type, unsigned long long config, int tid)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int)(syscall(SYS_perf_event_open, &attr, tid, - 1, - 1, 0));
+}
+
+// Sum over threads, scaled up when the kernel multiplexed the counters
+template<typename IType>
+void Perf_Counters<IType>::read_events(std::vector<IType> &values)
+{
+    values.assign(NUM_EVENTS, 0);
+
+    for (auto &fd : c_fd)
+    {
+        for (int e = 0; e < NUM_EVENTS; e++)
+        {
+            unsigned long long data[3];
+
+            if (fd[e] < 0) continue;
+            if (read(fd[e], data, sizeof(data)) != sizeof(data)) continue;
+
+            if (data[2] > 0) values[e] += (IType)((double)(data[0]) * ((double)(data[1]) / (double)(data[2])));
+        }
+    }
+}
+
+// Best of a few OpenMP triads whose three arrays span four times the last level cache (32 MB each when its size is unknown)
+template<typename IType>
+double Perf_Counters<IType>::measure_bandwidth()
+{
+    long cache_size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (cache_size <= 0) cache_size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+
+    const long long n = (cache_size > 0) ? 4 * (long long)(cache_size) / (3 * sizeof(double)) : 1 << 22;
+    const int num_tests = 5;
+
+    std::vector<double> a(n), b(n), c(n);
+    double best = 0.0;
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < n; i++) { a[i] = 0.0; b[i] = 1.0; c[i] = 2.0; }
+
+    for (int test = 0; test < num_tests; test++)
+    {
+        double t_start = omp_get_wtime();
+
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < n; i++) a[i] = b[i] + 3.0 * c[i];
+
+        double t_elapsed = omp_get_wtime() - t_start;
+        best = std::max(best, 3.0 * n * sizeof(double) / t_elapsed);
+    }
+
+    return best;
+}
+
+template<typename IType>
+void Perf_Counters<IType>::initialize()
+{
+    long cache_line = sysconf(_SC_LEVEL3_CACHE_LINESIZE);
+    if (cache_line > 0) line_size = cache_line;
+
+    // Counters follow the thread they are opened on, so every OpenMP thread opens its own
+    int num_threads = omp_get_max_threads();
+    c_fd.assign(num_threads, std::vector<int>(NUM_EVENTS, - 1));
+
+    #pragma omp parallel num_threads(num_threads)
+    {
+        int t = omp_get_thread_num();
+        int tid = (int)(syscall(SYS_gettid));
+
+        c_fd[t][EVENT_CYCLES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, tid);
+        c_fd[t][EVENT_INSTRUCTIONS] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, tid);
+        c_fd[t][EVENT_LLC_MISSES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, tid);
+        if (PERF_VECTOR_EVENT != 0) c_fd[t][EVENT_VECTOR] = open_event(PERF_TYPE_RAW, PERF_VECTOR_EVENT, tid);
+    }
+
+    enabled = true;
+    for (auto &fd : c_fd) if ((fd[EVENT_CYCLES] < 0) or (fd[EVENT_INSTRUCTIONS] < 0)) enabled = false;
+
+    if (!enabled)
+    {
+        rstdout("WARNING: perf_event_open failed (check /proc/sys/kernel/perf_event_paranoid), hardware counters disabled\n");
+        return;
+    }
+
+    // The triad only runs when the counters it normalizes are available
+#if PEAK_BANDWIDTH > 0
+    peak_bandwidth = PEAK_BANDWIDTH * 1.0e9;
+#else
+    peak_bandwidth = measure_bandwidth();
+#endif
+}
+
+template<typename IType>
+void Perf_Counters<IType>::start(const char *name)
+{
+    if (!enabled) return;
+
+    read_events(c_start[name]);
+}
+
+template<typename IType>
+void Perf_Counters<IType>::stop(const char *name)
+{
+    if (!enabled) return;
+
+    std::vector<IType> values;
+    read_events(values);
+
+    if (c_total.find(name) == c_total.end()) c_total[name].resize(NUM_EVENTS);
+
+    for (int e = 0; e < NUM_EVENTS; e++) c_total[name][e] += values[e] - c_start[name][e];
+    c_calls[name]++;
+}
+
+template<typename IType>
+IType Perf_Counters<IType>::total(const char *name, int event)
+{
+    if (c_total.find(name) == c_total.end()) return 0;
+
+    return c_total[name][event];
+}
+
+template<typename IType>
+IType Perf_Counters<IType>::calls(const char *name)
+{
+    if (c_calls.find(name) == c_calls.end()) return 0;
+
+    return c_calls[name];
+}
+
+// Counted regions in name order (the same on every rank as long as they run the same phases)
+template<typename IType>
+std::vector<const char*> Perf_Counters<IType>::regions()
+{
+    std::vector<const char*> names;
+    for (auto &it : c_total) names.push_back(it.first);
+
+    std::sort(names.begin(), names.end(), [](const char *a, const char *b) { return strcmp(a, b) < 0; });
+
+    return names;
+}
@@ -12,8 +12,12 @@
 #include "config.hpp"
 #include "domain.hpp"
 #include "subdomain.hpp"
+#include "subdomain_group.hpp"
 
 #include <cuda_runtime.h>
+#include <sys/resource.h>
+#include <sched.h>
+#include <unistd.h>
 
 extern "C"
 {
@@ -27,14 +31,21 @@ extern "C"
 // Namespaces
 using namespace std;
 
+// Thread level granted by MPI
+int thread_support = MPI_THREAD_SINGLE;
+
 // Functions declaration
 void MPI_Initialize(int, char*[]);
 void HYPRE_Initialize();
 void set_parallel_print();
 void library_banner();
 void OCCA_Initialize();
-void run_simulation(char*, int, int, int, int);
+int bind_threads();
+void prebuild_kernels(int, int);
+void run_simulation(char*, int, int, int, int, int);
+void memory_data();
 void simulation_data();
+void counter_data();
 
 // Main function
 int main(int argc, char *argv[])
@@ -57,18 +68,56 @@ int main(int argc, char *argv[])
     // Initialize OCCA
     OCCA_Initialize();
 
+#if PERF_COUNTERS == 1
+    // Hardware counters on the OpenMP threads bound by OCCA_Initialize
+    timer.counters.initialize();
+#endif
+
+    // Populate the OCCA cache only
+    if ((argc == 4) and (strcmp(argv[1], "--prebuild") == 0))
+    {
+        prebuild_kernels(atoi(argv[2]), atoi(argv[3]));
+
+        HYPRE_Finalize();
+        MPI_Finalize();
+
+        return EXIT_SUCCESS;
+    }
+
     // Check parameters passed
     if (argc < 6)
     {
-        rstdout("ERROR: Use as 'poisson <directory> <polynomial degree> <polynomial reduction> <subdomain overlap> <superdomain overlap>'\n");
+        rstdout("ERROR: Use as 'poisson <directory> <polynomial degree> <polynomial reduction> <subdomain overlap> <superdomain overlap> [amg|fdm]'\n");
+        rstdout("       or as 'poisson --prebuild <polynomial degree> <polynomial reduction>' to populate the kernel cache\n");
         quit();
     }
 
+    // Subdomain preconditioner
+    int local_preconditioner = SUBDOMAIN_PRECONDITIONER;
+
+    if (argc > 6)
+    {
+        if (strcmp(argv[6], "amg") == 0)
+        {
+            local_preconditioner = 0;
+        }
+        else if (strcmp(argv[6], "fdm") == 0)
+        {
+            local_preconditioner = 1;
+        }
+        else
+        {
+            rstdout("ERROR: Unknown subdomain preconditioner '%s' (use 'amg' or 'fdm')\n", argv[6]);
+            quit();
+        }
+    }
+
     // Run simulation
-    run_simulation(argv[1], atoi(argv[2]), atoi(argv[3]), atoi(argv[4]), atoi(argv[5]));
+    run_simulation(argv[1], atoi(argv[2]), atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), local_preconditioner);
 
     // Print output measurements
     simulation_data();
+    counter_data();
 
     // Finalize Hypre
     HYPRE_Finalize();
@@ -83,7 +132,7 @@ int main(int argc, char *argv[])
 // Functions
 void MPI_Initialize(int argc, char *argv[])
 {
-    MPI_Init(&argc, &argv);
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support);
     MPI_Comm_rank(MPI_COMM_WORLD, &proc_id);
     MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
 }
@@ -138,6 +187,13 @@ void OCCA_Initialize()
     rstdout("- Mode: 'CUDA'\n");
     rstdout("- Device id: 0\n");
 
+#elif OCCA_TYPE == 2
+    int num_threads = bind_threads();
+
+    device.setup({{"mode", "OpenMP"}});
+    rstdout("- Mode: 'OpenMP'\n");
+    rstdout("- Threads per rank: %d\n", num_threads);
+
 #else
     rstdout("OCCA mode '%d' is not available\n", OCCA_TYPE);
     quit();
@@ -147,7 +203,91 @@ void OCCA_Initialize()
     rstdout("\n");
 }
 
-void run_simulation(char *directory, int poly_degree, int poly_reduction, int subdomain_overlap, int superdomain_overlap)
+int bind_threads()
+{
+    // Ranks sharing this node
+    MPI_Comm node_comm;
+    int node_rank, node_size;
+
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, proc_id, MPI_INFO_NULL, &node_comm);
+    MPI_Comm_rank(node_comm, &node_rank);
+    MPI_Comm_size(node_comm, &node_size);
+    MPI_Comm_free(&node_comm);
+
+    // CPUs of this rank (a launcher that did not bind leaves the whole node, which is split evenly between ranks)
+    cpu_set_t mask;
+    sched_getaffinity(0, sizeof(cpu_set_t), &mask);
+
+    std::vector<int> cpus;
+    for (int c = 0; c < CPU_SETSIZE; c++) if (CPU_ISSET(c, &mask)) cpus.push_back(c);
+
+    if ((node_size > 1) and ((long)(cpus.size()) == sysconf(_SC_NPROCESSORS_ONLN)))
+    {
+        int first = (cpus.size() * node_rank) / node_size;
+        int last = std::max((int)((cpus.size() * (node_rank + 1)) / node_size), first + 1);
+
+        cpus = std::vector<int>(cpus.begin() + first, cpus.begin() + last);
+
+        CPU_ZERO(&mask);
+        for (auto c : cpus) CPU_SET(c, &mask);
+        sched_setaffinity(0, sizeof(cpu_set_t), &mask);
+    }
+
+    // One thread per CPU unless OMP_NUM_THREADS is set
+    if (getenv("OMP_NUM_THREADS") == NULL) omp_set_num_threads(cpus.size());
+    omp_set_dynamic(0);
+
+    int num_threads = omp_get_max_threads();
+
+    // Workers are pinned to one CPU each. The main thread keeps the whole rank mask so threads it spawns later are not packed onto one CPU
+    #pragma omp parallel num_threads(num_threads)
+    {
+        int thread_id = omp_get_thread_num();
+
+        if (thread_id > 0)
+        {
+            cpu_set_t thread_mask;
+            CPU_ZERO(&thread_mask);
+            CPU_SET(cpus[thread_id % cpus.size()], &thread_mask);
+            sched_setaffinity(0, sizeof(cpu_set_t), &thread_mask);
+        }
+    }
+
+    return num_threads;
+}
+
+void prebuild_kernels(int poly_degree, int poly_reduction)
+{
+    // Types
+    typedef STYPE SType;
+    typedef PTYPE PType;
+
+    rstdout("Building kernels for \"N = %d\" with reduction \"%d\"...\n", poly_degree, poly_reduction);
+
+    for (dim = 2; dim <= 3; dim++)
+    {
+        Domain<SType> domain;
+
+        for (int N = poly_degree; ; N = std::max(N - poly_reduction, 1))
+        {
+            domain.poly_degree = N;
+            domain.build_kernels();
+
+            if (N == 1) break;
+        }
+
+        CSR_Matrix<SType> A_domain(1, 1);
+        CSR_Matrix<PType> A_subdomain(1, 1);
+        Multivector<SType> V_domain(1, 1);
+        Multivector<PType> V_subdomain(1, 1);
+
+        Subdomain<PType>::prebuild_kernels(poly_degree, poly_reduction, domain.data_type);
+    }
+
+    rstdout("- Kernels built: %d\n", kernel_registry.num_builds);
+}
+
+void run_simulation(char *directory, int poly_degree, int poly_reduction, int subdomain_overlap, int superdomain_overlap, int local_preconditioner)
 {
     // Types
     typedef STYPE SType;
@@ -171,11 +311,18 @@ void run_simulation(char *directory, int poly_degree, int poly_reduction, int su
     rstdout("- Polynomial reduction: \"%d\"\n", poly_reduction);
     rstdout("- Subdomain overlap: \"%d\"\n", subdomain_overlap);
     rstdout("- Superdomain overlap: \"%d\"\n", superdomain_overlap);
+    rstdout("- Subdomains per rank: \"%d\"\n", SUBDOMAINS_PER_RANK);
+    rstdout("- Subdomain preconditioner: \"%s\"\n", (local_preconditioner == 1) ? "fdm" : "amg");
 
     // Create local domain
     std::unordered_map<int, Domain<SType>> domains;
     int poly_degree_level = poly_degree;
 
+    // Repartitioning weights elements by the subdomain hierarchy they will carry (the subdomain setup raises zero overlaps to one)
+    domains[poly_degree].poly_reduction = poly_reduction;
+    domains[poly_degree].subdomain_overlap = std::max(subdomain_overlap, 1);
+    domains[poly_degree].superdomain_overlap = std::max(superdomain_overlap, 1);
+
     rstdout("\nSetting up domain \"N = %d\" object...\n", poly_degree);
     domains[poly_degree].initialize(directory, poly_degree);
     rstdout("\n");
@@ -187,12 +334,12 @@ void run_simulation(char *directory, int poly_degree, int poly_reduction, int su
         if (poly_degree_level >= 1)
         {
             rstdout("Setting up domain \"N = %d\" object...\n", poly_degree_level);
-            domains[poly_degree_level].initialize(directory, poly_degree_level);
+            domains[poly_degree_level].initialize(directory, poly_degree_level, &domains[poly_degree]);
         }
         else
         {
             rstdout("Setting up domain \"N = %d\" object...\n", 1);
-            domains[1].initialize(directory, 1);
+            domains[1].initialize(directory, 1, &domains[poly_degree]);
         }
 
         rstdout("\n");
@@ -200,30 +347,86 @@ void run_simulation(char *directory, int poly_degree, int poly_reduction, int su
 
     Domain<SType> &domain = domains[poly_degree];
 
+#if PERF_COUNTERS == 1
+    // Counter traffic is normalized by the local points of the finest domain
+    timer.counters.num_dofs = domain.num_local_points;
+#endif
+
     // Setup preconditioner
     rstdout("Setting up subdomain object...\n");
 
-    Subdomain<PType> subdomain(domains, poly_degree, poly_reduction, subdomain_overlap, superdomain_overlap);
+    // Concurrent parts need worker threads next to the MPI thread
+    int num_parts = SUBDOMAINS_PER_RANK;
+
+    if ((num_parts > 1) and (thread_support < MPI_THREAD_FUNNELED))
+    {
+        rstdout("WARNING: MPI does not provide MPI_THREAD_FUNNELED, running one subdomain per rank\n");
+        num_parts = 1;
+    }
+
+    Subdomain_Group<PType> subdomain(domains, poly_degree, poly_reduction, subdomain_overlap, superdomain_overlap, num_parts, SUBDOMAIN_THREADS, local_preconditioner);
+
+    rstdout("Kernels built: %d (%d requests)\n", kernel_registry.num_builds, kernel_registry.num_lookups);
+
+    // Helmholtz coefficients (the subdomain hierarchies are built for the Poisson operator and recombined)
+    for (auto &it : domains)
+    {
+        it.second.h1 = HELMHOLTZ_H1;
+        it.second.h2 = HELMHOLTZ_H2;
+    }
+
+    if ((HELMHOLTZ_H1 != 1.0) or (HELMHOLTZ_H2 != 0.0))
+    {
+        timer.start("subdomain.refresh_coefficients");
+        subdomain.refresh_coefficients(HELMHOLTZ_H1, HELMHOLTZ_H2);
+        timer.stop("subdomain.refresh_coefficients");
+    }
 
     // Set exact solution
     rstdout("\nSetting up exact function...\n");
 
     int function_id = 4;
-    occa::memory u_star = device.malloc<SType>(domain.num_local_points);
+    occa::memory u_star = device_malloc<SType>(domain.num_local_points);
     domain.initial_function(u_star, function_id);
 
     // Construct right-hand-side
     rstdout("Setting up right-hand-side...\n");
 
-    occa::memory f = device.malloc<SType>(domain.num_local_points);
+    occa::memory f = device_malloc<SType>(domain.num_local_points);
     domain.stiffness_matrix(f, u_star);
 
+#if LEAN_MODE == 1
+    // Release host data not needed by the solvers
+    rstdout("Releasing host mesh data...\n");
+
+    for (auto it = domains.begin(); it != domains.end(); )
+    {
+        if (it->first == poly_degree)
+            it++;
+        else
+            it = domains.erase(it);
+    }
+
+    domain.release_host_data(VISUALIZATION == 1);
+    subdomain.release_host_data(VISUALIZATION == 1);
+#endif
+
+    // Memory usage
+    for (auto &it : domains) it.second.memory_usage();
+    subdomain.memory_usage();
+
+    // Workspaces of all phases (the planned peak is what the sum of the requests shrinks to once the lifetimes are overlapped)
+    memory.add("arena.device.peak", arena.peak());
+    memory.add("arena.device.requested", arena.requested());
+
+    memory_data();
+
     // Numerical solution
     rstdout("Solving Poisson problem...\n");
 
     int solver_id = 1;
 
-    occa::memory u = device.malloc<SType>(domain.num_local_points);
+    occa::memory u = device_malloc<SType>(domain.num_local_points);
 
     if (solver_id == 0)
         domain.flexible_conjugate_gradient(u, f, subdomain);
@@ -240,6 +443,7 @@ void run_simulation(char *directory, int poly_degree, int poly_reduction, int su
     rstdout("Total number of elements: %d\n", domain.num_total_elements);
     rstdout("Polynomial degree: %d\n", domain.poly_degree);
     rstdout("Function ID: %d\n", function_id);
+    rstdout("Helmholtz coefficients: h1 = %g, h2 = %g\n", (double)(domain.h1), (double)(domain.h2));
     rstdout("Subdomain overlap: %d\n", subdomain_overlap);
     rstdout("Superdomain overlap: %d\n", superdomain_overlap);
     rstdout("Solver data precision: %s\n", domain.data_type);
@@ -248,6 +452,90 @@ void run_simulation(char *directory, int poly_degree, int poly_reduction, int su
     rstdout("Preconditioner data precision: %s\n", subdomain.data_type);
     rstdout("Preconditioner tolerance: %g\n", subdomain.tolerance);
     rstdout("Preconditioner type: \"%s\"\n", (domain.preconditioner_type == 0) ? "FCG" : "GMRES");
+
+    // Inner iterations of every preconditioner call (every rank makes the same calls)
+    std::vector<int> &call_iterations = subdomain.call_iterations;
+    MPI_Allreduce(MPI_IN_PLACE, call_iterations.data(), call_iterations.size(), MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+
+    std::string call_iterations_string;
+    int total_call_iterations = 0;
+
+    for (auto num_call_iterations : call_iterations)
+    {
+        call_iterations_string += " " + std::to_string(num_call_iterations);
+        total_call_iterations += num_call_iterations;
+    }
+
+    rstdout("Preconditioner tolerance policy: \"%s\"\n", (INNER_TOLERANCE == 0) ? "fixed" : "adaptive");
+    rstdout("Preconditioner iterations per call: %.02f [%s ]\n", (double)(total_call_iterations) / std::max((int)(call_iterations.size()), 1), call_iterations_string.c_str());
+}
+
+void memory_data()
+{
+    const char *names[] = { "domain.host.mesh", "domain.host.work", "domain.device.operator", "domain.device.solver",
+                            "subdomain.host.mesh", "subdomain.host.work", "subdomain.host.preconditioner",
+                            "subdomain.device.operator", "subdomain.device.solver", "subdomain.device.preconditioner",
+                            "arena.device.peak", "arena.device.requested", "process.host.peak" };
+    const char *labels[] = { "Domain mesh (host)", "Domain work (host)", "Domain operator (device)", "Domain solver (device)",
+                             "Subdomain mesh (host)", "Subdomain work (host)", "Preconditioner (host)",
+                             "Subdomain operator (device)", "Subdomain solver (device)", "Preconditioner (device)",
+                             "Arena planned peak (device)", "Arena requested (device)", "Peak resident (host)" };
+    const int num_names = sizeof(names) / sizeof(names[0]);
+
+    // Peak resident set size of the process (reported in kilobytes on Linux)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    memory.reset("process.host.peak");
+    memory.add("process.host.peak", (long long)(usage.ru_maxrss) * 1024);
+
+    rstdout("\nMemory usage:\n");
+    rstdout("-------------------------------------------------------------------------\n");
+
+    for (int i = 0; i < num_names; i++)
+    {
+        std::string memory_string;
+
+        memory.gather(names[i]);
+        memory.total(names[i], memory_string);
+
+        rstdout("%-27s = %10.02f MB [ %s ]\n", labels[i], (double)(memory.total(names[i], "max")) / (1024.0 * 1024.0), memory_string.c_str());
+    }
+
+    rstdout("\n");
+}
+
+void counter_data()
+{
+#if PERF_COUNTERS == 1
+    auto &counters = timer.counters;
+    if (!counters.enabled) return;
+
+    // Rank 0 on the standard output, every rank in its own output file
+    char line[256];
+    sprintf(line, "%-48s %8s %14s %14s %6s %14s %14s %9s %9s %7s\n", "Region", "Calls", "Cycles/call", "Instr/call", "IPC", "LLC miss/call", "Vector/call", "GB/s", "B/DOF", "% BW");
+
+    rstdout("\nHardware counters (rank 0, measured peak bandwidth %.02f GB/s):\n", counters.peak_bandwidth / 1.0e9);
+    rstdout("-------------------------------------------------------------------------\n");
+    rstdout("%s", line);
+    pstdout("\nHardware counters:\n%s", line);
+
+    for (auto name : counters.regions())
+    {
+        double calls = std::max((double)(counters.calls(name)), 1.0);
+        double cycles = counters.total(name, EVENT_CYCLES);
+        double instructions = counters.total(name, EVENT_INSTRUCTIONS);
+        double bytes = (double)(counters.total(name, EVENT_LLC_MISSES)) * counters.line_size;
+        double bandwidth = (timer.total(name) > 0.0) ? bytes / timer.total(name) : 0.0;
+
+        sprintf(line, "%-48s %8lld %14.04g %14.04g %6.02f %14.04g %14.04g %9.02f %9.02f %7.02f\n", name, counters.calls(name), cycles / calls, instructions / calls, (cycles > 0.0) ? instructions / cycles : 0.0,
+                (double)(counters.total(name, EVENT_LLC_MISSES)) / calls, (PERF_VECTOR_EVENT != 0) ? (double)(counters.total(name, EVENT_VECTOR)) / calls : 0.0,
+                bandwidth / 1.0e9, bytes / (calls * counters.num_dofs), 100.0 * bandwidth / counters.peak_bandwidth);
+
+        rstdout("%s", line);
+        pstdout("%s", line);
+    }
+#endif
 }
 
 void simulation_data()
@@ -297,6 +585,7 @@ void simulation_data()
         subdomain_solver_time += vector_operations_time;
         subdomain_solver_time += operator_application_time;
         subdomain_solver_time += preconditioner_time;
+        subdomain_solver_time += timer.total("subdomain.concurrent_solve");
 
         std::vector<SType> subdomain_solver_times(num_procs);
         subdomain_solver_times[proc_id] = subdomain_solver_time;
@@ -400,6 +689,18 @@ void simulation_data()
     rstdout("Subdomain stitching   = %12.08f s ( %6.02f ) [ %s ]\n", subdomain_stitching_time, 100.0 * subdomain_stitching_time / total_time, subdomain_stitching_string.c_str());
     rstdout("Subdomain solver      = %12.08f s ( %6.02f ) [ %s ]\n", subdomain_solver_time, 100.0 * subdomain_solver_time / total_time, subdomain_solver_string.c_str());
 
+    // Regions timed inside the concurrent parts (already covered by the concurrent solve above)
+    std::vector<const char*> thread_regions = timer.thread_regions();
+
+    if (thread_regions.size() > 0)
+    {
+        rstdout("\nConcurrent part timings (rank 0, max and sum over threads):\n");
+        rstdout("-------------------------------------------------------------------------\n");
+
+        for (auto name : thread_regions)
+            rstdout("%-48s %12.08f s %12.08f s\n", name, timer.thread_total(name, "max"), timer.thread_total(name, "sum"));
+    }
+
 #if 0
     {
         char word[80];
@@ -0,0 +1,31 @@
+/*
+ * Mesh reordering header file
+ */
+
+// Headers
+#include <mpi.h>
+#include <vector>
+#include <unordered_map>
+#include "element.hpp"
+
+// Function declarations
+#ifndef REORDERING_HPP
+#define REORDERING_HPP
+
+template<typename DType>
+void hilbert_keys(std::vector<unsigned long long>&, const std::vector<Element<DType>>&, int, bool = false);
+
+template<typename DType>
+void space_filling_curve_order(std::vector<int>&, const std::vector<Element<DType>>&, int);
+
+template<typename DType>
+void permute_elements(std::vector<Element<DType>>&, std::vector<int>&, const std::vector<int>&);
+
+void reverse_cuthill_mckee(std::vector<int>&, const std::vector<int>&, const std::vector<int>&);
+
+template<typename DType>
+void renumber_nodes(std::unordered_map<long long, int>&, const std::vector<Element<DType>>&, int, int);
+
+#include "reordering.tpp"
+
+#endif
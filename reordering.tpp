@@ -0,0 +1,273 @@
+/*
+ * Mesh reordering template file
+ */
+
+// Headers
+#include <algorithm>
+#include <queue>
+#include "reordering.hpp"
+
+// Hilbert index of a point with integer coordinates (Skilling's transpose algorithm)
+unsigned long long hilbert_index(unsigned int *X, int num_bits, int dim)
+{
+    unsigned int M = 1u << (num_bits - 1);
+
+    for (unsigned int Q = M; Q > 1; Q >>= 1)
+    {
+        unsigned int P = Q - 1;
+
+        for (int d = 0; d < dim; d++)
+        {
+            if (X[d] & Q)
+            {
+                X[0] ^= P;
+            }
+            else
+            {
+                unsigned int t = (X[0] ^ X[d]) & P;
+                X[0] ^= t;
+                X[d] ^= t;
+            }
+        }
+    }
+
+    for (int d = 1; d < dim; d++) X[d] ^= X[d - 1];
+
+    unsigned int t = 0;
+
+    for (unsigned int Q = M; Q > 1; Q >>= 1)
+        if (X[dim - 1] & Q) t ^= Q - 1;
+
+    for (int d = 0; d < dim; d++) X[d] ^= t;
+
+    unsigned long long key = 0;
+
+    for (int b = num_bits - 1; b >= 0; b--)
+        for (int d = 0; d < dim; d++)
+            key = (key << 1) | ((X[d] >> b) & 1);
+
+    return key;
+}
+
+// Hilbert curve keys of the element centroids (bounding box over all ranks when global)
+template<typename DType>
+void hilbert_keys(std::vector<unsigned long long> &key, const std::vector<Element<DType>> &elements, int dim, bool global)
+{
+    int num_elements = elements.size();
+    int num_vertices = (dim == 2) ? 4 : 8;
+    int num_bits = (dim == 2) ? 31 : 21;
+
+    // Centroids from the element vertices, which coincide on every polynomial level
+    std::vector<double> centroid(3 * num_elements, 0.0);
+    double c_min[3] = {  1.0e+300,  1.0e+300,  1.0e+300 };
+    double c_max[3] = { -1.0e+300, -1.0e+300, -1.0e+300 };
+
+    for (int e = 0; e < num_elements; e++)
+    {
+        const Element<DType> &elem = elements[e];
+        int n_z = (dim == 2) ? 1 : elem.n_z;
+
+        for (int k = 0; k < n_z; k += std::max(n_z - 1, 1))
+        {
+            for (int j = 0; j < elem.n_y; j += elem.n_y - 1)
+            {
+                for (int i = 0; i < elem.n_x; i += elem.n_x - 1)
+                {
+                    int v = i + j * elem.n_x + k * elem.n_x * elem.n_y;
+
+                    centroid[3 * e + 0] += elem.x[v] / num_vertices;
+                    centroid[3 * e + 1] += elem.y[v] / num_vertices;
+                    if (dim == 3) centroid[3 * e + 2] += elem.z[v] / num_vertices;
+                }
+            }
+        }
+
+        for (int d = 0; d < dim; d++)
+        {
+            c_min[d] = std::min(c_min[d], centroid[3 * e + d]);
+            c_max[d] = std::max(c_max[d], centroid[3 * e + d]);
+        }
+    }
+
+    if (global)
+    {
+        MPI_Allreduce(MPI_IN_PLACE, c_min, 3, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+        MPI_Allreduce(MPI_IN_PLACE, c_max, 3, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    }
+
+    key.resize(num_elements);
+    double scale = (double)((1u << num_bits) - 1);
+
+    for (int e = 0; e < num_elements; e++)
+    {
+        unsigned int X[3] = { 0, 0, 0 };
+
+        for (int d = 0; d < dim; d++)
+        {
+            double length = c_max[d] - c_min[d];
+            if (length > 0.0) X[d] = (unsigned int)(scale * (centroid[3 * e + d] - c_min[d]) / length);
+        }
+
+        key[e] = hilbert_index(X, num_bits, dim);
+    }
+}
+
+// Element order along a Hilbert curve of the element centroids
+template<typename DType>
+void space_filling_curve_order(std::vector<int> &order, const std::vector<Element<DType>> &elements, int dim)
+{
+    int num_elements = elements.size();
+
+    std::vector<unsigned long long> key;
+    hilbert_keys(key, elements, dim, false);
+
+    order.resize(num_elements);
+    for (int e = 0; e < num_elements; e++) order[e] = e;
+
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return key[a] < key[b]; });
+}
+
+// Move elements and their per-point data to the new order (order[new] = old)
+template<typename DType>
+void permute_elements(std::vector<Element<DType>> &elements, std::vector<int> &point_data, const std::vector<int> &order)
+{
+    std::vector<Element<DType>> elements_old;
+    std::vector<int> point_data_old(point_data);
+
+    elements_old.swap(elements);
+    elements.reserve(elements_old.size());
+
+    for (unsigned int e = 0; e < order.size(); e++)
+    {
+        Element<DType> &elem_old = elements_old[order[e]];
+        int offset_old = elem_old.offset;
+
+        elements.push_back(std::move(elem_old));
+
+        Element<DType> &elem = elements.back();
+        elem.id = e;
+        elem.offset = (e > 0) ? elements[e - 1].offset + elements[e - 1].num_points : 0;
+
+        for (int v = 0; v < elem.num_points; v++)
+            point_data[elem.offset + v] = point_data_old[offset_old + v];
+    }
+}
+
+// Reverse Cuthill-McKee order of a graph in CSR format (order[new] = old)
+void reverse_cuthill_mckee(std::vector<int> &order, const std::vector<int> &ptr, const std::vector<int> &col)
+{
+    int num_nodes = ptr.size() - 1;
+
+    std::vector<int> degree(num_nodes);
+    for (int n = 0; n < num_nodes; n++) degree[n] = ptr[n + 1] - ptr[n];
+
+    // Components are started from their lowest degree node
+    std::vector<int> start(num_nodes);
+    for (int n = 0; n < num_nodes; n++) start[n] = n;
+    std::stable_sort(start.begin(), start.end(), [&](int a, int b) { return degree[a] < degree[b]; });
+
+    std::vector<bool> visited(num_nodes, false);
+    std::vector<int> neighbors;
+
+    order.clear();
+    order.reserve(num_nodes);
+
+    for (auto s : start)
+    {
+        if (visited[s]) continue;
+
+        std::queue<int> frontier;
+        frontier.push(s);
+        visited[s] = true;
+
+        while (not frontier.empty())
+        {
+            int n = frontier.front();
+            frontier.pop();
+            order.push_back(n);
+
+            neighbors.clear();
+
+            for (int idx = ptr[n]; idx < ptr[n + 1]; idx++)
+            {
+                if (not visited[col[idx]])
+                {
+                    visited[col[idx]] = true;
+                    neighbors.push_back(col[idx]);
+                }
+            }
+
+            std::stable_sort(neighbors.begin(), neighbors.end(), [&](int a, int b) { return degree[a] < degree[b]; });
+
+            for (auto m : neighbors) frontier.push(m);
+        }
+    }
+
+    std::reverse(order.begin(), order.end());
+}
+
+// Renumber the nodes with indices in [first, last) following RCM on the GLL grid connectivity
+template<typename DType>
+void renumber_nodes(std::unordered_map<long long, int> &node_idx, const std::vector<Element<DType>> &elements, int first, int last)
+{
+    int num_nodes = last - first;
+    if (num_nodes <= 1) return;
+
+    // Edges between neighboring points of each element
+    std::vector<std::pair<int, int>> edges;
+
+    for (auto &elem : elements)
+    {
+        int n_z = (elem.dim == 2) ? 1 : elem.n_z;
+        int stride[3] = { 1, elem.n_x, elem.n_x * elem.n_y };
+        int size[3] = { elem.n_x, elem.n_y, n_z };
+
+        for (int k = 0; k < n_z; k++)
+        {
+            for (int j = 0; j < elem.n_y; j++)
+            {
+                for (int i = 0; i < elem.n_x; i++)
+                {
+                    int ijk[3] = { i, j, k };
+                    int v = i * stride[0] + j * stride[1] + k * stride[2];
+                    int a = node_idx[elem.glo_num[v]] - first;
+
+                    if ((a < 0) or (a >= num_nodes)) continue;
+
+                    for (int d = 0; d < elem.dim; d++)
+                    {
+                        if (ijk[d] + 1 >= size[d]) continue;
+
+                        int b = node_idx[elem.glo_num[v + stride[d]]] - first;
+
+                        if ((b < 0) or (b >= num_nodes)) continue;
+
+                        edges.push_back(std::make_pair(a, b));
+                        edges.push_back(std::make_pair(b, a));
+                    }
+                }
+            }
+        }
+    }
+
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    std::vector<int> ptr(num_nodes + 1, 0);
+    std::vector<int> col(edges.size());
+
+    for (auto &edge : edges) ptr[edge.first + 1]++;
+    for (int n = 0; n < num_nodes; n++) ptr[n + 1] += ptr[n];
+    for (unsigned int idx = 0; idx < edges.size(); idx++) col[idx] = edges[idx].second;
+
+    // New numbering
+    std::vector<int> order;
+    reverse_cuthill_mckee(order, ptr, col);
+
+    std::vector<int> new_idx(num_nodes);
+    for (int n = 0; n < num_nodes; n++) new_idx[order[n]] = n;
+
+    for (auto &it : node_idx)
+        if ((it.second >= first) and (it.second < last))
+            it.second = first + new_idx[it.second - first];
+}
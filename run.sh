@@ -1,6 +1,7 @@
 #!/bin/bash
 clean=1
 build=1
+prebuild=1
 run=1
 
 if [ ${clean} -eq 1 ]; then
@@ -26,6 +27,14 @@ poly_reduction=1
 subdomain_overlap=1
 superdomain_overlap=1
 
+if [ ${prebuild} -eq 1 ]; then
+    if [ $(hostname) = kitsune ]; then
+        mpirun -np 1 ./poisson --prebuild ${poly_degree} ${poly_reduction}
+    else
+        jsrun -n 1 -c 1 -a 1 -g 1 ./poisson --prebuild ${poly_degree} ${poly_reduction}
+    fi
+fi
+
 if [ ${run} -eq 1 ]; then
     path="/home/metalcycling/Dropbox/University_of_Illinois/Research/Unstructured_Range_Decomposition/Code/Nek5000/Kershaw/Meshes/eps_0.3/16x16x16/P_${num_procs}"
     args="${path} ${poly_degree} ${poly_reduction} ${subdomain_overlap} ${superdomain_overlap}"
@@ -0,0 +1,64 @@
+/*
+ * Silo writer class declaration
+ */
+
+// Headers
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "config.hpp"
+#include "special_functions.hpp"
+
+// Class definition
+#ifndef SILO_WRITER_HPP
+#define SILO_WRITER_HPP
+
+template<typename DType>
+class Silo_Writer
+{
+    private:
+        // Snapshot (owned by the background thread between 'write' and 'wait')
+        int num_points = 0;
+        int num_zones = 0;
+        std::vector<int> zones;
+        std::vector<DType> coordinates[3];
+        std::vector<std::string> field_names;
+        std::vector<std::vector<DType>> field_values;
+
+        // Interpolation from GLL points of degree p to degree q (keyed by p * 1024 + q)
+        std::map<int, std::vector<DType>> J_output;
+        std::vector<DType> work[2];
+
+        int output_points(int);
+        void interpolate(std::vector<DType>&, const DType*, int);
+
+        // Background writing
+        std::thread worker;
+        void write_files(std::string);
+
+    public:
+        // Member variables
+        int output_degree = OUTPUT_DEGREE;
+
+        // Constructor
+        Silo_Writer();
+        ~Silo_Writer();
+
+        // Snapshot construction
+        void clear();
+        void add_element(int, const DType*, const DType*, const DType*);
+        void add_field(const char*);
+        void add_field_values(int, const DType*);
+
+        // Utility functions
+        bool has_mesh();
+        void write(std::string);
+        void wait();
+};
+
+#include "silo_writer.tpp"
+
+#endif
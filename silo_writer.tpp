@@ -0,0 +1,261 @@
+/*
+ * Silo writer definition
+ */
+
+// Headers
+#include <cstdio>
+#include <typeinfo>
+#include <silo.h>
+#include "silo_writer.hpp"
+
+// Silo is not thread safe, so every writer in the process takes this lock
+inline std::mutex &silo_mutex()
+{
+    static std::mutex mutex;
+
+    return mutex;
+}
+
+// Functions definition
+template<typename DType>
+Silo_Writer<DType>::Silo_Writer()
+{
+
+}
+
+template<typename DType>
+Silo_Writer<DType>::~Silo_Writer()
+{
+    wait();
+}
+
+// Snapshot construction
+template<typename DType>
+void Silo_Writer<DType>::clear()
+{
+    // The mesh is kept, only the fields change between outputs
+    field_names.clear();
+    field_values.clear();
+}
+
+template<typename DType>
+bool Silo_Writer<DType>::has_mesh()
+{
+    return num_points > 0;
+}
+
+template<typename DType>
+int Silo_Writer<DType>::output_points(int poly_degree)
+{
+    int out_degree = (output_degree > 0) ? std::min(poly_degree, output_degree) : poly_degree;
+
+    return out_degree + 1;
+}
+
+template<typename DType>
+void Silo_Writer<DType>::interpolate(std::vector<DType> &values, const DType *elem_values, int poly_degree)
+{
+    int n_p = poly_degree + 1;
+    int n_q = output_points(poly_degree);
+    int n[3] = { n_p, n_p, (dim == 3) ? n_p : 1 };
+
+    if (n_q == n_p)
+    {
+        values.insert(values.end(), elem_values, elem_values + n[0] * n[1] * n[2]);
+        return;
+    }
+
+    // 1D interpolation matrix (n_q x n_p)
+    std::vector<DType> &J = J_output[poly_degree * 1024 + (n_q - 1)];
+
+    if (J.empty())
+    {
+        std::vector<double> r_p(n_p), w_p(n_p);
+        std::vector<double> r_q(n_q), w_q(n_q);
+
+        zwgll_(r_p.data(), w_p.data(), &n_p);
+        zwgll_(r_q.data(), w_q.data(), &n_q);
+
+        J.resize(n_q * n_p);
+
+        for (int i = 0; i < n_q; i++)
+            for (int j = 1; j <= n_p; j++)
+                J[i * n_p + (j - 1)] = (DType)(hgll_(&j, &r_q[i], r_p.data(), &n_p));
+    }
+
+    // Sum factorization, one direction at a time
+    work[0].assign(elem_values, elem_values + n[0] * n[1] * n[2]);
+
+    for (int d = 0; d < dim; d++)
+    {
+        int stride = 1; for (int e = 0; e < d; e++) stride *= n[e];
+        int num_outer = 1; for (int e = d + 1; e < 3; e++) num_outer *= n[e];
+
+        work[1].assign(stride * n_q * num_outer, 0.0);
+
+        for (int o = 0; o < num_outer; o++)
+            for (int i = 0; i < n_q; i++)
+                for (int a = 0; a < n_p; a++)
+                    for (int s = 0; s < stride; s++)
+                        work[1][s + i * stride + o * stride * n_q] += J[i * n_p + a] * work[0][s + a * stride + o * stride * n_p];
+
+        n[d] = n_q;
+        std::swap(work[0], work[1]);
+    }
+
+    values.insert(values.end(), work[0].begin(), work[0].end());
+}
+
+template<typename DType>
+void Silo_Writer<DType>::add_element(int poly_degree, const DType *x, const DType *y, const DType *z)
+{
+    int n_x = output_points(poly_degree);
+    int n_xy = n_x * n_x;
+    int sub_degree = n_x - 1;
+
+    // Low-order sub-elements
+    if (dim == 2)
+    {
+        for (int s_y = 0; s_y < sub_degree; s_y++)
+        {
+            for (int s_x = 0; s_x < sub_degree; s_x++)
+            {
+                zones.push_back(num_points + (s_x + 0) + (s_y + 0) * n_x);
+                zones.push_back(num_points + (s_x + 1) + (s_y + 0) * n_x);
+                zones.push_back(num_points + (s_x + 1) + (s_y + 1) * n_x);
+                zones.push_back(num_points + (s_x + 0) + (s_y + 1) * n_x);
+            }
+        }
+    }
+    else
+    {
+        for (int s_z = 0; s_z < sub_degree; s_z++)
+        {
+            for (int s_y = 0; s_y < sub_degree; s_y++)
+            {
+                for (int s_x = 0; s_x < sub_degree; s_x++)
+                {
+                    zones.push_back(num_points + (s_x + 0) + (s_y + 0) * n_x + (s_z + 0) * n_xy);
+                    zones.push_back(num_points + (s_x + 1) + (s_y + 0) * n_x + (s_z + 0) * n_xy);
+                    zones.push_back(num_points + (s_x + 1) + (s_y + 1) * n_x + (s_z + 0) * n_xy);
+                    zones.push_back(num_points + (s_x + 0) + (s_y + 1) * n_x + (s_z + 0) * n_xy);
+                    zones.push_back(num_points + (s_x + 0) + (s_y + 0) * n_x + (s_z + 1) * n_xy);
+                    zones.push_back(num_points + (s_x + 1) + (s_y + 0) * n_x + (s_z + 1) * n_xy);
+                    zones.push_back(num_points + (s_x + 1) + (s_y + 1) * n_x + (s_z + 1) * n_xy);
+                    zones.push_back(num_points + (s_x + 0) + (s_y + 1) * n_x + (s_z + 1) * n_xy);
+                }
+            }
+        }
+    }
+
+    // Coordinates
+    interpolate(coordinates[0], x, poly_degree);
+    interpolate(coordinates[1], y, poly_degree);
+    if (dim == 3) interpolate(coordinates[2], z, poly_degree);
+
+    num_points += (dim == 2) ? n_xy : n_xy * n_x;
+    num_zones += (dim == 2) ? sub_degree * sub_degree : sub_degree * sub_degree * sub_degree;
+}
+
+template<typename DType>
+void Silo_Writer<DType>::add_field(const char *field_name)
+{
+    field_names.push_back(field_name);
+    field_values.push_back(std::vector<DType>());
+    field_values.back().reserve(num_points);
+}
+
+template<typename DType>
+void Silo_Writer<DType>::add_field_values(int poly_degree, const DType *elem_values)
+{
+    interpolate(field_values.back(), elem_values, poly_degree);
+}
+
+// Utility functions
+template<typename DType>
+void Silo_Writer<DType>::write(std::string output_name)
+{
+    wait();
+
+#if ASYNC_OUTPUT == 1
+    worker = std::thread(&Silo_Writer<DType>::write_files, this, output_name);
+#else
+    write_files(output_name);
+#endif
+}
+
+template<typename DType>
+void Silo_Writer<DType>::wait()
+{
+    if (worker.joinable()) worker.join();
+}
+
+template<typename DType>
+void Silo_Writer<DType>::write_files(std::string output_name)
+{
+    std::lock_guard<std::mutex> lock(silo_mutex());
+
+    int data_type = (typeid(DType) == typeid(double)) ? DB_DOUBLE : DB_FLOAT;
+    int num_vertices = (dim == 2) ? 4 : 8;
+    char silo_name[256];
+
+    DBSetDeprecateWarnings(0);
+
+    // Block of this rank
+    sprintf(silo_name, "%s.%d.silo", output_name.c_str(), proc_id);
+    DBfile *silo_file = DBCreate(silo_name, DB_CLOBBER, DB_LOCAL, "Field data", DB_PDB);
+
+    if (silo_file == NULL)
+    {
+        printf("ERROR: Couldn't create Silo file for \"p = %d\"\n", proc_id);
+        return;
+    }
+
+    DType *coordinates_ptr[] = { coordinates[0].data(), coordinates[1].data(), coordinates[2].data() };
+    int num_zone_points = (int)(zones.size());
+
+    DBPutZonelist(silo_file, "elements", num_zones, dim, zones.data(), num_zone_points, 0, &num_vertices, &num_zones, 1);
+    DBPutUcdmesh(silo_file, "mesh", dim, NULL, coordinates_ptr, num_points, num_zones, "elements", NULL, data_type, NULL);
+
+    for (unsigned int f = 0; f < field_names.size(); f++)
+        DBPutUcdvar1(silo_file, field_names[f].c_str(), "mesh", field_values[f].data(), num_points, NULL, 0, data_type, DB_NODECENT, NULL);
+
+    DBClose(silo_file);
+
+    // Root index (block names are relative to the directory of the root file)
+    if (proc_id > 0) return;
+
+    sprintf(silo_name, "%s.silo", output_name.c_str());
+    silo_file = DBCreate(silo_name, DB_CLOBBER, DB_LOCAL, "Multi-block index", DB_PDB);
+
+    if (silo_file == NULL)
+    {
+        printf("ERROR: Couldn't create Silo file\n");
+        return;
+    }
+
+    std::string block_name = output_name.substr(output_name.find_last_of('/') + 1);
+    std::vector<std::string> names(num_procs);
+    std::vector<char*> names_ptr(num_procs);
+    std::vector<int> mesh_types(num_procs, DB_UCDMESH);
+    std::vector<int> var_types(num_procs, DB_UCDVAR);
+
+    auto put_multiblock = [&](const std::string &object_name, bool is_mesh)
+    {
+        for (int p = 0; p < num_procs; p++)
+        {
+            names[p] = block_name + "." + std::to_string(p) + ".silo:" + object_name;
+            names_ptr[p] = (char*)(names[p].c_str());
+        }
+
+        if (is_mesh)
+            DBPutMultimesh(silo_file, object_name.c_str(), num_procs, names_ptr.data(), mesh_types.data(), NULL);
+        else
+            DBPutMultivar(silo_file, object_name.c_str(), num_procs, names_ptr.data(), var_types.data(), NULL);
+    };
+
+    put_multiblock("mesh", true);
+    for (auto &field_name : field_names) put_multiblock(field_name, false);
+
+    DBClose(silo_file);
+}
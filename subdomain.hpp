@@ -8,21 +8,6 @@
 #include <cuda_profiler_api.h>
 #include "config.hpp"
 
-extern "C"
-{
-    #define PREFIX gslib_
-    #define MPI
-    #define GLOBAL_LONG_LONG
-    #include "name.h"
-    #include "fail.h"
-    #include "c99.h"
-    #include "types.h"
-    #include "comm.h"
-    #include "gs_defs.h"
-    #include "mem.h"
-    #include "gs.h"
-}
-
 extern "C"
 {
     #include "_hypre_utilities.h"
@@ -33,11 +18,17 @@ extern "C"
 }
 
 #include "domain.hpp"
+#include "gather_scatter.hpp"
 #include "csr_matrix.hpp"
 #include "math.hpp"
+#include "multivector.hpp"
+#include "silo_writer.hpp"
 #include "timer.hpp"
+#include "wire_format.hpp"
 #include "AMG/vector.hpp"
 #include "AMG/csr_matrix.hpp"
+#include "AMG/element_operator.hpp"
+#include "AMG/dense_solver.hpp"
 
 // Class declaration
 #ifndef SUBDOMAIN_HPP
@@ -62,11 +53,22 @@ struct Stiffness_Operator
 
     occa::memory geom_fact[NUM_GEOM_FACTS];
     occa::memory geom_fact_ptr;
+    occa::memory mass_fact;
+
+    // Assembled operators keep the stiffness values in A's host copy and a lumped mass on the diagonal
+    std::vector<DType> mass_diag;
+    std::vector<int> diag_ptr;
 
     occa::memory element;
     occa::memory vertex;
     occa::memory level;
     occa::memory offset;
+
+    std::vector<int> level_offset;
+    std::vector<int> level_points;
+
+    // Stored element stiffness matrices of the levels that do not use the matrix-free kernels
+    std::vector<occa::memory> element_matrix;
 };
 
 template<typename DType>
@@ -78,6 +80,10 @@ class Subdomain
         std::vector<occa::memory> work_dev;
         occa::memory work_dev_ptr;
 
+        // Arena requests taken after the single plan of the subdomain workspaces
+        std::vector<int> solver_handle;
+        std::vector<int> element_matrix_handle;
+
         // Geometry
         int poly_reduction;
         int subdomain_overlap;
@@ -99,14 +105,24 @@ class Subdomain
         // Coarse to fine interpolator
         std::map<std::pair<int, int>, std::pair<std::vector<DType>, occa::memory>> J_cf;
         occa::memory J_cf_ptr;
+        occa::memory J_tree;
 
         // Gather-scatter data
         std::vector<int> proc_count;
         std::vector<int> proc_offset;
 
-        comm gs_comm;
-        struct gs_data *gs_handle;
-        gs_dom gs_type = (typeid(DType) == typeid(double)) ? gs_double : gs_float;
+        Gather_Scatter<DType> gather_scatter;
+
+        // Coarse grid exchange
+        MPI_Comm coarse_comm = MPI_COMM_NULL;
+        std::vector<int> coarse_send_idx;
+        std::vector<int> coarse_send_count;
+        std::vector<int> coarse_send_offset;
+        std::vector<int> coarse_recv_count;
+        std::vector<int> coarse_recv_offset;
+        std::vector<DType> coarse_send_buffer;
+        Wire_Format<DType> coarse_wire_send;
+        Wire_Format<DType> coarse_wire_recv;
 
         // Reference operator
         std::vector<std::pair<std::vector<DType>, occa::memory>> D_hat;
@@ -120,6 +136,10 @@ class Subdomain
         int subdomain_offset;
         Stiffness_Operator<DType> subdomain_operator;
 
+        bool concurrent_levels = false;
+        occa::stream default_stream;
+        std::vector<occa::stream> level_stream;
+
         // Superdomain operator
         CSR_Matrix<DType> Qt_coarse;
 
@@ -144,6 +164,8 @@ class Subdomain
         hypre_ParAMGData *amg_data;
 
         std::vector<amg::CSR_Matrix> A_fem;
+        amg::Element_Operator element_operator_fem;
+        bool matrix_free_fem = MATRIX_FREE_FEM;
         std::vector<amg::Vector> D_val_fem;
         std::vector<amg::Vector> coefs_fem;
         std::vector<amg::CSR_Matrix> P_fem;
@@ -155,6 +177,14 @@ class Subdomain
         std::vector<amg::Vector> r_fem;
         std::vector<amg::Vector> v_fem;
         std::vector<amg::Vector> w_fem;
+        amg::Dense_Solver coarse_solver_fem;
+
+        // Stiffness and mass values of every level in the pattern of A_fem (A = h1 K + h2 M along the fixed hierarchy)
+        std::vector<std::vector<Float>> K_val_fem;
+        std::vector<std::vector<Float>> M_val_fem;
+        std::vector<std::vector<Float>> K_diag_fem;
+        std::vector<std::vector<Float>> M_diag_fem;
+        std::vector<Float> lambda_fem;
 
         cudaStream_t cuda_stream;
         cudaGraph_t down_leg_graph;
@@ -162,8 +192,22 @@ class Subdomain
         cudaGraph_t up_leg_graph;
         cudaGraphExec_t up_leg_instance;
 
+        void capture_cycle_graphs();
         void low_order_preconditioner(occa::memory&, occa::memory&);
 
+        // Fast diagonalization preconditioner (per level 1D eigenvectors and eigenvalues of each Dirichlet case, per element
+        // dimensional scales and Dirichlet ends)
+        std::vector<occa::memory> fdm_S;
+        std::vector<occa::memory> fdm_lambda;
+        std::vector<occa::memory> fdm_scale;
+        std::vector<occa::memory> fdm_bc;
+        occa::memory fdm_weight;
+        occa::memory fdm_diagonal;
+
+        void coarse_correction();
+        void fast_diagonalization_preconditioner(occa::memory&, occa::memory&);
+        void preconditioner(occa::memory&, occa::memory&);
+
         // Solver
         int num_dofs;
         int num_blocks;
@@ -178,13 +222,24 @@ class Subdomain
         occa::memory z_k;
         occa::memory p_k;
 
-        std::vector<occa::memory> V;
-        std::vector<occa::memory> Z;
+        Multivector<DType> V;
+        Multivector<DType> Z;
+        std::vector<DType> basis_coefs;
         std::vector<std::vector<DType>> H;
         std::vector<DType> c_gmres;
         std::vector<DType> s_gmres;
         std::vector<DType> gamma;
 
+        // Assembled copy of the basis (Arnoldi inner products and the s-step Gram matrix)
+        Multivector<DType> V_assembled;
+        occa::memory V_assembled_ptr;
+
+        // s-step GMRES (Chebyshev interval taken from the Ritz values of the last cycle)
+        double s_step_center = 0.0;
+        double s_step_half_width = 0.0;
+
+        bool s_step_cycle(int, int&, DType, DType, bool, bool, bool&);
+
         void initialize_arrays(occa::memory&, occa::memory&, occa::memory&);
         void tree_operator(occa::memory&, occa::memory&);
         void residual_norm(DType&, occa::memory&);
@@ -194,23 +249,44 @@ class Subdomain
         void search_update_inner_product(DType&, occa::memory&, occa::memory&, occa::memory&);
         void residual_and_search_update(occa::memory&, occa::memory&, occa::memory&, occa::memory&, DType);
         void assembled_inner_product(DType&, occa::memory&, occa::memory&);
+        void assembled_inner_products(DType*, occa::memory&, int);
+        void assemble_basis_vector(int);
 
         // Utility functions
         Math<DType> math;
+        Silo_Writer<DType> silo_writer;
 
         // Kernels
+        Subdomain();
+        void build_kernels(const char*);
+        void select_level_operators();
+        void stiffness_matrix_level(int, occa::memory&, occa::memory&, DType, DType);
+
         occa::kernel copy_from_domain_data_kernel; 
         occa::kernel copy_to_domain_data_kernel;
         occa::kernel restriction_1_kernel;
         occa::kernel restriction_2_kernel;
         occa::kernel restriction_3_kernel;
+        occa::kernel fused_restriction_kernel;
+        bool use_fused_restriction = false;
 
         occa::kernel initialize_arrays_kernel;
         occa::kernel stiffness_matrix_1_kernel;
         occa::kernel stiffness_matrix_2_kernel;
+        std::vector<occa::kernel> stiffness_matrix_fused_level_kernel;
+        std::vector<occa::kernel> stiffness_matrix_1_level_kernel;
+        std::vector<occa::kernel> stiffness_matrix_2_level_kernel;
+        std::vector<bool> use_fused_level;
+        std::vector<occa::kernel> stiffness_matrix_element_level_kernel;
+        std::vector<occa::kernel> unit_vector_level_kernel;
+        std::vector<occa::kernel> element_matrix_column_level_kernel;
+        std::vector<occa::kernel> fdm_contraction_level_kernel;
+        std::vector<occa::kernel> fdm_scaling_level_kernel;
+        occa::kernel diagonal_scaling_kernel;
         occa::kernel inner_product_kernel;
         occa::kernel weighted_inner_product_kernel;
         occa::kernel projection_inner_products_kernel;
+        occa::kernel gram_matrix_kernel;
         occa::kernel solution_and_residual_update_kernel;
         occa::kernel search_update_inner_product_kernel;
         occa::kernel residual_and_search_update_kernel;
@@ -221,21 +297,36 @@ class Subdomain
 
         // Constructor and destructor
         template<typename PType>
-        Subdomain(std::unordered_map<int, PType>, int, int, int = 1, int = 1);
+        Subdomain(std::unordered_map<int, PType>&, int, int, int = 1, int = 1, int = 0, int = 1, int = SUBDOMAIN_PRECONDITIONER);
         ~Subdomain();
 
+        static void prebuild_kernels(int, int, const char*);
+
         // Solver
         int num_iterations = 0;
+        int last_iterations = 0;
         int num_vectors = 4;
         int max_iterations = 4;
         bool use_preconditioner = true;
+        int local_preconditioner = SUBDOMAIN_PRECONDITIONER;
         DType tolerance = (typeid(DType) == typeid(double)) ? 1.0e-12 : 1.0e-06;
         DType epsilon = (typeid(DType) == typeid(double)) ? 1.0e-12 : 1.0e-06;
 
+        // Helmholtz coefficients of (h1 A + h2 B) u (the mass and stiffness parts are only kept when they can change)
+        DType h1 = 1.0;
+        DType h2 = 0.0;
+        bool keep_coefficients = HELMHOLTZ_REFRESH;
+
         // Preconditioner
         int num_vcycles = 1;
         int cheby_order = 2;
         int level_cutoff = 5;
+        int max_coarse_size = 9;
+        int coarse_inverse_cutoff = 1024;
+
+        // Part of the local elements owned by this subdomain
+        int part_offset;
+        int part_points;
 
         // Elements
         int num_values;
@@ -244,9 +335,21 @@ class Subdomain
         // Member functions
         void direct_stiffness_summation(occa::memory&, occa::memory&);
         void stiffness_matrix(occa::memory&, occa::memory&);
+        void refresh_coefficients(DType, DType);
         void flexible_conjugate_gradient(occa::memory&, occa::memory&, bool = true, bool = false);
         void generalized_minimum_residual(occa::memory&, occa::memory&, bool = true, bool = false);
 
+        // Solver stages (tree collection communicates, local solve does not)
+        void flexible_conjugate_gradient_tree(occa::memory&);
+        void flexible_conjugate_gradient_local(bool = true, bool = false);
+        void generalized_minimum_residual_tree(occa::memory&);
+        void generalized_minimum_residual_local(bool = true, bool = false);
+        void copy_solution(occa::memory&);
+
+        // Memory
+        void memory_usage();
+        void release_host_data(bool = false);
+
         // Visit output
         void output(std::string, int = 0, ...);
 };
@@ -5,11 +5,11 @@
 // Headers
 #include <cstdarg>
 #include <unistd.h>
-#include <silo.h>
 #include <unordered_map>
 #include <unordered_set>
 #include <set>
 #include <algorithm>
+#include "connectivity.hpp"
 #include "special_functions.hpp"
 #include "timer.hpp"
 
@@ -82,10 +82,52 @@ void update_field(amg::Vector &u, const amg::Vector &w, const amg::Vector &D_val
     }
 }
 
+extern "C" void vector_scale(Float*, const Float, const int, cudaStream_t);
+
+// Power iteration estimate of the largest eigenvalue of D A D (the Chebyshev smoothers only need it up to a few percent)
+Float scaled_max_eigenvalue(amg::CSR_Matrix &A, const amg::Vector &D_val, amg::Vector &x, amg::Vector &y, amg::Vector &work, const int num_iterations)
+{
+    Float lambda = 0.0;
+
+    if (A.num_rows <= 0) return lambda;
+
+    x.set_to_value(1.0 / std::sqrt((Float)(A.num_rows)));
+
+    for (int it = 0; it < num_iterations; it++)
+    {
+        if (strcmp(A.mem_loc, "host") == 0)
+        {
+            for (int row = 0; row < A.num_rows; row++) work.data[row] = D_val.data[row] * x.data[row];
+            A.matvec(y, work, 1.0, 0.0);
+            for (int row = 0; row < A.num_rows; row++) y.data[row] *= D_val.data[row];
+        }
+        else
+        {
+            vector_multiplication(work.data, D_val.data, x.data, A.num_rows, work.stream);
+            A.matvec(y, work, 1.0, 0.0);
+            vector_multiplication(y.data, D_val.data, y.data, A.num_rows, work.stream);
+        }
+
+        lambda = x.dot_product(y);
+
+        Float y_norm = y.norm();
+        if (y_norm <= 0.0) break;
+
+        x.copy_from(y);
+
+        if (strcmp(x.mem_loc, "host") == 0)
+            for (int row = 0; row < A.num_rows; row++) x.data[row] /= y_norm;
+        else
+            vector_scale(x.data, 1.0 / y_norm, A.num_rows, x.stream);
+    }
+
+    return lambda;
+}
+
 // Constructor and destructor
 template<typename DType>
 template<typename PType>
-Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_degree_, int poly_reduction_, int subdomain_overlap_, int superdomain_overlap_)
+Subdomain<DType>::Subdomain(std::unordered_map<int, PType> &domains, int poly_degree_, int poly_reduction_, int subdomain_overlap_, int superdomain_overlap_, int part_id_, int num_parts_, int local_preconditioner_)
 {
     // Fine level
     PType &domain = domains[poly_degree_];
@@ -94,6 +136,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     poly_reduction = poly_reduction_;
     subdomain_overlap = subdomain_overlap_;
     superdomain_overlap = superdomain_overlap_;
+    local_preconditioner = local_preconditioner_;
 
     poly_degree.push_back(poly_degree_);
 
@@ -125,6 +168,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
 
     int num_work_dev = dim;
     work_dev.resize(num_work_dev);
+    std::vector<int> work_handle(num_work_dev);
 
     // Prolongation/restriction reference operators
     std::vector<double> r_gll[num_levels];
@@ -158,11 +202,26 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
                 for (int j = 1; j <= n_c; j++)
                     J_cf[idx].first[i * n_c + (j - 1)] = (DType)(hgll_(&j, &r_gll[l_f][i], r_gll[l_c].data(), &n_c));
 
-            J_cf[idx].second = device.malloc<DType>(n_c * n_f);
+            J_cf[idx].second = device_malloc<DType>(n_c * n_f);
             J_cf[idx].second.copyFrom(J_cf[idx].first.data(), n_c * n_f * sizeof(DType));
         }
     }
 
+    // Interpolators between consecutive levels, back to back in tree order
+    std::vector<DType> J_tree_hst;
+
+    for (int l = 0; l < num_levels - 1; l++)
+    {
+        auto &J = J_cf[std::pair<int, int>(poly_degree[l + 1], poly_degree[l])].first;
+        J_tree_hst.insert(J_tree_hst.end(), J.begin(), J.end());
+    }
+
+    if (J_tree_hst.size() > 0)
+    {
+        J_tree = device_malloc<DType>(J_tree_hst.size());
+        J_tree.copyFrom(J_tree_hst.data(), J_tree_hst.size() * sizeof(DType));
+    }
+
     // Operator
     std::vector<DType*> D_hat_ptr_hst(num_levels);
     D_hat.resize(num_levels);
@@ -178,12 +237,12 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
         dgll_(Dt_gll.data(), D_gll.data(), r_gll[l].data(), &n_l, &n_l);
         for (int ij = 0; ij < n_l * n_l; ij++) D_hat[l].first[ij] = (DType)(D_gll[ij]);
 
-        D_hat[l].second = device.malloc<DType>(n_l * n_l);
+        D_hat[l].second = device_malloc<DType>(n_l * n_l);
         D_hat[l].second.copyFrom(D_hat[l].first.data(), n_l * n_l * sizeof(DType));
         D_hat_ptr_hst[l] = (DType*)(D_hat[l].second.ptr());
     }
 
-    D_hat_ptr = device.malloc<DType*>(num_levels * sizeof(DType*));
+    D_hat_ptr = device_malloc<DType*>(num_levels * sizeof(DType*));
     D_hat_ptr.copyFrom(D_hat_ptr_hst.data(), num_levels * sizeof(DType*));
 
     for (int l = 0; l < num_levels; l++)
@@ -204,15 +263,18 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     int num_local_elements = domain.num_local_elements;
     int num_total_points = num_total_elements * num_vertices;
 
+    // Expansion scratch (the work arrays proper are sized once the coarsening tree is known, the device scratch only lives
+    // through the region expansion and is released before the subdomain workspaces are planned)
     for (int d = 0; d < dim; d++)
     {
         int size = std::max({ num_total_elements, domain.num_local_points, num_levels });
+        size = (typeid(DType) == typeid(double)) ? size : 2 * size;
 
-        work_hst[d].resize((typeid(DType) == typeid(double)) ? size : 2 * size);
-        work_dev[d].free();
-        work_dev[d] = device.malloc<DType>((typeid(DType) == typeid(double)) ? size : 2 * size);
+        work_hst[d].resize(size);
     }
 
+    for (int d = 0; d < 2; d++) work_dev[d] = device_malloc<DType>(num_total_elements);
+
     proc_count.resize(num_procs);
     proc_offset.resize(num_procs);
 
@@ -279,155 +341,31 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
         }
     }
 
-    // Mesh connectivity
-    std::vector<std::vector<std::set<int>>> vert_conn(num_total_elements, std::vector<std::set<int>>(num_vertices));
-    std::vector<std::vector<std::set<int>>> edge_conn(num_total_elements, std::vector<std::set<int>>(num_edges));
-    std::vector<std::vector<std::set<int>>> face_conn(num_total_elements, std::vector<std::set<int>>(num_faces));
-
-    CSR_Matrix<DType> expander;
-
-    if (dim >= 1) // Vertices
-    {
-        std::map<long long, std::set<int>> vertices;
-
-        for (int e = 0; e < num_total_elements; e++)
-            for (int vid = 0; vid < num_vertices; vid++)
-                vertices[geometry_mesh[e * num_vertices + vid]].insert(e);
-
-        for (int e = 0; e < num_total_elements; e++)
-        {
-            for (int vid = 0; vid < num_vertices; vid++)
-            {
-                std::set<int> &neighbors = vertices[geometry_mesh[e * num_vertices + vid]];
-                vert_conn[e][vid].insert(neighbors.begin(), neighbors.end());
-                vert_conn[e][vid].erase(e);
-            }
-        }
-    }
-
-    if (dim == 2) // Edges
-    {
-        std::map<std::tuple<long long, long long>, std::set<int>> edges;
-        std::vector<long long> edge(2);
-        std::vector<std::tuple<int, int>> edge_pairs
-        {
-            std::tuple<int, int>(0, 1), 
-            std::tuple<int, int>(2, 3), 
-            std::tuple<int, int>(0, 2), 
-            std::tuple<int, int>(1, 3)
-        };
+    // Mesh connectivity (sorted entity records instead of node-based maps, built with all threads)
+    std::vector<std::vector<int>> vertex_list(num_vertices);
+    for (int vid = 0; vid < num_vertices; vid++) vertex_list[vid] = { vid };
 
-        for (int e = 0; e < num_total_elements; e++)
-        {
-            for (auto edge_pair : edge_pairs)
-            {
-                edge[0] = geometry_mesh[e * num_vertices + std::get<0>(edge_pair)];
-                edge[1] = geometry_mesh[e * num_vertices + std::get<1>(edge_pair)];
-                std::sort(edge.begin(), edge.end());
-                edges[std::tuple<long long, long long>(edge[0], edge[1])].insert(e);
-            }
-        }
+    std::vector<std::vector<int>> edge_list;
 
-        for (int e = 0; e < num_total_elements; e++)
-        {
-            for (int eid = 0; eid < num_edges; eid++)
-            {
-                edge[0] = geometry_mesh[e * num_vertices + std::get<0>(edge_pairs[eid])];
-                edge[1] = geometry_mesh[e * num_vertices + std::get<1>(edge_pairs[eid])];
-                std::sort(edge.begin(), edge.end());
-                std::set<int> &neighbors = edges[std::tuple<long long, long long>(edge[0], edge[1])];
-                edge_conn[e][eid].insert(neighbors.begin(), neighbors.end());
-                edge_conn[e][eid].erase(e);
-            }
-        }
-    }
+    if (dim == 2)
+        edge_list = { { 0, 1 }, { 2, 3 }, { 0, 2 }, { 1, 3 } };
     else
-    {
-        std::map<std::tuple<long long, long long>, std::set<int>> edges;
-        std::vector<long long> edge(2);
-        std::vector<std::tuple<int, int>> edge_pairs
-        {
-            std::tuple<int, int>(0, 1), 
-            std::tuple<int, int>(2, 3), 
-            std::tuple<int, int>(0, 2), 
-            std::tuple<int, int>(1, 3), 
-            std::tuple<int, int>(4, 5), 
-            std::tuple<int, int>(6, 7), 
-            std::tuple<int, int>(4, 6), 
-            std::tuple<int, int>(5, 7), 
-            std::tuple<int, int>(0, 4), 
-            std::tuple<int, int>(1, 5), 
-            std::tuple<int, int>(2, 6), 
-            std::tuple<int, int>(3, 7), 
-        };
+        edge_list = { { 0, 1 }, { 2, 3 }, { 0, 2 }, { 1, 3 }, { 4, 5 }, { 6, 7 }, { 4, 6 }, { 5, 7 }, { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 } };
 
-        for (int e = 0; e < num_total_elements; e++)
-        {
-            for (auto edge_pair : edge_pairs)
-            {
-                edge[0] = geometry_mesh[e * num_vertices + std::get<0>(edge_pair)];
-                edge[1] = geometry_mesh[e * num_vertices + std::get<1>(edge_pair)];
-                std::sort(edge.begin(), edge.end());
-                edges[std::tuple<long long, long long>(edge[0], edge[1])].insert(e);
-            }
-        }
+    std::vector<std::vector<int>> face_list;
 
-        for (int e = 0; e < num_total_elements; e++)
-        {
-            for (int eid = 0; eid < num_edges; eid++)
-            {
-                edge[0] = geometry_mesh[e * num_vertices + std::get<0>(edge_pairs[eid])];
-                edge[1] = geometry_mesh[e * num_vertices + std::get<1>(edge_pairs[eid])];
-                std::sort(edge.begin(), edge.end());
-                std::set<int> &neighbors = edges[std::tuple<long long, long long>(edge[0], edge[1])];
-                edge_conn[e][eid].insert(neighbors.begin(), neighbors.end());
-                edge_conn[e][eid].erase(e);
-            }
-        }
-    }
+    if (dim == 3)
+        face_list = { { 0, 1, 2, 3 }, { 4, 5, 6, 7 }, { 0, 1, 4, 5 }, { 2, 3, 6, 7 }, { 0, 2, 4, 6 }, { 1, 3, 5, 7 } };
 
-    if (dim == 3) // Faces
-    {
-        std::map<std::tuple<long long, long long, long long, long long>, std::set<int>> faces;
-        std::vector<long long> face(4);
-        std::vector<std::tuple<long long, long long, long long, long long>> face_pairs
-        {
-            std::tuple<long long, long long, long long, long long>(0, 1, 2, 3), 
-            std::tuple<long long, long long, long long, long long>(4, 5, 6, 7), 
-            std::tuple<long long, long long, long long, long long>(0, 1, 4, 5), 
-            std::tuple<long long, long long, long long, long long>(2, 3, 6, 7), 
-            std::tuple<long long, long long, long long, long long>(0, 2, 4, 6), 
-            std::tuple<long long, long long, long long, long long>(1, 3, 5, 7), 
-        };
+    Entity_Connectivity vert_conn;
+    Entity_Connectivity edge_conn;
+    Entity_Connectivity face_conn;
 
-        for (int e = 0; e < num_total_elements; e++)
-        {
-            for (auto face_pair : face_pairs)
-            {
-                face[0] = geometry_mesh[e * num_vertices + std::get<0>(face_pair)];
-                face[1] = geometry_mesh[e * num_vertices + std::get<1>(face_pair)];
-                face[2] = geometry_mesh[e * num_vertices + std::get<2>(face_pair)];
-                face[3] = geometry_mesh[e * num_vertices + std::get<3>(face_pair)];
-                std::sort(face.begin(), face.end());
-                faces[std::tuple<long long, long long, long long, long long>(face[0], face[1], face[2], face[3])].insert(e);
-            }
-        }
+    entity_connectivity(vert_conn, geometry_mesh, num_total_elements, num_vertices, vertex_list);
+    entity_connectivity(edge_conn, geometry_mesh, num_total_elements, num_vertices, edge_list);
+    entity_connectivity(face_conn, geometry_mesh, num_total_elements, num_vertices, face_list);
 
-        for (int e = 0; e < num_total_elements; e++)
-        {
-            for (int fid = 0; fid < num_faces; fid++)
-            {
-                face[0] = geometry_mesh[e * num_vertices + std::get<0>(face_pairs[fid])];
-                face[1] = geometry_mesh[e * num_vertices + std::get<1>(face_pairs[fid])];
-                face[2] = geometry_mesh[e * num_vertices + std::get<2>(face_pairs[fid])];
-                face[3] = geometry_mesh[e * num_vertices + std::get<3>(face_pairs[fid])];
-                std::sort(face.begin(), face.end());
-                std::set<int> &neighbors = faces[std::tuple<long long, long long, long long, long long>(face[0], face[1], face[2], face[3])];
-                face_conn[e][fid].insert(neighbors.begin(), neighbors.end());
-                face_conn[e][fid].erase(e);
-            }
-        }
-    }
+    CSR_Matrix<DType> expander;
 
     // Matrix construction
     expander.initialize(num_total_elements, num_total_elements);
@@ -436,17 +374,10 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     {
         expander.add_entry(e_i, e_i, 1.0);
 
-        for (auto data : vert_conn[e_i])
-            for (auto e_j : data)
-                expander.add_entry(e_i, e_j, 1.0);
-
-        for (auto data : edge_conn[e_i])
-            for (auto e_j : data)
-                expander.add_entry(e_i, e_j, 1.0);
-
-        for (auto data : face_conn[e_i])
-            for (auto e_j : data)
-                expander.add_entry(e_i, e_j, 1.0);
+        for (auto conn : { &vert_conn, &edge_conn, &face_conn })
+            for (int s = e_i * conn->num_entities; s < (e_i + 1) * conn->num_entities; s++)
+                for (int k = conn->ptr[s]; k < conn->ptr[s + 1]; k++)
+                    expander.add_entry(e_i, conn->neighbors[k], 1.0);
     }
 
     expander.assemble();
@@ -465,7 +396,14 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     num_subdomain_extended_elems = 0;
     num_superdomain_extended_elems = 0;
 
-    for (int e = 0; e < num_local_elements; e++)
+    // Core elements of this part
+    int part_start = (num_local_elements * part_id_) / num_parts_;
+    int part_end = (num_local_elements * (part_id_ + 1)) / num_parts_;
+
+    part_offset = part_start * (int)(std::pow(poly_degree[0] + 1, dim));
+    part_points = (part_end - part_start) * (int)(std::pow(poly_degree[0] + 1, dim));
+
+    for (int e = part_start; e < part_end; e++)
     {
         subdomain_region.push_back(Element<DType>(proc_offset[proc_id] + e, dim, poly_degree[0]));
         subdomain_partition[proc_offset[proc_id] + e] = num_subdomain_elems + 1;
@@ -476,10 +414,10 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     work_hst[0].assign(num_total_elements, 0.0);
     work_hst[1].assign(num_total_elements, 0.0);
 
-    for (int e = 0; e < num_local_elements; e++)
+    for (int e = part_start; e < part_end; e++)
     {
         work_hst[0][proc_offset[proc_id] + e] = 1.0;
-        work_hst[1][proc_offset[proc_id] + e] = (DType)(e + 1);
+        work_hst[1][proc_offset[proc_id] + e] = (DType)(e - part_start + 1);
     }
 
     work_dev[0].copyFrom(work_hst[0].data(), num_total_elements * sizeof(DType));
@@ -542,6 +480,8 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     expander.multiply(work_dev[1], work_dev[0]);
     work_dev[1].copyTo(work_hst[0].data(), num_total_elements * sizeof(DType));
 
+    for (int d = 0; d < 2; d++) work_dev[d].free();
+
     for (int e = 0; e < num_total_elements; e++)
     {
         if ((work_hst[0][e] > 0.0) and (work_hst[1][e] > 0.0))
@@ -579,8 +519,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     }
 
     // Coarsening tree
-    std::unordered_map<int, int> total_points_offset(num_levels);
-    total_points_offset[poly_degree[0]] = 0;
+    std::vector<int> total_points_offset(poly_degree[0] + 1);
 
     for (int l = 1; l < num_levels; l++)
         total_points_offset[poly_degree[l]] += total_points_offset[poly_degree[l - 1]] + num_total_elements * std::pow(poly_degree[l - 1] + 1, dim);
@@ -588,16 +527,11 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     for (int d = 0; d < dim; d++)
     {
         int size = std::max({ (int)(work_hst[d].size()), total_points_offset[poly_degree[num_levels - 1]] + num_total_elements * (int)(std::pow(poly_degree[num_levels - 1] + 1, dim)) + num_subdomain_extended_points + num_superdomain_extended_points });
+        size = (typeid(DType) == typeid(double)) ? size : 2 * size;
 
-        work_hst[d].resize((typeid(DType) == typeid(double)) ? size : 2 * size);
-        work_dev[d].free();
-        work_dev[d] = device.malloc<DType>((typeid(DType) == typeid(double)) ? size : 2 * size);
+        work_hst[d].resize(size);
     }
 
-    for (int w = 0; w < num_work_dev; w++) ((DType**)(work_hst[0].data()))[w] = (DType*)(work_dev[w].ptr());
-    work_dev_ptr = device.malloc<DType*>(num_work_dev * sizeof(DType*));
-    work_dev_ptr.copyFrom(work_hst[0].data(), num_work_dev * sizeof(DType*));
-
     int loc_off = 0;
 
     for (int l = 0; l < num_levels; l++)
@@ -638,8 +572,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
             ((long long*)(work_hst[0].data()))[loc_off++] = - (glo_off + v + 1);
     }
 
-    comm_init(&gs_comm, MPI_COMM_WORLD);
-    gs_handle = gslib_gs_setup((long long*)(work_hst[0].data()), loc_off, &gs_comm, 0, gs_auto, 1);
+    gather_scatter.setup((long long*)(work_hst[0].data()), loc_off);
 
     // Computational regions setup
     int level_offset = 0;
@@ -654,7 +587,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     }
 
     memset(work_hst[0].data() + subdomain_offset, 0, (num_subdomain_extended_points + num_superdomain_extended_points) * sizeof(DType));
-    gslib_gs(work_hst[0].data(), gs_type, gs_add, 0, gs_handle, NULL);
+    gather_scatter.apply(work_hst[0].data());
 
     for (auto &elem : subdomain_region)
         for (int v = 0; v < elem.num_points; v++)
@@ -678,28 +611,45 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
         }
 
         memset(work_hst[0].data() + subdomain_offset, 0, (num_subdomain_extended_points + num_superdomain_extended_points) * sizeof(DType));
-        gslib_gs(work_hst[0].data(), gs_type, gs_add, 0, gs_handle, NULL);
+        gather_scatter.apply(work_hst[0].data());
 
-        subdomain_operator.geom_fact[g] = device.malloc<DType>(num_subdomain_extended_points);
+        subdomain_operator.geom_fact[g] = device_malloc<DType>(num_subdomain_extended_points);
         subdomain_operator.geom_fact[g].copyFrom(work_hst[0].data() + subdomain_offset, num_subdomain_extended_points * sizeof(DType));
 
         for (int g = 0; g < NUM_GEOM_FACTS; g++) ((DType**)(work_hst[0].data()))[g] = (DType*)(subdomain_operator.geom_fact[g].ptr());
-        subdomain_operator.geom_fact_ptr = device.malloc<DType*>(NUM_GEOM_FACTS * sizeof(DType*));
+        subdomain_operator.geom_fact_ptr = device_malloc<DType*>(NUM_GEOM_FACTS * sizeof(DType*));
         subdomain_operator.geom_fact_ptr.copyFrom(work_hst[0].data(), NUM_GEOM_FACTS * sizeof(DType*));
 
         if (num_superdomain_extended_points > 0)
         {
-            superdomain_operator.geom_fact[g] = device.malloc<DType>(num_superdomain_extended_points);
+            superdomain_operator.geom_fact[g] = device_malloc<DType>(num_superdomain_extended_points);
             superdomain_operator.geom_fact[g].copyFrom(work_hst[0].data() + superdomain_offset, num_superdomain_extended_points * sizeof(DType));
 
             for (int g = 0; g < NUM_GEOM_FACTS; g++) ((DType**)(work_hst[0].data()))[g] = (DType*)(superdomain_operator.geom_fact[g].ptr());
-            superdomain_operator.geom_fact_ptr = device.malloc<DType*>(NUM_GEOM_FACTS * sizeof(DType*));
+            superdomain_operator.geom_fact_ptr = device_malloc<DType*>(NUM_GEOM_FACTS * sizeof(DType*));
             superdomain_operator.geom_fact_ptr.copyFrom(work_hst[0].data(), NUM_GEOM_FACTS * sizeof(DType*));
         }
     }
 
     level_offset = 0;
 
+    for (int l = 0; l < num_levels; l++)
+    {
+        for (auto &dlem : domains[poly_degree[l]].elements)
+            for (int v = 0; v < dlem.num_points; v++)
+                work_hst[0][level_offset + dlem.offset + v] = dlem.mass_fact[v];
+
+        level_offset += num_local_elements * (int)(std::pow(poly_degree[l] + 1, dim));
+    }
+
+    memset(work_hst[0].data() + subdomain_offset, 0, (num_subdomain_extended_points + num_superdomain_extended_points) * sizeof(DType));
+    gather_scatter.apply(work_hst[0].data());
+
+    subdomain_operator.mass_fact = device_malloc<DType>(num_subdomain_extended_points);
+    subdomain_operator.mass_fact.copyFrom(work_hst[0].data() + subdomain_offset, num_subdomain_extended_points * sizeof(DType));
+
+    level_offset = 0;
+
     for (int l = 0; l < num_levels; l++)
     {
         for (auto &dlem : domains[poly_degree[l]].elements)
@@ -710,7 +660,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     }
 
     memset(work_hst[0].data() + subdomain_offset, 0, (num_subdomain_extended_points + num_superdomain_extended_points) * sizeof(DType));
-    gslib_gs(work_hst[0].data(), gs_type, gs_add, 0, gs_handle, NULL);
+    gather_scatter.apply(work_hst[0].data());
 
     for (auto &elem : subdomain_region)
         for (int v = 0; v < elem.num_points; v++)
@@ -743,7 +693,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
         }
 
         memset(work_hst[0].data() + subdomain_offset, 0, (num_subdomain_extended_points + num_superdomain_extended_points) * sizeof(DType));
-        gslib_gs(work_hst[0].data(), gs_type, gs_add, 0, gs_handle, NULL);
+        gather_scatter.apply(work_hst[0].data());
 
         for (auto &elem : subdomain_region)
             for (int v = 0; v < elem.num_points; v++)
@@ -768,7 +718,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
         }
 
         memset(work_hst[0].data() + subdomain_offset, 0, (num_subdomain_extended_points + num_superdomain_extended_points) * sizeof(DType));
-        gslib_gs(work_hst[0].data(), gs_type, gs_add, 0, gs_handle, NULL);
+        gather_scatter.apply(work_hst[0].data());
 
         for (auto &elem : subdomain_region)
             for (int v = 0; v < elem.num_points; v++)
@@ -793,7 +743,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
         }
 
         memset(work_hst[0].data() + subdomain_offset, 0, (num_subdomain_extended_points + num_superdomain_extended_points) * sizeof(DType));
-        gslib_gs(work_hst[0].data(), gs_type, gs_add, 0, gs_handle, NULL);
+        gather_scatter.apply(work_hst[0].data());
 
         for (auto &elem : subdomain_region)
             for (int v = 0; v < elem.num_points; v++)
@@ -855,78 +805,48 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
         for (unsigned int e = 0; e < elements.size(); e++)
             mapping[elements[e].id] = e + 1;
 
-        for (auto &elem : elements)
-        {
-            // Vertices
-            for (int vid = 0; vid < num_vertices; vid++)
-                for (auto e_j : vert_conn[elem.id][vid])
-                    if (mapping[e_j] > 0)
-                        elem.vert_conn[vid].insert(mapping[e_j] - 1);
-
-            // Edges
-            for (int eid = 0; eid < num_edges; eid++)
-                for (auto e_j : edge_conn[elem.id][eid])
-                    if (mapping[e_j] > 0)
-                        elem.edge_conn[eid].insert(mapping[e_j] - 1);
-
-            // Faces
-            for (int fid = 0; fid < num_faces; fid++)
-                for (auto e_j : face_conn[elem.id][fid])
-                    if (mapping[e_j] > 0)
-                        elem.face_conn[fid].insert(mapping[e_j] - 1);
-        }
-    }
-
-    // Ranking function
-    auto ranking = [&](std::vector<DType> &data, int size)
-    {
-        if (size == 0) return;
-
-        std::vector<std::pair<unsigned int, DType>> entries(data.size());
-
-        for (int i = 0; i < size; i++)
+        // Mapped neighbours of every entity, sorted by region index
+        auto region_connectivity = [&](Element_Connectivity &elem_conn, const Entity_Connectivity &conn, int id)
         {
-            entries[i].first = i;
-            entries[i].second = data[i];
-        }
+            elem_conn.ptr.assign(conn.num_entities + 1, 0);
+            elem_conn.neighbors.clear();
 
-        std::sort(entries.begin(), entries.begin() + size, [&](const std::pair<unsigned int, DType> a, const std::pair<unsigned int, DType> b){ return a.second < b.second; });
+            for (int entity = 0; entity < conn.num_entities; entity++)
+            {
+                for (int k = conn.ptr[id * conn.num_entities + entity]; k < conn.ptr[id * conn.num_entities + entity + 1]; k++)
+                    if (mapping[conn.neighbors[k]] > 0)
+                        elem_conn.neighbors.push_back(mapping[conn.neighbors[k]] - 1);
 
-        DType value = entries[0].second;
-        DType rank = (value == 0.0) ? 0.0 : 1.0;
+                elem_conn.ptr[entity + 1] = elem_conn.neighbors.size();
+                std::sort(elem_conn.neighbors.begin() + elem_conn.ptr[entity], elem_conn.neighbors.end());
+            }
 
-        entries[0].second = rank;
+            elem_conn.neighbors.shrink_to_fit();
+        };
 
-        for (int i = 1; i < size; i++)
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int e = 0; e < (int)(elements.size()); e++)
         {
-            auto &entry = entries[i];
+            auto &elem = elements[e];
 
-            if (entry.second == value)
-            {
-                entry.second = rank;
-            }
-            else
-            {
-                rank += 1.0;
-                value = entry.second;
-                entry.second = rank;
-            }
+            region_connectivity(elem.vert_conn, vert_conn, elem.id);
+            region_connectivity(elem.edge_conn, edge_conn, elem.id);
+            region_connectivity(elem.face_conn, face_conn, elem.id);
         }
+    }
 
-        std::sort(entries.begin(), entries.begin() + size);
-        for (int i = 0; i < size; i++) data[i] = entries[i].second;
-    };
-
-    // Global numbering (need to zero out non-conforming edges
-    std::unordered_map<int, long long> global_offset;
-    global_offset[poly_degree[0]] = 0;
+    // Global numbering (need to zero out non-conforming edges, every element only writes its own numbers)
+    std::vector<long long> global_offset(poly_degree[0] + 1);
     for (int l = 1; l < num_levels; l++)
         global_offset[poly_degree[l]] = global_offset[poly_degree[l - 1]] + (long long)(domain.num_total_elements) * (long long)(std::pow(poly_degree[l - 1] + 1, dim));
 
     if (dim == 2)
     {
-        for (auto &elem : subdomain_region)
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int e = 0; e < (int)(subdomain_region.size()); e++)
         {
+            auto &elem = subdomain_region[e];
+
             std::vector<long long> corners({ elem.glo_num[             0 +              0 * elem.n_x], 
                                              elem.glo_num[(elem.n_x - 1) +              0 * elem.n_x], 
                                              elem.glo_num[             0 + (elem.n_y - 1) * elem.n_x], 
@@ -942,8 +862,11 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     }
     else
     {
-        for (auto &elem : subdomain_region)
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int e = 0; e < (int)(subdomain_region.size()); e++)
         {
+            auto &elem = subdomain_region[e];
+
             std::vector<long long> corners({ elem.glo_num[             0 +              0 * elem.n_x +              0 * elem.n_x * elem.n_y], 
                                              elem.glo_num[(elem.n_x - 1) +              0 * elem.n_x +              0 * elem.n_x * elem.n_y], 
                                              elem.glo_num[             0 + (elem.n_y - 1) * elem.n_x +              0 * elem.n_x * elem.n_y], 
@@ -968,8 +891,11 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
 
     if (dim == 2)
     {
-        for (auto &elem_i : subdomain_region)
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int e = 0; e < (int)(subdomain_region.size()); e++)
         {
+            auto &elem_i = subdomain_region[e];
+
             int n_x_i = elem_i.n_x;
             int n_y_i = elem_i.n_y;
 
@@ -999,8 +925,11 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     }
     else
     {
-        for (auto &elem_i : subdomain_region)
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int e = 0; e < (int)(subdomain_region.size()); e++)
         {
+            auto &elem_i = subdomain_region[e];
+
             int n_x_i = elem_i.n_x;
             int n_y_i = elem_i.n_y;
             int n_z_i = elem_i.n_z;
@@ -1158,7 +1087,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
             for (int v = 0; v < elem.num_points; v++)
                 work_hst[0][elem.offset + v] = (DType)(elem.glo_num[v]);
 
-        ranking(work_hst[0], num_points);
+        dense_ranking(work_hst[0], num_points);
 
         for (auto &elem : elements)
             for (int v = 0; v < elem.num_points; v++)
@@ -1168,7 +1097,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
             for (int v = 0; v < elem.num_points; v++)
                 work_hst[0][elem.offset + v] = (DType)(elem.glo_num[v]) * elem.dirichlet_mask[v];
 
-        ranking(work_hst[0], num_points);
+        dense_ranking(work_hst[0], num_points);
 
         for (auto &elem : elements)
             for (int v = 0; v < elem.num_points; v++)
@@ -1600,10 +1529,10 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     subdomain_operator.num_points = subdomain_operator.Q.num_rows;
     subdomain_operator.num_extended_dofs = subdomain_operator.Q.num_cols;
 
-    subdomain_operator.element = device.malloc<int>(subdomain_operator.num_points);
-    subdomain_operator.vertex = device.malloc<int>(subdomain_operator.num_points);
-    subdomain_operator.level = device.malloc<int>(subdomain_operator.num_points);
-    subdomain_operator.offset = device.malloc<int>(subdomain_operator.num_points);
+    subdomain_operator.element = device_malloc<int>(subdomain_operator.num_points);
+    subdomain_operator.vertex = device_malloc<int>(subdomain_operator.num_points);
+    subdomain_operator.level = device_malloc<int>(subdomain_operator.num_points);
+    subdomain_operator.offset = device_malloc<int>(subdomain_operator.num_points);
 
     for (auto &elem : subdomain_region)
         for (int v = 0; v < elem.num_points; v++)
@@ -1629,9 +1558,30 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
 
     subdomain_operator.offset.copyFrom(work_hst[0].data(), subdomain_operator.num_points * sizeof(int));
 
+    // Contiguous point range of every level (the region is built level by level, with non-increasing degrees)
+    subdomain_operator.level_offset.assign(num_levels, 0);
+    subdomain_operator.level_points.assign(num_levels, 0);
+
+    int last_level = 0;
+
+    for (auto &elem : subdomain_region)
+    {
+        int l = level_degree[elem.poly_degree];
+
+        if ((l < last_level) or ((subdomain_operator.level_points[l] > 0) and (elem.offset != subdomain_operator.level_offset[l] + subdomain_operator.level_points[l])))
+        {
+            pstdout("ERROR: Subdomain element %d of degree %d breaks the level ordering of the subdomain region\n", elem.id, elem.poly_degree);
+            quit();
+        }
+
+        if (subdomain_operator.level_points[l] == 0) subdomain_operator.level_offset[l] = elem.offset;
+        subdomain_operator.level_points[l] += elem.num_points;
+
+        last_level = l;
+    }
+
     // Superdomain stiffness operator setup
     PType &coarse_domain = domains[poly_degree[num_levels - 1]];
-    std::vector<DType> geom_fact_coarse[NUM_GEOM_FACTS];
 
     proc_count[proc_id] = num_local_elements * num_vertices;
     MPI_Allgather(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, proc_count.data(), 1, MPI_INT, MPI_COMM_WORLD);
@@ -1639,17 +1589,6 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     proc_offset[0] = 0;
     for (int p = 1; p < num_procs; p++) proc_offset[p] = proc_offset[p - 1] + proc_count[p - 1];
 
-    for (int g = 0; g < NUM_GEOM_FACTS; g++)
-    {
-        geom_fact_coarse[g].resize(num_vertices * num_total_elements);
-
-        for (auto &elem : coarse_domain.elements)
-            for (int v = 0; v < elem.num_points; v++)
-                geom_fact_coarse[g][proc_offset[proc_id] + (elem.id * num_vertices + v)] = elem.geom_fact[g][v];
-
-        MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, geom_fact_coarse[g].data(), proc_count.data(), proc_offset.data(), (typeid(DType) == typeid(double)) ? MPI_DOUBLE : MPI_FLOAT, MPI_COMM_WORLD);
-    }
-
     std::vector<long long> dof_num_coarse(num_vertices * num_total_elements);
 
     for (auto &elem : coarse_domain.elements)
@@ -1703,6 +1642,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
         for (int i = 0; i < size; i++) dof_num_coarse[i] = entries[i].second;
     }
 
+#if COARSE_EXCHANGE == 0
     Qt_coarse.initialize(num_coarse_dofs, num_total_elements * num_vertices);
 
     for (int e = 0; e < num_total_elements; e++)
@@ -1711,6 +1651,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
                 Qt_coarse.add_entry(dof_num_coarse[e * num_vertices + v] - 1, e * num_vertices + v, 1.0);
 
     Qt_coarse.assemble();
+#endif
 
     std::vector<std::vector<DType>> D(dim, std::vector<DType>(num_vertices * num_vertices));
 
@@ -1757,13 +1698,19 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     HYPRE_IJMatrixSetObjectType(A_coarse, HYPRE_PARCSR);
     HYPRE_IJMatrixInitialize_v2(A_coarse, HYPRE_MEMORY_HOST);
 
-    for (int e = 0; e < num_total_elements; e++)
+    // Coarse operator and lumped mass of the local elements (the geometry stays on its rank, only assembled rows are exchanged)
+    std::vector<std::pair<std::pair<int, int>, DType>> A_entries;
+    std::vector<std::pair<int, DType>> M_entries;
+
+    for (auto &elem : coarse_domain.elements)
     {
+        int e = proc_offset[proc_id] / num_vertices + elem.id;
+
         if (dim == 2)
         {
             for (int g = 0; g < NUM_GEOM_FACTS; g++)
                 for (int v = 0; v < 4; v++)
-                    G[g][v * 4 + v] = geom_fact_coarse[g][e * num_vertices + v];
+                    G[g][v * 4 + v] = elem.geom_fact[g][v];
 
             for (int i = 0; i < 4; i++)
             {
@@ -1794,7 +1741,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
         {
             for (int g = 0; g < NUM_GEOM_FACTS; g++)
                 for (int v = 0; v < 8; v++)
-                    G[g][v * 8 + v] = geom_fact_coarse[g][e * num_vertices + v];
+                    G[g][v * 8 + v] = elem.geom_fact[g][v];
 
             for (int i = 0; i < 8; i++)
             {
@@ -1825,24 +1772,128 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
                         A_e[i * 8 + j] += D[0][k * 8 + i] * GD[0][k * 8 + j] + D[1][k * 8 + i] * GD[1][k * 8 + j] + D[2][k * 8 + i] * GD[2][k * 8 + j];
         }
 
+        for (int i = 0; i < num_vertices; i++)
+        {
+            int row = dof_num_coarse[e * num_vertices + i] - 1;
+
+            if (row < 0) continue;
+
+            if (keep_coefficients) M_entries.push_back({ row, elem.mass_fact[i] });
+
+            for (int j = 0; j < num_vertices; j++)
+            {
+                int col = dof_num_coarse[e * num_vertices + j] - 1;
+
+                if (col >= 0) A_entries.push_back({ { row, col }, A_e[i * num_vertices + j] });
+            }
+        }
+    }
+
+    // Entries shared by local elements are summed before the exchange
+    auto merge_entries = [](auto &entries)
+    {
+        std::sort(entries.begin(), entries.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+        int num_merged = 0;
+
+        for (unsigned int i = 0; i < entries.size(); i++)
+        {
+            if ((num_merged > 0) and (entries[num_merged - 1].first == entries[i].first))
+                entries[num_merged - 1].second += entries[i].second;
+            else
+                entries[num_merged++] = entries[i];
+        }
+
+        entries.resize(num_merged);
+    };
+
+    merge_entries(A_entries);
+    merge_entries(M_entries);
+
+    // The redundant coarse AMG needs every assembled row (partially assembled rows of all ranks, one message each)
+    std::vector<int> entry_count(num_procs);
+    std::vector<int> entry_offset(num_procs);
+
+    auto gather_entries = [&](int num_local, int num_ints, std::vector<int> &idx, std::vector<DType> &val)
+    {
+        entry_count[proc_id] = num_local;
+        MPI_Allgather(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, entry_count.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+        entry_offset[0] = 0;
+        for (int p = 1; p < num_procs; p++) entry_offset[p] = entry_offset[p - 1] + entry_count[p - 1];
+
+        int num_entries = entry_offset[num_procs - 1] + entry_count[num_procs - 1];
+
+        std::vector<int> idx_local(idx);
+        std::vector<DType> val_local(val);
+        std::vector<int> idx_count(num_procs);
+        std::vector<int> idx_offset(num_procs);
+
+        for (int p = 0; p < num_procs; p++)
+        {
+            idx_count[p] = num_ints * entry_count[p];
+            idx_offset[p] = num_ints * entry_offset[p];
+        }
+
+        idx.resize(num_ints * num_entries);
+        val.resize(num_entries);
+
+        MPI_Allgatherv(idx_local.data(), idx_count[proc_id], MPI_INT, idx.data(), idx_count.data(), idx_offset.data(), MPI_INT, MPI_COMM_WORLD);
+        MPI_Allgatherv(val_local.data(), entry_count[proc_id], (typeid(DType) == typeid(double)) ? MPI_DOUBLE : MPI_FLOAT, val.data(), entry_count.data(), entry_offset.data(), (typeid(DType) == typeid(double)) ? MPI_DOUBLE : MPI_FLOAT, MPI_COMM_WORLD);
+    };
+
+    std::vector<int> A_idx(2 * A_entries.size());
+    std::vector<DType> A_val(A_entries.size());
+
+    for (unsigned int i = 0; i < A_entries.size(); i++)
+    {
+        A_idx[2 * i + 0] = A_entries[i].first.first;
+        A_idx[2 * i + 1] = A_entries[i].first.second;
+        A_val[i] = A_entries[i].second;
+    }
+
+    gather_entries((int)(A_entries.size()), 2, A_idx, A_val);
+    std::vector<std::pair<std::pair<int, int>, DType>>().swap(A_entries);
+
+    {
         int one = 1;
         int row;
         int col;
         DType val;
 
-        for (int i = 0; i < num_vertices; i++)
+        for (unsigned int i = 0; i < A_val.size(); i++)
         {
-            for (int j = 0; j < num_vertices; j++)
-            {
-                row = dof_num_coarse[e * num_vertices + i] - 1;
-                col = dof_num_coarse[e * num_vertices + j] - 1;
-                val = A_e[i * num_vertices + j];
+            row = A_idx[2 * i + 0];
+            col = A_idx[2 * i + 1];
+            val = A_val[i];
 
-                if ((row >= 0) and (col >= 0))
-                    if (std::abs(val) > epsilon)
-                        HYPRE_IJMatrixAddToValues(A_coarse, 1, &one, &row, &col, &val);
-            }
+            if (std::abs(val) > epsilon)
+                HYPRE_IJMatrixAddToValues(A_coarse, 1, &one, &row, &col, &val);
+        }
+    }
+
+    std::vector<int>().swap(A_idx);
+    std::vector<DType>().swap(A_val);
+
+    // Lumped coarse mass diagonal (gathered only for coefficient refreshes)
+    std::vector<HYPRE_Real> M_coarse;
+
+    if (keep_coefficients)
+    {
+        std::vector<int> M_idx(M_entries.size());
+        std::vector<DType> M_val(M_entries.size());
+
+        for (unsigned int i = 0; i < M_entries.size(); i++)
+        {
+            M_idx[i] = M_entries[i].first;
+            M_val[i] = M_entries[i].second;
         }
+
+        gather_entries((int)(M_entries.size()), 1, M_idx, M_val);
+        std::vector<std::pair<int, DType>>().swap(M_entries);
+
+        M_coarse.assign(num_coarse_dofs, 0.0);
+        for (unsigned int i = 0; i < M_val.size(); i++) M_coarse[M_idx[i]] += M_val[i];
     }
 
     HYPRE_IJMatrixAssemble(A_coarse);
@@ -1904,10 +1955,8 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
         }
     }
 
-    HYPRE_ParCSRMatrix P_sup_csr;
-    HYPRE_IJMatrix P_sup;
-    HYPRE_ParCSRMatrix A_sup_csr;
-    HYPRE_IJMatrix A_sup;
+    CSR_Matrix<HYPRE_Real> P_sup;
+    CSR_Matrix<HYPRE_Real> A_sup;
     std::vector<int> dof_sup;
 
     {
@@ -2079,11 +2128,8 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
         int num_dofs = offset;
 
         // Coarse to fine interpolator
-        std::vector<HYPRE_IJMatrix> P_c_mat(num_comp_levels - 1);
-        std::vector<HYPRE_ParCSRMatrix> P_c_csr(num_comp_levels - 1);
-
-        std::vector<HYPRE_IJMatrix> R_c_mat(num_comp_levels - 1);
-        std::vector<HYPRE_ParCSRMatrix> R_c_csr(num_comp_levels - 1);
+        std::vector<CSR_Matrix<HYPRE_Real>> P_c(num_comp_levels - 1);
+        std::vector<CSR_Matrix<HYPRE_Real>> R_c(num_comp_levels - 1);
 
         for (int l = num_comp_levels - 1; l > 0; l--)
         {
@@ -2175,8 +2221,6 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
             }
 
             // Construct level interpolator
-            int one = 1;
-
             int num_fine = num_overlap[l - 1];
             if (l - 1 == 0) num_fine += num_local[l - 1];
 
@@ -2185,43 +2229,37 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
                 int num_rows = num_nodes[l - 1];
                 int num_cols = num_local[l - 1] + num_overlap[l - 1] + num_overlap[l - 0] + num_remaining[l - 0];
 
-                HYPRE_IJMatrixCreate(MPI_COMM_SELF, 0, num_rows - 1, 0, num_cols - 1, &(P_c_mat[l - 1]));
+                P_c[l - 1].initialize(num_rows, num_cols, false);
             }
             else
             {
                 int num_rows = num_overlap[l - 1] + num_remaining[l - 1];
                 int num_cols = num_overlap[l - 1] + num_overlap[l - 0] + num_remaining[l - 0];
 
-                HYPRE_IJMatrixCreate(MPI_COMM_SELF, 0, num_rows - 1, 0, num_cols - 1, &(P_c_mat[l - 1]));
+                P_c[l - 1].initialize(num_rows, num_cols, false);
             }
 
-            HYPRE_IJMatrixSetObjectType(P_c_mat[l - 1], HYPRE_PARCSR);
-            HYPRE_IJMatrixInitialize_v2(P_c_mat[l - 1], HYPRE_MEMORY_HOST);
-
             for (int row = 0; row < num_nodes[l - 1]; row++)
             {
                 if (fine_nodes[row] < 0) continue;
 
                 if (fine_nodes[row] < num_fine)
                 {
-                    DType val = 1.0;
-                    HYPRE_IJMatrixAddToValues(P_c_mat[l - 1], 1, &one, &(fine_nodes[row]), &(fine_nodes[row]), &val);
+                    P_c[l - 1].add_entry(fine_nodes[row], fine_nodes[row], 1.0);
                 }
                 else
                 {
                     for (int ptr = P_ptr[row]; ptr < P_ptr[row + 1]; ptr++)
                     {
                         int col = P_col[ptr];
-                        DType val = P_val[ptr];
 
                         if (coarse_nodes[col] >= 0)
-                            HYPRE_IJMatrixAddToValues(P_c_mat[l - 1], 1, &one, &(fine_nodes[row]), &(coarse_nodes[col]), &val);
+                            P_c[l - 1].add_entry(fine_nodes[row], coarse_nodes[col], P_val[ptr]);
                     }
                 }
             }
 
-            HYPRE_IJMatrixAssemble(P_c_mat[l - 1]);
-            HYPRE_IJMatrixGetObject(P_c_mat[l - 1], (void**)(&(P_c_csr[l - 1])));
+            P_c[l - 1].assemble_host();
 
             // Construct mapping to original ordering
             int num_rows = 0;
@@ -2230,9 +2268,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
                 if (fine_nodes[i] >= 0)
                     num_rows++;
 
-            HYPRE_IJMatrixCreate(MPI_COMM_SELF, 0, num_rows - 1, 0, num_rows - 1, &(R_c_mat[l - 1]));
-            HYPRE_IJMatrixSetObjectType(R_c_mat[l - 1], HYPRE_PARCSR);
-            HYPRE_IJMatrixInitialize_v2(R_c_mat[l - 1], HYPRE_MEMORY_HOST);
+            R_c[l - 1].initialize(num_rows, num_rows, false);
 
             int num_cols = 0;
 
@@ -2240,166 +2276,103 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
             {
                 if (fine_nodes[i] >= 0)
                 {
-                    DType val = 1.0;
-                    HYPRE_IJMatrixAddToValues(R_c_mat[l - 1], 1, &one, &num_cols, &(fine_nodes[i]), &val);
+                    R_c[l - 1].add_entry(num_cols, fine_nodes[i], 1.0);
                     num_cols++;
                 }
             }
 
-            HYPRE_IJMatrixAssemble(R_c_mat[l - 1]);
-            HYPRE_IJMatrixGetObject(R_c_mat[l - 1], (void**)(&(R_c_csr[l - 1])));
+            R_c[l - 1].assemble_host();
         }
 
         // Construct composite to global interpolator
-        HYPRE_IJMatrix P_mat;
-        HYPRE_ParCSRMatrix P_csr;
+        CSR_Matrix<HYPRE_Real> P_glo;
 
         if (num_comp_levels > 1)
         {
             for (int l = num_comp_levels - 2; l > 0; l--)
             {
                 // Separate components
-                HYPRE_Int  num_rows = hypre_CSRMatrixNumRows(hypre_ParCSRMatrixDiag(P_c_csr[l - 1]));
-                HYPRE_Int  num_cols = hypre_CSRMatrixNumCols(hypre_ParCSRMatrixDiag(P_c_csr[l - 1]));
-                HYPRE_Int  *P_c_ptr = hypre_CSRMatrixI(hypre_ParCSRMatrixDiag(P_c_csr[l - 1]));
-                HYPRE_Int  *P_c_col = hypre_CSRMatrixJ(hypre_ParCSRMatrixDiag(P_c_csr[l - 1]));
-                HYPRE_Real *P_c_val = hypre_CSRMatrixData(hypre_ParCSRMatrixDiag(P_c_csr[l - 1]));
-
-                HYPRE_ParCSRMatrix P_c_lm1_21_csr;
-                HYPRE_IJMatrix P_c_lm1_21_mat;
-                HYPRE_IJMatrixCreate(MPI_COMM_SELF, 0, num_rows - num_comp_overlap[l - 1] - 1, 0, num_comp_overlap[l - 1] - 1, &P_c_lm1_21_mat);
-                HYPRE_IJMatrixSetObjectType(P_c_lm1_21_mat, HYPRE_PARCSR);
-                HYPRE_IJMatrixInitialize_v2(P_c_lm1_21_mat, HYPRE_MEMORY_HOST);
-
-                HYPRE_ParCSRMatrix P_c_lm1_22_csr;
-                HYPRE_IJMatrix P_c_lm1_22_mat;
-                HYPRE_IJMatrixCreate(MPI_COMM_SELF, 0, num_rows - num_comp_overlap[l - 1] - 1, 0, num_cols - num_comp_overlap[l - 1] - 1, &P_c_lm1_22_mat);
-                HYPRE_IJMatrixSetObjectType(P_c_lm1_22_mat, HYPRE_PARCSR);
-                HYPRE_IJMatrixInitialize_v2(P_c_lm1_22_mat, HYPRE_MEMORY_HOST);
-
-                for (int i = num_comp_overlap[l - 1]; i < num_rows; i++)
+                int num_rows = P_c[l - 1].num_rows;
+                int num_cols = P_c[l - 1].num_cols;
+                int num_overlap_lm1 = num_comp_overlap[l - 1];
+
+                CSR_Matrix<HYPRE_Real> P_c_lm1_21;
+                CSR_Matrix<HYPRE_Real> P_c_lm1_22;
+
+                P_c_lm1_21.initialize(num_rows - num_overlap_lm1, num_overlap_lm1, false);
+                P_c_lm1_22.initialize(num_rows - num_overlap_lm1, num_cols - num_overlap_lm1, false);
+
+                for (int i = num_overlap_lm1; i < num_rows; i++)
                 {
-                    for (int ptr = P_c_ptr[i]; ptr < P_c_ptr[i + 1]; ptr++)
+                    for (int ptr = P_c[l - 1].host_ptr[i]; ptr < P_c[l - 1].host_ptr[i + 1]; ptr++)
                     {
-                        int one = 1;
-                        int row = i - num_comp_overlap[l - 1];
-                        int col = P_c_col[ptr];
-                        DType val = P_c_val[ptr];
+                        int row = i - num_overlap_lm1;
+                        int col = P_c[l - 1].host_col[ptr];
+                        HYPRE_Real val = P_c[l - 1].host_val[ptr];
 
-                        if (col < num_comp_overlap[l - 1])
-                        {
-                            HYPRE_IJMatrixAddToValues(P_c_lm1_21_mat, 1, &one, &row, &col, &val);
-                        }
+                        if (col < num_overlap_lm1)
+                            P_c_lm1_21.add_entry(row, col, val);
                         else
-                        {
-                            col -= num_comp_overlap[l - 1];
-                            HYPRE_IJMatrixAddToValues(P_c_lm1_22_mat, 1, &one, &row, &col, &val);
-                        }
+                            P_c_lm1_22.add_entry(row, col - num_overlap_lm1, val);
                     }
                 }
 
-                HYPRE_IJMatrixAssemble(P_c_lm1_21_mat);
-                HYPRE_IJMatrixGetObject(P_c_lm1_21_mat, (void**)(&P_c_lm1_21_csr));
-
-                HYPRE_IJMatrixAssemble(P_c_lm1_22_mat);
-                HYPRE_IJMatrixGetObject(P_c_lm1_22_mat, (void**)(&P_c_lm1_22_csr));
+                P_c_lm1_21.assemble_host();
+                P_c_lm1_22.assemble_host();
 
                 // Apply interpolation to lower right block
-                HYPRE_ParCSRMatrix Rl_Pl = hypre_ParCSRMatMatHost(R_c_csr[l], P_c_csr[l]);
-                HYPRE_ParCSRMatrix Plm1_Rl_Pl = hypre_ParCSRMatMatHost(P_c_lm1_22_csr, Rl_Pl);
+                CSR_Matrix<HYPRE_Real> Rl_Pl;
+                CSR_Matrix<HYPRE_Real> Plm1_Rl_Pl;
 
-                num_cols = num_comp_overlap[l - 1] + hypre_CSRMatrixNumCols(hypre_ParCSRMatrixDiag(Plm1_Rl_Pl));
+                R_c[l].product(Rl_Pl, P_c[l]);
+                P_c_lm1_22.product(Plm1_Rl_Pl, Rl_Pl);
 
-                HYPRE_IJMatrixDestroy(P_c_mat[l - 1]);
-                HYPRE_IJMatrixCreate(MPI_COMM_SELF, 0, num_rows - 1, 0, num_cols - 1, &(P_c_mat[l - 1]));
-                HYPRE_IJMatrixSetObjectType(P_c_mat[l - 1], HYPRE_PARCSR);
-                HYPRE_IJMatrixInitialize_v2(P_c_mat[l - 1], HYPRE_MEMORY_HOST);
+                num_cols = num_overlap_lm1 + Plm1_Rl_Pl.num_cols;
 
-                for (int row = 0; row < num_comp_overlap[l - 1]; row++)
-                {
-                    int one = 1;
-                    DType val = 1.0;
-                    HYPRE_IJMatrixAddToValues(P_c_mat[l - 1], 1, &one, &row, &row, &val);
-                }
+                P_c[l - 1].initialize(num_rows, num_cols, false);
+
+                for (int row = 0; row < num_overlap_lm1; row++)
+                    P_c[l - 1].add_entry(row, row, 1.0);
 
+                for (int i = 0; i < num_rows - num_overlap_lm1; i++)
                 {
-                    HYPRE_Int  *mat_ptr = hypre_CSRMatrixI(hypre_ParCSRMatrixDiag(P_c_lm1_21_csr));
-                    HYPRE_Int  *mat_col = hypre_CSRMatrixJ(hypre_ParCSRMatrixDiag(P_c_lm1_21_csr));
-                    HYPRE_Real *mat_val = hypre_CSRMatrixData(hypre_ParCSRMatrixDiag(P_c_lm1_21_csr));
+                    for (int ptr = P_c_lm1_21.host_ptr[i]; ptr < P_c_lm1_21.host_ptr[i + 1]; ptr++)
+                        P_c[l - 1].add_entry(i + num_overlap_lm1, P_c_lm1_21.host_col[ptr], P_c_lm1_21.host_val[ptr]);
 
-                    for (int i = 0; i < num_rows - num_comp_overlap[l - 1]; i++)
-                    {
-                        for (int ptr = mat_ptr[i]; ptr < mat_ptr[i + 1]; ptr++)
-                        {
-                            int one = 1;
-                            int row = i + num_comp_overlap[l - 1];
-                            int col = mat_col[ptr];
-                            DType val = mat_val[ptr];
+                    for (int ptr = Plm1_Rl_Pl.host_ptr[i]; ptr < Plm1_Rl_Pl.host_ptr[i + 1]; ptr++)
+                        P_c[l - 1].add_entry(i + num_overlap_lm1, Plm1_Rl_Pl.host_col[ptr] + num_overlap_lm1, Plm1_Rl_Pl.host_val[ptr]);
+                }
 
-                            HYPRE_IJMatrixAddToValues(P_c_mat[l - 1], 1, &one, &row, &col, &val);
-                        }
-                    }
-                }
-
-                {
-                    HYPRE_Int  *mat_ptr = hypre_CSRMatrixI(hypre_ParCSRMatrixDiag(Plm1_Rl_Pl));
-                    HYPRE_Int  *mat_col = hypre_CSRMatrixJ(hypre_ParCSRMatrixDiag(Plm1_Rl_Pl));
-                    HYPRE_Real *mat_val = hypre_CSRMatrixData(hypre_ParCSRMatrixDiag(Plm1_Rl_Pl));
-
-                    for (int i = 0; i < num_rows - num_comp_overlap[l - 1]; i++)
-                    {
-                        for (int ptr = mat_ptr[i]; ptr < mat_ptr[i + 1]; ptr++)
-                        {
-                            int one = 1;
-                            int row = i + num_comp_overlap[l - 1];
-                            int col = mat_col[ptr] + num_comp_overlap[l - 1];
-                            DType val = mat_val[ptr];
-
-                            HYPRE_IJMatrixAddToValues(P_c_mat[l - 1], 1, &one, &row, &col, &val);
-                        }
-                    }
-                }
-
-                HYPRE_IJMatrixAssemble(P_c_mat[l - 1]);
-                HYPRE_IJMatrixGetObject(P_c_mat[l - 1], (void**)(&(P_c_csr[l - 1])));
-
-                HYPRE_IJMatrixDestroy(P_c_lm1_21_mat);
-                HYPRE_IJMatrixDestroy(P_c_lm1_22_mat);
-                HYPRE_ParCSRMatrixDestroy(Rl_Pl);
-                HYPRE_ParCSRMatrixDestroy(Plm1_Rl_Pl);
+                P_c[l - 1].assemble_host();
             }
 
-            P_csr = hypre_ParCSRMatMatHost(R_c_csr[0], P_c_csr[0]);
+            R_c[0].product(P_glo, P_c[0]);
         }
         else
         {
-            HYPRE_IJMatrixCreate(MPI_COMM_SELF, 0, num_dofs - 1, 0, num_dofs - 1, &P_mat);
-            HYPRE_IJMatrixSetObjectType(P_mat, HYPRE_PARCSR);
-            HYPRE_IJMatrixInitialize_v2(P_mat, HYPRE_MEMORY_HOST);
+            P_glo.initialize(num_dofs, num_dofs, false);
 
             for (int i = 0; i < num_dofs; i++)
-            {
-                int one = 1;
-                int row = i;
-                int col = nodes_to_dofs[0][i];
-                DType val = 1.0;
-
-                HYPRE_IJMatrixAddToValues(P_mat, 1, &one, &row, &col, &val);
-            }
+                P_glo.add_entry(i, nodes_to_dofs[0][i], 1.0);
 
-            HYPRE_IJMatrixAssemble(P_mat);
-            HYPRE_IJMatrixGetObject(P_mat, (void**)(&P_csr));
+            P_glo.assemble_host();
         }
 
-        for (int l = 0; l < num_comp_levels - 1; l++)
+        P_c.clear();
+        R_c.clear();
+
+        // Construct composite operators (Galerkin product with the finest hypre level)
+        CSR_Matrix<HYPRE_Real> A_fine;
+        CSR_Matrix<HYPRE_Real> Pt_glo;
+        CSR_Matrix<HYPRE_Real> PtAP;
+
         {
-            HYPRE_IJMatrixDestroy(P_c_mat[l]);
-            HYPRE_IJMatrixDestroy(R_c_mat[l]);
+            hypre_CSRMatrix *diag = hypre_ParCSRMatrixDiag(A[0]);
+            A_fine.assign_host(hypre_CSRMatrixNumRows(diag), hypre_CSRMatrixNumCols(diag), hypre_CSRMatrixI(diag), hypre_CSRMatrixJ(diag), hypre_CSRMatrixData(diag));
         }
 
-        // Construct composite operators
-        HYPRE_ParCSRMatrix PtA = hypre_ParCSRTMatMatKTHost(P_csr, A[0], 0);
-        HYPRE_ParCSRMatrix PtAP = hypre_ParCSRMatMatHost(PtA, P_csr);
+        P_glo.transpose_host(Pt_glo);
+        A_fine.triple_product(PtAP, P_glo, Pt_glo);
 
         int num_markers = 5;
         std::vector<int> marker_offset(num_markers);
@@ -2414,69 +2387,74 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
         }
 
         for (int m = 1; m < num_markers; m++) marker_offset[m] = marker_offset[m - 1] + marker_count[m - 1];
-        marker_count[4] = hypre_CSRMatrixNumRows(hypre_ParCSRMatrixDiag(PtAP)) - marker_offset[4];
+        marker_count[4] = PtAP.num_rows - marker_offset[4];
 
-        std::vector<int> R_sup(hypre_CSRMatrixNumRows(hypre_ParCSRMatrixDiag(PtAP)), - 1);
+        std::vector<int> R_sup(PtAP.num_rows, - 1);
 
         int dof = 0;
         for (int i = marker_offset[1]; i < marker_offset[3]; i++) R_sup[i] = dof++;
-        for (int i = marker_offset[4]; i < hypre_CSRMatrixNumRows(hypre_ParCSRMatrixDiag(PtAP)); i++) R_sup[i] = dof++;
+        for (int i = marker_offset[4]; i < PtAP.num_rows; i++) R_sup[i] = dof++;
         for (int i = marker_offset[3]; i < marker_offset[4]; i++) R_sup[i] = dof++;
 
         int num_rows = marker_count[0] + marker_count[1] + marker_count[2] + marker_count[3] + marker_count[4];
         int num_cols = marker_count[1] + marker_count[2] + marker_count[3] + marker_count[4];
 
-        HYPRE_IJMatrixCreate(MPI_COMM_SELF, 0, num_cols - 1, 0, num_cols - 1, &A_sup);
-        HYPRE_IJMatrixSetObjectType(A_sup, HYPRE_PARCSR);
-        HYPRE_IJMatrixInitialize_v2(A_sup, HYPRE_MEMORY_HOST);
-
-        HYPRE_Int  *PtAP_ptr = hypre_CSRMatrixI(hypre_ParCSRMatrixDiag(PtAP));
-        HYPRE_Int  *PtAP_col = hypre_CSRMatrixJ(hypre_ParCSRMatrixDiag(PtAP));
-        HYPRE_Real *PtAP_val = hypre_CSRMatrixData(hypre_ParCSRMatrixDiag(PtAP));
+        A_sup.initialize(num_cols, num_cols, false);
 
         for (int i = 0; i < num_rows; i++)
         {
-            for (int ptr = PtAP_ptr[i]; ptr < PtAP_ptr[i + 1]; ptr++)
+            for (int ptr = PtAP.host_ptr[i]; ptr < PtAP.host_ptr[i + 1]; ptr++)
             {
-                int one = 1;
                 int row = R_sup[i];
-                int col = R_sup[PtAP_col[ptr]];
-                DType val = PtAP_val[ptr];
+                int col = R_sup[PtAP.host_col[ptr]];
 
                 if ((row >= 0) and (col >= 0))
-                    HYPRE_IJMatrixAddToValues(A_sup, 1, &one, &row, &col, &val);
+                    A_sup.add_entry(row, col, PtAP.host_val[ptr]);
             }
         }
 
-        HYPRE_IJMatrixAssemble(A_sup);
-        HYPRE_IJMatrixGetObject(A_sup, (void**)(&A_sup_csr));
+        A_sup.assemble_host();
 
-        num_rows = hypre_CSRMatrixNumRows(hypre_ParCSRMatrixDiag(P_csr));
-        num_cols = dof;
+        // Lumped mass of the composite operator, row sums of P^T M P with the coarse mass diagonal M
+        std::vector<DType> M_sup;
+
+        if (keep_coefficients)
+        {
+            std::vector<HYPRE_Real> &M_fine = M_coarse;
+            std::vector<HYPRE_Real> M_comp(PtAP.num_rows, 0.0);
+            M_sup.assign(A_sup.num_rows, 0.0);
+
+            for (int row = 0; row < P_glo.num_rows; row++)
+            {
+                HYPRE_Real P_row = 0.0;
+                for (int ptr = P_glo.host_ptr[row]; ptr < P_glo.host_ptr[row + 1]; ptr++) P_row += P_glo.host_val[ptr];
+
+                for (int ptr = P_glo.host_ptr[row]; ptr < P_glo.host_ptr[row + 1]; ptr++)
+                    M_comp[P_glo.host_col[ptr]] += P_glo.host_val[ptr] * M_fine[row] * P_row;
+            }
+
+            for (int i = 0; i < PtAP.num_rows; i++)
+                if (R_sup[i] >= 0)
+                    M_sup[R_sup[i]] = (DType)(M_comp[i]);
+        }
 
-        HYPRE_Int  *P_ptr = hypre_CSRMatrixI(hypre_ParCSRMatrixDiag(P_csr));
-        HYPRE_Int  *P_col = hypre_CSRMatrixJ(hypre_ParCSRMatrixDiag(P_csr));
-        HYPRE_Real *P_val = hypre_CSRMatrixData(hypre_ParCSRMatrixDiag(P_csr));
+        num_rows = P_glo.num_rows;
+        num_cols = dof;
 
-        HYPRE_IJMatrixCreate(MPI_COMM_SELF, 0, num_rows - 1, 0, num_cols - 1, &P_sup);
-        HYPRE_IJMatrixSetObjectType(P_sup, HYPRE_PARCSR);
-        HYPRE_IJMatrixInitialize_v2(P_sup, HYPRE_MEMORY_HOST);
+        P_sup.initialize(num_rows, num_cols, false);
 
         for (int row = 0; row < num_rows; row++)
         {
-            for (int ptr = P_ptr[row]; ptr < P_ptr[row + 1]; ptr++)
+            for (int ptr = P_glo.host_ptr[row]; ptr < P_glo.host_ptr[row + 1]; ptr++)
             {
-                int one = 1;
-                int col = R_sup[P_col[ptr]];
-                DType val = P_val[ptr];
+                int col = R_sup[P_glo.host_col[ptr]];
 
                 if (col >= 0)
-                    HYPRE_IJMatrixAddToValues(P_sup, 1, &one, &row, &col, &val);
+                    P_sup.add_entry(row, col, P_glo.host_val[ptr]);
             }
         }
 
-        HYPRE_IJMatrixAssemble(P_sup);
-        HYPRE_IJMatrixGetObject(P_sup, (void**)(&P_sup_csr));
+        P_sup.assemble_host();
 
         dof_sup.resize(num_nodes[0]);
         memcpy(dof_sup.data(), nodes_to_dofs[0].data(), num_nodes[0] * sizeof(int));
@@ -2528,55 +2506,135 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
             for (int i = 0; i < size; i++) dof_sup[i] = entries[i].second;
         }
 
-        if (num_comp_levels > 1)
-            HYPRE_ParCSRMatrixDestroy(P_csr);
-        else
-            HYPRE_IJMatrixDestroy(P_mat);
-
-        HYPRE_ParCSRMatrixDestroy(PtA);
-        HYPRE_ParCSRMatrixDestroy(PtAP);
-
         HYPRE_BoomerAMGDestroy(amg_coarse);
 
         // Construct superdomain operator structure
-        num_rows = hypre_CSRMatrixNumRows(hypre_ParCSRMatrixDiag(P_sup_csr));
-        num_cols = hypre_CSRMatrixNumCols(hypre_ParCSRMatrixDiag(P_sup_csr));
+        num_rows = P_sup.num_rows;
+        num_cols = P_sup.num_cols;
 
-        superdomain_operator.num_dofs = hypre_CSRMatrixNumCols(hypre_ParCSRMatrixDiag(A_sup_csr)) - marker_count[3];
+        superdomain_operator.num_dofs = A_sup.num_cols - marker_count[3];
         superdomain_operator.num_extended_dofs = num_cols;
         superdomain_operator.num_points = superdomain_operator.Q.num_rows;
 
         superdomain_operator.Pt.initialize(num_cols, num_rows);
 
+        for (int row = 0; row < num_rows; row++)
+            for (int ptr = P_sup.host_ptr[row]; ptr < P_sup.host_ptr[row + 1]; ptr++)
+                superdomain_operator.Pt.add_entry(P_sup.host_col[ptr], row, P_sup.host_val[ptr]);
+
+        superdomain_operator.Pt.assemble();
+
+        superdomain_operator.A.initialize(num_cols, num_cols);
+
+        for (int row = 0; row < num_cols; row++)
+            for (int ptr = A_sup.host_ptr[row]; ptr < A_sup.host_ptr[row + 1]; ptr++)
+                superdomain_operator.A.add_entry(row, A_sup.host_col[ptr], A_sup.host_val[ptr]);
+
+        // The host copy keeps the stiffness values for coefficient refreshes
+        if (keep_coefficients)
         {
-            HYPRE_Int  *mat_ptr = hypre_CSRMatrixI(hypre_ParCSRMatrixDiag(P_sup_csr));
-            HYPRE_Int  *mat_col = hypre_CSRMatrixJ(hypre_ParCSRMatrixDiag(P_sup_csr));
-            HYPRE_Real *mat_val = hypre_CSRMatrixData(hypre_ParCSRMatrixDiag(P_sup_csr));
+            superdomain_operator.A.assemble_host();
+            if (superdomain_operator.A.num_nnz > 0) superdomain_operator.A.upload();
+
+            superdomain_operator.mass_diag = M_sup;
+            superdomain_operator.diag_ptr.assign(num_cols, - 1);
 
-            for (int row = 0; row < num_rows; row++)
-                for (int ptr = mat_ptr[row]; ptr < mat_ptr[row + 1]; ptr++)
-                    superdomain_operator.Pt.add_entry(mat_col[ptr], row, mat_val[ptr]);
+            for (int row = 0; row < superdomain_operator.A.num_rows; row++)
+                for (int ptr = superdomain_operator.A.host_ptr[row]; ptr < superdomain_operator.A.host_ptr[row + 1]; ptr++)
+                    if (superdomain_operator.A.host_col[ptr] == row)
+                        superdomain_operator.diag_ptr[row] = ptr;
+        }
+        else
+        {
+            superdomain_operator.A.assemble();
         }
+    }
 
-        superdomain_operator.Pt.assemble();
+#if COARSE_EXCHANGE == 1
+    // Coarse grid exchange restricted to the points touched by the superdomain
+    {
+        std::vector<int> &mat_ptr = P_sup.host_ptr;
+        int num_rows = std::min(P_sup.num_rows, num_coarse_dofs);
 
-        superdomain_operator.A.initialize(num_cols, num_cols);
+        std::vector<bool> coarse_dof_needed(num_coarse_dofs, false);
+
+        for (int row = 0; row < num_rows; row++)
+            if (mat_ptr[row + 1] > mat_ptr[row])
+                coarse_dof_needed[row] = true;
+
+        // Coarse points needed from each rank (local numbering of the owner)
+        std::vector<std::vector<int>> recv_idx(num_procs);
+
+        for (int p = 0; p < num_procs; p++)
+            for (int i = proc_offset[p]; i < proc_offset[p] + proc_count[p]; i++)
+                if ((dof_num_coarse[i] > 0) and coarse_dof_needed[dof_num_coarse[i] - 1])
+                    recv_idx[p].push_back(i - proc_offset[p]);
+
+        std::vector<int> recv_count(num_procs);
+        std::vector<int> recv_offset(num_procs);
+        std::vector<int> send_count(num_procs);
+        std::vector<int> send_offset(num_procs);
+
+        for (int p = 0; p < num_procs; p++) recv_count[p] = (int)(recv_idx[p].size());
+        MPI_Alltoall(recv_count.data(), 1, MPI_INT, send_count.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+        for (int p = 1; p < num_procs; p++) recv_offset[p] = recv_offset[p - 1] + recv_count[p - 1];
+        for (int p = 1; p < num_procs; p++) send_offset[p] = send_offset[p - 1] + send_count[p - 1];
 
+        int num_recv = recv_offset[num_procs - 1] + recv_count[num_procs - 1];
+        int num_send = send_offset[num_procs - 1] + send_count[num_procs - 1];
+
+        std::vector<int> recv_list(num_recv);
+        for (int p = 0; p < num_procs; p++) std::copy(recv_idx[p].begin(), recv_idx[p].end(), recv_list.begin() + recv_offset[p]);
+
+        coarse_send_idx.resize(num_send);
+        coarse_send_buffer.resize(num_send);
+
+        MPI_Alltoallv(recv_list.data(), recv_count.data(), recv_offset.data(), MPI_INT, coarse_send_idx.data(), send_count.data(), send_offset.data(), MPI_INT, MPI_COMM_WORLD);
+
+        // Neighborhood (ranks are listed in increasing order, matching the packing above)
+        std::vector<int> sources;
+        std::vector<int> destinations;
+
+        for (int p = 0; p < num_procs; p++)
         {
-            HYPRE_Int  *mat_ptr = hypre_CSRMatrixI(hypre_ParCSRMatrixDiag(A_sup_csr));
-            HYPRE_Int  *mat_col = hypre_CSRMatrixJ(hypre_ParCSRMatrixDiag(A_sup_csr));
-            HYPRE_Real *mat_val = hypre_CSRMatrixData(hypre_ParCSRMatrixDiag(A_sup_csr));
+            if (recv_count[p] > 0)
+            {
+                sources.push_back(p);
+                coarse_recv_count.push_back(recv_count[p]);
+                coarse_recv_offset.push_back(recv_offset[p]);
+            }
 
-            for (int row = 0; row < num_cols; row++)
-                for (int ptr = mat_ptr[row]; ptr < mat_ptr[row + 1]; ptr++)
-                    superdomain_operator.A.add_entry(row, mat_col[ptr], mat_val[ptr]);
+            if (send_count[p] > 0)
+            {
+                destinations.push_back(p);
+                coarse_send_count.push_back(send_count[p]);
+                coarse_send_offset.push_back(send_offset[p]);
+            }
         }
 
-        superdomain_operator.A.assemble();
+        MPI_Dist_graph_create_adjacent(MPI_COMM_WORLD, (int)(sources.size()), sources.data(), MPI_UNWEIGHTED, (int)(destinations.size()), destinations.data(), MPI_UNWEIGHTED, MPI_INFO_NULL, 0, &coarse_comm);
+
+        // Coarse assembly from the received points only
+        Qt_coarse.initialize(num_coarse_dofs, num_recv);
+
+        for (int p = 0; p < num_procs; p++)
+            for (int i = 0; i < recv_count[p]; i++)
+                Qt_coarse.add_entry(dof_num_coarse[proc_offset[p] + recv_idx[p][i]] - 1, recv_offset[p] + i, 1.0);
+
+        Qt_coarse.assemble();
     }
+#endif
 
-    HYPRE_IJMatrixDestroy(P_sup);
-    HYPRE_IJMatrixDestroy(A_sup);
+#if PRECONDITIONER_WIRE > 0
+    // Reduced precision messages of the coarse grid exchange
+#if COARSE_EXCHANGE == 1
+    coarse_wire_send.setup(coarse_send_count, coarse_send_offset);
+    coarse_wire_recv.setup(coarse_recv_count, coarse_recv_offset);
+#else
+    coarse_wire_recv.setup(proc_count, proc_offset);
+#endif
+#endif
 
     // Interface operator
     num_interface_dofs = (int)(interface_glo_num.size());
@@ -2729,7 +2787,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     QQt_int.assemble();
 
     // Norm weighting
-    norm_weight = device.malloc<DType>(subdomain_operator.num_extended_dofs + superdomain_operator.num_extended_dofs);
+    norm_weight = device_malloc<DType>(subdomain_operator.num_extended_dofs + superdomain_operator.num_extended_dofs);
     for (int i = 0; i < subdomain_operator.num_extended_dofs + superdomain_operator.num_extended_dofs; i++) work_hst[0][i] = 1.0;
     for (int i = subdomain_operator.num_dofs; i < subdomain_operator.num_extended_dofs; i++) work_hst[0][i] = 0.0;
     for (int i = 0; i < num_interface_dofs; i++) work_hst[0][subdomain_operator.num_extended_dofs + i] = 0.0;
@@ -2737,7 +2795,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     norm_weight.copyFrom(work_hst[0].data(), (subdomain_operator.num_extended_dofs + superdomain_operator.num_extended_dofs) * sizeof(DType));
 
     // Inner product weight
-    inner_weight = device.malloc<DType>(subdomain_operator.num_points + superdomain_operator.num_extended_dofs);
+    inner_weight = device_malloc<DType>(subdomain_operator.num_points + superdomain_operator.num_extended_dofs);
     subdomain_operator.Q.multiply(inner_weight, norm_weight);
     occa::memory inner_weight_superdomain = inner_weight.slice(subdomain_operator.num_points, superdomain_operator.num_extended_dofs);
     occa::memory norm_weight_superdomain = norm_weight.slice(subdomain_operator.num_extended_dofs, superdomain_operator.num_extended_dofs);
@@ -2746,11 +2804,36 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     for (int i = 0; i < subdomain_operator.num_points + superdomain_operator.num_extended_dofs; i++) if (work_hst[0][i] > 0.0) work_hst[0][i] = 1.0;
     inner_weight.copyFrom(work_hst[0].data(), (subdomain_operator.num_points + superdomain_operator.num_extended_dofs) * sizeof(DType));
 
-    // Low-order preconditioner
-    rstdout("Assembling subdomain low-order preconditioner\n");
+    // Workspaces of the setup and the solve, requested together and planned once now that the extended dofs are known
+    num_values = subdomain_operator.num_points + superdomain_operator.num_extended_dofs;
+
+    for (int d = 0; d < dim; d++) work_handle[d] = arena.request("subdomain.work", work_hst[d].size() * sizeof(DType), PHASE_SUBDOMAIN_SETUP, PHASE_SOLVE);
+
+#if (LEVEL_KERNELS == 1) && (ELEMENT_MATRIX_DEGREE > 0)
+    element_matrix_handle.resize(2);
+    for (auto &handle : element_matrix_handle) handle = arena.request("subdomain.element_matrix", subdomain_operator.num_points * sizeof(DType), PHASE_SUBDOMAIN_SETUP, PHASE_SUBDOMAIN_SETUP);
+#endif
+
+    solver_handle.resize(7);
+    for (auto &handle : solver_handle) handle = arena.request("subdomain.solver", num_values * sizeof(DType), PHASE_SOLVE, PHASE_SOLVE);
+
+    V.request(num_values, num_vectors + 1, PHASE_SOLVE, PHASE_SOLVE);
+    Z.request(num_values, num_vectors, PHASE_SOLVE, PHASE_SOLVE);
+    V_assembled.request(subdomain_operator.num_extended_dofs + superdomain_operator.num_extended_dofs, num_vectors + 1, PHASE_SOLVE, PHASE_SOLVE);
+
+    arena.plan();
+
+    for (int d = 0; d < dim; d++) work_dev[d] = arena.get<DType>(work_handle[d]);
 
+    for (int w = 0; w < num_work_dev; w++) ((DType**)(work_hst[0].data()))[w] = (DType*)(work_dev[w].ptr());
+    work_dev_ptr = device_malloc<DType*>(num_work_dev * sizeof(DType*));
+    work_dev_ptr.copyFrom(work_hst[0].data(), num_work_dev * sizeof(DType*));
+
+    // Low-order preconditioner (also the coarse space of the fast diagonalization Schwarz method)
     if (use_preconditioner)
     {
+        rstdout("Assembling subdomain low-order preconditioner\n");
+
         std::map<std::pair<int, int>, std::vector<DType>> J_cf_fem;
 
         for (int l_f = 0; l_f < num_levels - 1; l_f++)
@@ -2916,6 +2999,19 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
         HYPRE_IJMatrixSetObjectType(A_sub_fem, HYPRE_PARCSR);
         HYPRE_IJMatrixInitialize_v2(A_sub_fem, HYPRE_MEMORY_HOST);
 
+        // Part of the finest level that stays assembled, and sub-grid of the conforming elements applied matrix-free
+        CSR_Matrix<Float> A_sub_res;
+        A_sub_res.initialize(subdomain_operator.num_extended_dofs, subdomain_operator.num_extended_dofs, false);
+
+        std::vector<int> fem_cell_points;
+        std::vector<int> fem_point_dofs;
+        std::vector<Float> fem_point_coords;
+        std::vector<int> fem_simplices;
+
+        for (auto &low_order_elem : low_order_elems)
+            for (int vid = 0; vid < num_verts; vid++)
+                fem_simplices.push_back(std::get<0>(low_order_elem[vid]) + 2 * std::get<1>(low_order_elem[vid]) + ((dim == 3) ? 4 * std::get<2>(low_order_elem[vid]) : 0));
+
         for (int e = 0; e < (int)(subdomain_region.size()); e++)
         {
             auto &elem_i = subdomain_region[e];
@@ -3275,6 +3371,36 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
                 }
             }
 
+            // Elements without coarser neighbors have J_e = I on their sub-grid
+            bool matrix_free = matrix_free_fem and (N_i > 1);
+
+            for (int eid = 0; eid < num_edges; eid++) if (edge_conn[eid].second.size() > 0) matrix_free = false;
+            for (int fid = 0; fid < num_faces; fid++) if (face_conn[fid].second.size() > 0) matrix_free = false;
+
+            if (matrix_free)
+            {
+                int point_offset = (int)(fem_point_dofs.size());
+
+                for (int vid = 0; vid < elem_i.num_points; vid++)
+                {
+                    fem_point_dofs.push_back(((elem_i.glo_num[vid] > 0) and (elem_i.dof_num[vid] > 0)) ? elem_i.dof_num[vid] - 1 : - 1);
+
+                    if (dim >= 1) fem_point_coords.push_back(elem_i.x[vid]);
+                    if (dim >= 2) fem_point_coords.push_back(elem_i.y[vid]);
+                    if (dim >= 3) fem_point_coords.push_back(elem_i.z[vid]);
+                }
+
+                int S_z = (dim >= 3) ? N_i : 1;
+
+                for (int s_z = 0; s_z < S_z; s_z++)
+                    for (int s_y = 0; s_y < N_i; s_y++)
+                        for (int s_x = 0; s_x < N_i; s_x++)
+                            for (int k = 0; k < ((dim == 3) ? 2 : 1); k++)
+                                for (int j = 0; j < 2; j++)
+                                    for (int i = 0; i < 2; i++)
+                                        fem_cell_points.push_back(point_offset + (s_x + i) + (s_y + j) * n_i + (s_z + k) * (n_i * n_i));
+            }
+
             int num_rows = elem_i.num_points;
             int num_cols = rank - 1;
 
@@ -3398,6 +3524,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
                         col--;
 
                         HYPRE_IJMatrixAddToValues(A_sub_fem, 1, &one, &row, &col, &val);
+                        if (not matrix_free) A_sub_res.add_entry(row, col, val);
                     }
                 }
             }
@@ -3416,6 +3543,27 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
         Q_int.multiply(work_dev[1], work_dev[0]);
         work_dev[1].copyTo(work_hst[0].data(), (subdomain_operator.num_extended_dofs + superdomain_operator.num_extended_dofs) * sizeof(DType));
 
+        A_sub_res.assemble_host();
+
+        CSR_Matrix<Float> A_res;
+        A_res.initialize(num_dofs, num_dofs, false);
+
+        for (int i = 0; i < subdomain_operator.num_dofs; i++)
+            for (int ptr = A_sub_res.host_ptr[i]; ptr < A_sub_res.host_ptr[i + 1]; ptr++)
+                A_res.add_entry((int)(work_hst[0][i]), (int)(work_hst[0][A_sub_res.host_col[ptr]]), A_sub_res.host_val[ptr]);
+
+        int num_fem_points = (int)(fem_point_dofs.size());
+        std::vector<int> fem_point_rows(num_fem_points);
+        std::vector<int> fem_point_cols(num_fem_points);
+
+        for (int p = 0; p < num_fem_points; p++)
+        {
+            int dof = fem_point_dofs[p];
+
+            fem_point_cols[p] = (dof >= 0) ? (int)(work_hst[0][dof]) : - 1;
+            fem_point_rows[p] = (dof < subdomain_operator.num_dofs) ? fem_point_cols[p] : - 1;
+        }
+
         // Assembled combined operator
         HYPRE_IJMatrixCreate(MPI_COMM_SELF, 0, num_dofs - 1, 0, num_dofs - 1, &A_fem_hst);
         HYPRE_IJMatrixSetObjectType(A_fem_hst, HYPRE_PARCSR);
@@ -3464,6 +3612,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
                     val = A_sup_val[ptr];
 
                     HYPRE_IJMatrixAddToValues(A_fem_hst, 1, &one, &row, &col, &val);
+                    A_res.add_entry(row, col, val);
                 }
             }
         }
@@ -3471,6 +3620,8 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
         HYPRE_IJMatrixAssemble(A_fem_hst);
         HYPRE_IJMatrixGetObject(A_fem_hst, (void**)(&A_fem_hst_csr));
 
+        A_res.assemble_host();
+
         // AMG preconditioner
         cudaStreamCreate(&cuda_stream);
 
@@ -3485,6 +3636,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
         HYPRE_BoomerAMGSetChebyOrder(amg_solver, cheby_order);
         HYPRE_BoomerAMGSetMaxIter(amg_solver, num_vcycles);
         HYPRE_BoomerAMGSetTol(amg_solver, tolerance);
+        HYPRE_BoomerAMGSetMaxCoarseSize(amg_solver, max_coarse_size);
         HYPRE_BoomerAMGSetPrintLevel(amg_solver, 0);
         HYPRE_BoomerAMGSetup(amg_solver, A_fem_hst_csr, NULL, NULL);
 
@@ -3498,6 +3650,141 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
 
         level_cutoff = std::max(0, std::min(num_levels_fem - 2, level_cutoff));
 
+        // The coarse solver factors a stored matrix, so a one-level hierarchy keeps the finest level assembled
+        if (num_levels_fem < 2) matrix_free_fem = false;
+
+        // The matrix-free finest level keeps an explicit diagonal in its stored part for the mass term
+        if (matrix_free_fem)
+        {
+            std::vector<int> ptr_diag(A_res.num_rows + 1, 0);
+            std::vector<int> col_diag;
+            std::vector<Float> val_diag;
+
+            for (int i = 0; i < A_res.num_rows; i++)
+            {
+                bool found = false;
+
+                for (int ptr = A_res.host_ptr[i]; ptr < A_res.host_ptr[i + 1]; ptr++)
+                {
+                    if ((not found) and (A_res.host_col[ptr] > i))
+                    {
+                        col_diag.push_back(i);
+                        val_diag.push_back(0.0);
+                        found = true;
+                    }
+
+                    col_diag.push_back(A_res.host_col[ptr]);
+                    val_diag.push_back(A_res.host_val[ptr]);
+                    if (A_res.host_col[ptr] == i) found = true;
+                }
+
+                if (not found)
+                {
+                    col_diag.push_back(i);
+                    val_diag.push_back(0.0);
+                }
+
+                ptr_diag[i + 1] = col_diag.size();
+            }
+
+            A_res.host_ptr.swap(ptr_diag);
+            A_res.host_col.swap(col_diag);
+            A_res.host_val.swap(val_diag);
+            A_res.num_nnz = A_res.host_col.size();
+        }
+
+        // Mass hierarchy along the fixed interpolation, M_0 is the lumped spectral element mass and M_{l+1} = P^T M_l P
+        if (keep_coefficients)
+        {
+            std::vector<DType> M_sub(subdomain_operator.num_extended_dofs);
+            occa::memory mass_fact_l = subdomain_operator.mass_fact.slice(0, subdomain_operator.num_points);
+
+            subdomain_operator.Qt.multiply(work_dev[0], mass_fact_l);
+            work_dev[0].copyTo(M_sub.data(), subdomain_operator.num_extended_dofs * sizeof(DType));
+
+            HYPRE_IJMatrix M_fem_hst;
+            HYPRE_IJMatrixCreate(MPI_COMM_SELF, 0, num_dofs - 1, 0, num_dofs - 1, &M_fem_hst);
+            HYPRE_IJMatrixSetObjectType(M_fem_hst, HYPRE_PARCSR);
+            HYPRE_IJMatrixInitialize_v2(M_fem_hst, HYPRE_MEMORY_HOST);
+
+            for (int i = 0; i < subdomain_operator.num_dofs; i++)
+            {
+                row = (int)(work_hst[0][i]);
+                val = M_sub[i];
+
+                HYPRE_IJMatrixAddToValues(M_fem_hst, 1, &one, &row, &row, &val);
+            }
+
+            for (int i = num_interface_dofs; i < superdomain_operator.num_dofs; i++)
+            {
+                row = (int)(work_hst[0][subdomain_operator.num_extended_dofs + i]);
+                val = superdomain_operator.mass_diag[i];
+
+                HYPRE_IJMatrixAddToValues(M_fem_hst, 1, &one, &row, &row, &val);
+            }
+
+            HYPRE_IJMatrixAssemble(M_fem_hst);
+
+            std::vector<HYPRE_ParCSRMatrix> M_hyp(num_levels_fem);
+            HYPRE_IJMatrixGetObject(M_fem_hst, (void**)(&M_hyp[0]));
+
+            for (int l = 0; l < num_levels_fem - 1; l++)
+            {
+                HYPRE_ParCSRMatrix PtM_csr = hypre_ParCSRTMatMatKTHost(R_hyp[l], M_hyp[l], 0);
+                M_hyp[l + 1] = hypre_ParCSRMatMatHost(PtM_csr, R_hyp[l]);
+                HYPRE_ParCSRMatrixDestroy(PtM_csr);
+            }
+
+            K_val_fem.resize(num_levels_fem);
+            M_val_fem.resize(num_levels_fem);
+            K_diag_fem.resize(num_levels_fem);
+            M_diag_fem.resize(num_levels_fem);
+
+            for (int l = 0; l < num_levels_fem; l++)
+            {
+                bool stored = not ((l == 0) and matrix_free_fem);
+
+                int num_rows_l = hypre_CSRMatrixNumRows(hypre_ParCSRMatrixDiag(A_hyp[l]));
+                HYPRE_Int *A_ptr = stored ? hypre_CSRMatrixI(hypre_ParCSRMatrixDiag(A_hyp[l])) : A_res.host_ptr.data();
+                HYPRE_Int *A_col = stored ? hypre_CSRMatrixJ(hypre_ParCSRMatrixDiag(A_hyp[l])) : A_res.host_col.data();
+                HYPRE_Complex *A_val = stored ? hypre_CSRMatrixData(hypre_ParCSRMatrixDiag(A_hyp[l])) : A_res.host_val.data();
+                HYPRE_Int *K_ptr = hypre_CSRMatrixI(hypre_ParCSRMatrixDiag(A_hyp[l]));
+                HYPRE_Int *K_col = hypre_CSRMatrixJ(hypre_ParCSRMatrixDiag(A_hyp[l]));
+                HYPRE_Complex *K_val = hypre_CSRMatrixData(hypre_ParCSRMatrixDiag(A_hyp[l]));
+                HYPRE_Int *M_ptr = hypre_CSRMatrixI(hypre_ParCSRMatrixDiag(M_hyp[l]));
+                HYPRE_Int *M_col = hypre_CSRMatrixJ(hypre_ParCSRMatrixDiag(M_hyp[l]));
+                HYPRE_Complex *M_val = hypre_CSRMatrixData(hypre_ParCSRMatrixDiag(M_hyp[l]));
+
+                K_val_fem[l].assign(A_val, A_val + A_ptr[num_rows_l]);
+                M_val_fem[l].assign(A_ptr[num_rows_l], 0.0);
+                K_diag_fem[l].assign(num_rows_l, 0.0);
+                M_diag_fem[l].assign(num_rows_l, 0.0);
+
+                // Entries of M outside the pattern of A are lumped onto the diagonal
+                std::vector<int> marker(num_rows_l, - 1);
+
+                for (int i = 0; i < num_rows_l; i++)
+                {
+                    for (int ptr = A_ptr[i]; ptr < A_ptr[i + 1]; ptr++) marker[A_col[ptr]] = ptr;
+
+                    for (int ptr = M_ptr[i]; ptr < M_ptr[i + 1]; ptr++)
+                    {
+                        int pos = (marker[M_col[ptr]] >= 0) ? marker[M_col[ptr]] : marker[i];
+                        if (pos >= 0) M_val_fem[l][pos] += M_val[ptr];
+                        if (M_col[ptr] == i) M_diag_fem[l][i] = M_val[ptr];
+                    }
+
+                    for (int ptr = K_ptr[i]; ptr < K_ptr[i + 1]; ptr++)
+                        if (K_col[ptr] == i) K_diag_fem[l][i] = K_val[ptr];
+
+                    for (int ptr = A_ptr[i]; ptr < A_ptr[i + 1]; ptr++) marker[A_col[ptr]] = - 1;
+                }
+            }
+
+            for (int l = 1; l < num_levels_fem; l++) hypre_ParCSRMatrixDestroy(M_hyp[l]);
+            HYPRE_IJMatrixDestroy(M_fem_hst);
+        }
+
         A_fem.resize(num_levels_fem);
         D_val_fem.resize(num_levels_fem);
         coefs_fem.resize(num_levels_fem);
@@ -3508,14 +3795,26 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
         {
             const char *mem_loc = (l <= level_cutoff) ? "device" : "host";
 
-            A_fem[l].initialize(mem_loc, 
-                                hypre_CSRMatrixNumRows(hypre_ParCSRMatrixDiag(A_hyp[l])), 
-                                hypre_CSRMatrixNumCols(hypre_ParCSRMatrixDiag(A_hyp[l])), 
-                                hypre_CSRMatrixNumNonzeros(hypre_ParCSRMatrixDiag(A_hyp[l])), 
-                                hypre_CSRMatrixI(hypre_ParCSRMatrixDiag(A_hyp[l])), 
-                                hypre_CSRMatrixJ(hypre_ParCSRMatrixDiag(A_hyp[l])), 
-                                hypre_CSRMatrixData(hypre_ParCSRMatrixDiag(A_hyp[l])), 
-                                cuda_stream);
+            if ((l == 0) and matrix_free_fem)
+            {
+                A_fem[l].initialize(mem_loc, A_res.num_rows, A_res.num_cols, A_res.num_nnz, A_res.host_ptr.data(), A_res.host_col.data(), A_res.host_val.data(), cuda_stream);
+
+                element_operator_fem.initialize(mem_loc, dim, num_dofs, (int)(fem_cell_points.size()) >> dim, num_fem_points, (int)(low_order_elems.size()), 
+                                                fem_cell_points.data(), fem_simplices.data(), fem_point_rows.data(), fem_point_cols.data(), fem_point_coords.data(), cuda_stream);
+
+                A_fem[l].element_operator = &element_operator_fem;
+            }
+            else
+            {
+                A_fem[l].initialize(mem_loc, 
+                                    hypre_CSRMatrixNumRows(hypre_ParCSRMatrixDiag(A_hyp[l])), 
+                                    hypre_CSRMatrixNumCols(hypre_ParCSRMatrixDiag(A_hyp[l])), 
+                                    hypre_CSRMatrixNumNonzeros(hypre_ParCSRMatrixDiag(A_hyp[l])), 
+                                    hypre_CSRMatrixI(hypre_ParCSRMatrixDiag(A_hyp[l])), 
+                                    hypre_CSRMatrixJ(hypre_ParCSRMatrixDiag(A_hyp[l])), 
+                                    hypre_CSRMatrixData(hypre_ParCSRMatrixDiag(A_hyp[l])), 
+                                    cuda_stream);
+            }
 
 
             D_val_fem[l].initialize(mem_loc, A_fem[l].num_rows, hypre_VectorData(ds_hyp[l]), cuda_stream);
@@ -3548,6 +3847,17 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
             }
         }
 
+        // Every level has been copied out, so the assembled finest level is no longer needed
+        if (matrix_free_fem)
+        {
+            HYPRE_BoomerAMGDestroy(amg_solver);
+            HYPRE_IJMatrixDestroy(A_fem_hst);
+            amg_data = NULL;
+        }
+
+        // Coarse grid solver (the coarsest level always lives on the host)
+        coarse_solver_fem.initialize(A_fem[num_levels_fem - 1], coarse_inverse_cutoff);
+
         work_hst_fem.resize(num_levels_fem);
         work_dev_fem.resize(num_levels_fem);
 
@@ -3578,7 +3888,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
             Float alpha = 1.0;
             Float beta  = 0.0;
 
-            if (strcmp(A_fem[l].mem_loc, "device") == 0)
+            if ((strcmp(A_fem[l].mem_loc, "device") == 0) and (A_fem[l].num_nnz > 0))
             {
                 cusparseSpMV_bufferSize(A_fem[l].cusparse_handle, CUSPARSE_OPERATION_NON_TRANSPOSE, 
                                         &alpha, A_fem[l].desc, u_fem[l].desc, &beta, f_fem[l].desc, 
@@ -3641,67 +3951,180 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
             w_fem[l].initialize(A_fem[l].mem_loc, A_fem[l].num_rows, NULL, cuda_stream);
         }
 
+        // Largest eigenvalues of the scaled smoother operators, the reference for coefficient refreshes
+        const int num_power_iterations = 10;
+        lambda_fem.assign(num_levels_fem, 0.0);
+
+        for (int l = 0; l < num_levels_fem - 1; l++)
+            lambda_fem[l] = scaled_max_eigenvalue(A_fem[l], D_val_fem[l], v_fem[l], w_fem[l], r_fem[l], num_power_iterations);
+
 #if USE_CUDA_GRAPH == 1
-        cudaStreamBeginCapture(cuda_stream, cudaStreamCaptureModeGlobal);
+        capture_cycle_graphs();
+#endif
+    }
 
-        for (int l = 0; l <= level_cutoff; l++)
+    // Fast diagonalization preconditioner
+    if (use_preconditioner and (local_preconditioner == 1))
+    {
+        rstdout("Setting up subdomain fast diagonalization preconditioner\n");
+
+        fdm_S.resize(num_levels);
+        fdm_lambda.resize(num_levels);
+        fdm_scale.resize(num_levels);
+        fdm_bc.resize(num_levels);
+
+        // Generalized eigenproblems (S^T A S = Lambda, S^T B S = I) of the 1D GLL stiffness and mass matrices extended by the
+        // mirrored end of each neighbour, for the four combinations of Dirichlet ends (bit 0 lower end, bit 1 upper end)
+        for (int l = 0; l < num_levels; l++)
         {
-            // Smooth solution
-            if (l > 0) u_fem[l].set_to_value(0.0);
+            int N_l = poly_degree[l];
+            int n_l = N_l + 1;
+            std::vector<double> z_gll(n_l);
+            std::vector<double> w_gll(n_l);
+            std::vector<double> D_gll(n_l * n_l);
+            std::vector<double> Dt_gll(n_l * n_l);
+            std::vector<double> K_gll(n_l * n_l, 0.0);
+            std::vector<DType> S_hst(4 * n_l * n_l);
+            std::vector<DType> lambda_hst(4 * n_l);
+
+            zwgll_(z_gll.data(), w_gll.data(), &n_l);
+            dgll_(Dt_gll.data(), D_gll.data(), z_gll.data(), &n_l, &n_l);
+
+            for (int i = 0; i < n_l; i++)
+                for (int j = 0; j < n_l; j++)
+                    for (int k = 0; k < n_l; k++)
+                        K_gll[i * n_l + j] += w_gll[k] * D_gll[i + k * n_l] * D_gll[j + k * n_l];
+
+            for (int bc = 0; bc < 4; bc++)
+            {
+                std::vector<double> A_ext(K_gll);
+                std::vector<double> B_ext(w_gll);
+                std::vector<double> A_gll(n_l * n_l);
+                std::vector<double> V_gll(n_l * n_l);
+                std::vector<double> lambda_gll(n_l);
 
-            scaled_residual(r_fem[l], w_fem[l], A_fem[l], u_fem[l], f_fem[l], D_val_fem[l], coefs_fem[l].data[cheby_order - 1], work_dev_fem[l]);
+                for (int side = 0; side < 2; side++)
+                {
+                    int i = side * N_l;
 
-            for (int p = cheby_order - 2; p >= 0; p--)
-                polynomial_evaluation(w_fem[l], v_fem[l], A_fem[l], r_fem[l], D_val_fem[l], coefs_fem[l].data[p], work_dev_fem[l]);
+                    if (bc & (1 << side))
+                    {
+                        // Dirichlet end, decoupled with a unit eigenvalue
+                        for (int j = 0; j < n_l; j++) A_ext[i * n_l + j] = A_ext[j * n_l + i] = 0.0;
+                        A_ext[i * n_l + i] = B_ext[i];
+                    }
+                    else
+                    {
+                        // Shared end, the neighbour contributes its own end diagonal (its interior is held at zero)
+                        A_ext[i * n_l + i] += K_gll[(N_l - i) * n_l + (N_l - i)];
+                        B_ext[i] += w_gll[N_l - i];
+                    }
+                }
 
-            update_field(u_fem[l], w_fem[l], D_val_fem[l]);
+                // Symmetrically scaled stiffness B^{-1/2} A B^{-1/2}
+                for (int i = 0; i < n_l; i++)
+                    for (int j = 0; j < n_l; j++)
+                        A_gll[i * n_l + j] = A_ext[i * n_l + j] / std::sqrt(B_ext[i] * B_ext[j]);
 
-            // Compute residual
-            v_fem[l].copy_from(f_fem[l]);
-            A_fem[l].matvec(v_fem[l], u_fem[l], - 1.0, 1.0);
+                math.symmetric_eigensolver(V_gll.data(), lambda_gll.data(), A_gll.data(), n_l);
 
-            // Restrict
-            if (l == level_cutoff)
-            {
-                R_fem[l].matvec(work_dev_fem[l + 1], v_fem[l]);
-                f_fem[l + 1].copy_from(work_dev_fem[l + 1]);
-            }
-            else
-            {
-                R_fem[l].matvec(f_fem[l + 1], v_fem[l]);
+                for (int i = 0; i < n_l; i++)
+                    for (int k = 0; k < n_l; k++)
+                        S_hst[bc * n_l * n_l + i * n_l + k] = (DType)(V_gll[i * n_l + k] / std::sqrt(B_ext[i]));
+
+                for (int k = 0; k < n_l; k++) lambda_hst[bc * n_l + k] = (DType)(lambda_gll[k]);
             }
+
+            fdm_S[l] = device_malloc<DType>(4 * n_l * n_l);
+            fdm_S[l].copyFrom(S_hst.data(), 4 * n_l * n_l * sizeof(DType));
+
+            fdm_lambda[l] = device_malloc<DType>(4 * n_l);
+            fdm_lambda[l].copyFrom(lambda_hst.data(), 4 * n_l * sizeof(DType));
         }
 
-        cudaStreamEndCapture(cuda_stream, &down_leg_graph);
-        cudaGraphInstantiate(&down_leg_instance, down_leg_graph, NULL, NULL, 0);
+        // Per element scales from the Jacobian-weighted geometric factors (sum of G_dd and of the mass over the sum of the
+        // reference weights, 2^dim), and the Dirichlet ends of every direction
+        std::vector<std::vector<DType>> scale_hst(num_levels);
+        std::vector<std::vector<int>> bc_hst(num_levels);
+        std::vector<std::vector<DType>> fact_hst(dim + 1, std::vector<DType>(subdomain_operator.num_points));
 
-        cudaStreamBeginCapture(cuda_stream, cudaStreamCaptureModeGlobal);
+        for (int d = 0; d < dim; d++) subdomain_operator.geom_fact[d].copyTo(fact_hst[d].data(), subdomain_operator.num_points * sizeof(DType));
+        subdomain_operator.mass_fact.copyTo(fact_hst[dim].data(), subdomain_operator.num_points * sizeof(DType));
 
-        for (int l = level_cutoff + 1; l > 0; l--)
+        for (int l = 0; l < num_levels; l++)
         {
-            // Coarse grid correction
-            if (l - 1 == level_cutoff)
+            int num_level_elems = subdomain_operator.level_points[l] / (int)(std::pow(poly_degree[l] + 1, dim));
+
+            scale_hst[l].resize((dim + 1) * num_level_elems);
+            bc_hst[l].resize(num_level_elems, 0);
+        }
+
+        for (auto &elem : subdomain_region)
+        {
+            int l = level_degree[elem.poly_degree];
+            int N_e = elem.poly_degree;
+            int n_e = N_e + 1;
+            int e = (elem.offset - subdomain_operator.level_offset[l]) / elem.num_points;
+
+            for (int f = 0; f <= dim; f++)
             {
-                work_dev_fem[l].copy_from(u_fem[l]);
-                P_fem[l - 1].matvec(u_fem[l - 1], work_dev_fem[l], 1.0, 1.0);
+                double sum = 0.0;
+                for (int v = 0; v < elem.num_points; v++) sum += fact_hst[f][elem.offset + v];
+
+                scale_hst[l][e * (dim + 1) + f] = (DType)(sum / std::pow(2.0, dim));
             }
-            else
+
+            for (int d = 0; d < dim; d++)
             {
-                P_fem[l - 1].matvec(u_fem[l - 1], u_fem[l], 1.0, 1.0);
+                int stride = (int)(std::pow(n_e, d));
+
+                for (int side = 0; side < 2; side++)
+                {
+                    bool dirichlet = true;
+
+                    for (int v = 0; v < elem.num_points; v++)
+                        if (((v / stride) % n_e == side * N_e) and (elem.dirichlet_mask[v] > 0.0)) dirichlet = false;
+
+                    if (dirichlet) bc_hst[l][e] |= 1 << (2 * d + side);
+                }
             }
+        }
 
-            // Smooth solution
-            scaled_residual(r_fem[l - 1], w_fem[l - 1], A_fem[l - 1], u_fem[l - 1], f_fem[l - 1], D_val_fem[l - 1], coefs_fem[l - 1].data[cheby_order - 1], work_dev_fem[l - 1]);
+        for (int l = 0; l < num_levels; l++)
+        {
+            if (bc_hst[l].size() == 0) continue;
 
-            for (int p = cheby_order - 2; p >= 0; p--)
-                polynomial_evaluation(w_fem[l - 1], v_fem[l - 1], A_fem[l - 1], r_fem[l - 1], D_val_fem[l - 1], coefs_fem[l - 1].data[p], work_dev_fem[l - 1]);
+            fdm_scale[l] = device_malloc<DType>(scale_hst[l].size());
+            fdm_scale[l].copyFrom(scale_hst[l].data(), scale_hst[l].size() * sizeof(DType));
 
-            update_field(u_fem[l - 1], w_fem[l - 1], D_val_fem[l - 1]);
+            fdm_bc[l] = device_malloc<int>(bc_hst[l].size());
+            fdm_bc[l].copyFrom(bc_hst[l].data(), bc_hst[l].size() * sizeof(int));
         }
 
-        cudaStreamEndCapture(cuda_stream, &up_leg_graph);
-        cudaGraphInstantiate(&up_leg_instance, up_leg_graph, NULL, NULL, 0);
-#endif
+        // Inverse square root of the multiplicity of the composite degrees of freedom (applied on restriction and prolongation)
+        occa::memory ones_sub_l = work_dev[1].slice(0, subdomain_operator.num_points);
+        occa::memory ones_sub = work_dev[0].slice(0, subdomain_operator.num_extended_dofs);
+
+        for (int i = 0; i < std::max(subdomain_operator.num_points, subdomain_operator.num_extended_dofs + superdomain_operator.num_extended_dofs); i++) work_hst[0][i] = 1.0;
+
+        ones_sub_l.copyFrom(work_hst[0].data(), subdomain_operator.num_points * sizeof(DType));
+        work_dev[0].copyFrom(work_hst[0].data(), (subdomain_operator.num_extended_dofs + superdomain_operator.num_extended_dofs) * sizeof(DType));
+        subdomain_operator.Qt.multiply(ones_sub, ones_sub_l);
+
+        fdm_weight = device_malloc<DType>(Qt_int.num_rows);
+        Qt_int.multiply(fdm_weight, work_dev[0]);
+
+        fdm_weight.copyTo(work_hst[0].data(), Qt_int.num_rows * sizeof(DType));
+        for (int i = 0; i < Qt_int.num_rows; i++) work_hst[0][i] = (work_hst[0][i] > 0.0) ? 1.0 / std::sqrt(work_hst[0][i]) : 0.0;
+        fdm_weight.copyFrom(work_hst[0].data(), Qt_int.num_rows * sizeof(DType));
+
+        // Jacobi on the superdomain block
+        fdm_diagonal = device_malloc<DType>(superdomain_operator.num_extended_dofs);
+        superdomain_operator.A.diagonal(fdm_diagonal);
+
+        fdm_diagonal.copyTo(work_hst[0].data(), superdomain_operator.num_extended_dofs * sizeof(DType));
+        for (int i = 0; i < superdomain_operator.num_extended_dofs; i++) work_hst[0][i] = (work_hst[0][i] != 0.0) ? 1.0 / work_hst[0][i] : 0.0;
+        fdm_diagonal.copyFrom(work_hst[0].data(), superdomain_operator.num_extended_dofs * sizeof(DType));
     }
 
 #if 0
@@ -3785,15 +4208,7 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
             }
 
             // Coarse grid lolve
-            memcpy(hypre_VectorData(hypre_ParVectorLocalVector(hypre_ParAMGDataFArray(amg_data)[num_levels_fem - 1])), 
-                   f_fem[num_levels_fem - 1].data, 
-                   f_fem[num_levels_fem - 1].size * sizeof(Float));
-
-            hypre_GaussElimSolve(amg_data, num_levels_fem - 1, 9);
-
-            memcpy(u_fem[num_levels_fem - 1].data, 
-                   hypre_VectorData(hypre_ParVectorLocalVector(hypre_ParAMGDataUArray(amg_data)[num_levels_fem - 1])), 
-                   u_fem[num_levels_fem - 1].size * sizeof(Float));
+            coarse_solver_fem.solve(u_fem[num_levels_fem - 1], f_fem[num_levels_fem - 1]);
 
             // Up leg
             for (int l = num_levels_fem - 1; l > level_cutoff + 1; l--)
@@ -3855,31 +4270,60 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
 #endif
 
     // Solver
-    num_values = subdomain_operator.num_points + superdomain_operator.num_extended_dofs;
-
-    f = device.malloc<DType>(num_values);
-    u_k = device.malloc<DType>(num_values);
-    r_k = device.malloc<DType>(num_values);
-    r_kp1 = device.malloc<DType>(num_values);
-    q_k = device.malloc<DType>(num_values);
-    z_k = device.malloc<DType>(num_values);
-    p_k = device.malloc<DType>(num_values);
-
-    V.resize(num_vectors + 1); for (int i = 0; i < num_vectors + 1; i++) V[i] = device.malloc<DType>(num_values);
-    Z.resize(num_vectors); for (int i = 0; i < num_vectors; i++) Z[i] = device.malloc<DType>(num_values);
+    f = arena.get<DType>(solver_handle[0]);
+    u_k = arena.get<DType>(solver_handle[1]);
+    r_k = arena.get<DType>(solver_handle[2]);
+    r_kp1 = arena.get<DType>(solver_handle[3]);
+    q_k = arena.get<DType>(solver_handle[4]);
+    z_k = arena.get<DType>(solver_handle[5]);
+    p_k = arena.get<DType>(solver_handle[6]);
+
+    V.initialize(num_values, num_vectors + 1);
+    Z.initialize(num_values, num_vectors);
+    basis_coefs.resize(num_vectors + 1);
     H.resize(num_vectors); for (int i = 0; i < num_vectors; i++) H[i].resize(num_vectors);
     c_gmres.resize(num_vectors);
     s_gmres.resize(num_vectors);
     gamma.resize(num_vectors + 1);
 
+    V_assembled.initialize(subdomain_operator.num_extended_dofs + superdomain_operator.num_extended_dofs, num_vectors + 1);
+
+#if SUBDOMAIN_S_STEP == 1
+    std::vector<DType*> V_assembled_ptr_hst(num_vectors + 1);
+    for (int i = 0; i < num_vectors + 1; i++) V_assembled_ptr_hst[i] = (DType*)(V_assembled[i].ptr());
+
+    V_assembled_ptr = device_malloc<DType*>(num_vectors + 1);
+    V_assembled_ptr.copyFrom(V_assembled_ptr_hst.data(), (num_vectors + 1) * sizeof(DType*));
+#endif
+
     // Kernels
     num_blocks = (num_values + BLOCK_SIZE - 1) / BLOCK_SIZE;
 
-    occa::properties properties;
+    build_kernels(domain.data_type);
 
-    properties["defines/DType"] = data_type;
-    properties["defines/EType"] = domain.data_type;
-    properties["defines/DIM"] = dim;
+#if (LEVEL_KERNELS == 1) && (LEVEL_STREAMS == 1) && (OCCA_TYPE == 1)
+    // The current stream belongs to the shared device, so only a single part may switch it
+    if (num_parts_ == 1)
+    {
+        concurrent_levels = true;
+        default_stream = device.getStream();
+
+        level_stream.resize(num_levels);
+        for (int l = 0; l < num_levels; l++) level_stream[l] = device.createStream();
+    }
+#endif
+
+    select_level_operators();
+}
+
+template<typename DType>
+void Subdomain<DType>::build_kernels(const char *domain_data_type)
+{
+    occa::properties properties;
+
+    properties["defines/DType"] = data_type;
+    properties["defines/EType"] = domain_data_type;
+    properties["defines/DIM"] = dim;
     properties["defines/OCCA_TYPE"] = OCCA_TYPE;
     properties["defines/BLOCK_SIZE"] = BLOCK_SIZE;
 
@@ -3889,53 +4333,214 @@ Subdomain<DType>::Subdomain(std::unordered_map<int, PType> domains, int poly_deg
     poly_degree_str += std::to_string(poly_degree[num_levels - 1]) + " }";
     properties["defines/POLY_DEGREE"] = poly_degree_str;
 
-    if (proc_id == 0)
-    {
-        initialize_arrays_kernel = device.buildKernel("subdomain.okl", "initialize_arrays", properties);
-        stiffness_matrix_1_kernel = device.buildKernel("subdomain.okl", "stiffness_matrix_1", properties);
-        stiffness_matrix_2_kernel = device.buildKernel("subdomain.okl", "stiffness_matrix_2", properties);
-        inner_product_kernel = device.buildKernel("subdomain.okl", "inner_product", properties);
-        weighted_inner_product_kernel = device.buildKernel("subdomain.okl", "weighted_inner_product", properties);
-        projection_inner_products_kernel = device.buildKernel("subdomain.okl", "projection_inner_products", properties);
-        solution_and_residual_update_kernel = device.buildKernel("subdomain.okl", "solution_and_residual_update", properties);
-        search_update_inner_product_kernel = device.buildKernel("subdomain.okl", "search_update_inner_product", properties);
-        residual_and_search_update_kernel = device.buildKernel("subdomain.okl", "residual_and_search_update", properties);
-
-        copy_from_domain_data_kernel = device.buildKernel("subdomain.okl", "copy_from_domain_data", properties);
-        copy_to_domain_data_kernel = device.buildKernel("subdomain.okl", "copy_to_domain_data", properties);
-        if (dim >= 1) restriction_1_kernel = device.buildKernel("subdomain.okl", "restriction_1", properties);
-        if (dim >= 2) restriction_2_kernel = device.buildKernel("subdomain.okl", "restriction_2", properties);
-        if (dim >= 3) restriction_3_kernel = device.buildKernel("subdomain.okl", "restriction_3", properties);
+    initialize_arrays_kernel = kernel_registry.get("subdomain.okl", "initialize_arrays", properties);
+    stiffness_matrix_1_kernel = kernel_registry.get("subdomain.okl", "stiffness_matrix_1", properties);
+    stiffness_matrix_2_kernel = kernel_registry.get("subdomain.okl", "stiffness_matrix_2", properties);
+
+#if LEVEL_KERNELS == 1
+    stiffness_matrix_fused_level_kernel.resize(num_levels);
+    stiffness_matrix_1_level_kernel.resize(num_levels);
+    stiffness_matrix_2_level_kernel.resize(num_levels);
+    use_fused_level.assign(num_levels, false);
+    stiffness_matrix_element_level_kernel.resize(num_levels);
+    unit_vector_level_kernel.resize(num_levels);
+    element_matrix_column_level_kernel.resize(num_levels);
+
+    for (int l = 0; l < num_levels; l++)
+    {
+        occa::properties level_properties = properties;
+        level_properties["defines/N_X"] = poly_degree[l] + 1;
+
+        int n = poly_degree[l] + 1;
+        int n_elem_points = (int)(std::pow(n, dim));
+
+        // The element, its dim fluxes and D_hat must fit in the portable 48 KB of static shared memory (3D double up to degree 10)
+        use_fused_level[l] = (((dim + 1) * n_elem_points + n * n) * (int)(sizeof(DType)) <= 48 * 1024);
+
+        if (use_fused_level[l])
+        {
+            stiffness_matrix_fused_level_kernel[l] = kernel_registry.get("subdomain.okl", "stiffness_matrix_fused_level", level_properties);
+        }
+        else
+        {
+            stiffness_matrix_1_level_kernel[l] = kernel_registry.get("subdomain.okl", "stiffness_matrix_1_level", level_properties);
+            stiffness_matrix_2_level_kernel[l] = kernel_registry.get("subdomain.okl", "stiffness_matrix_2_level", level_properties);
+        }
+
+        if (poly_degree[l] <= ELEMENT_MATRIX_DEGREE)
+        {
+            stiffness_matrix_element_level_kernel[l] = kernel_registry.get("subdomain.okl", "stiffness_matrix_element_level", level_properties);
+            unit_vector_level_kernel[l] = kernel_registry.get("subdomain.okl", "unit_vector_level", level_properties);
+            element_matrix_column_level_kernel[l] = kernel_registry.get("subdomain.okl", "element_matrix_column_level", level_properties);
+        }
     }
+#endif
+    fdm_contraction_level_kernel.resize(num_levels);
+    fdm_scaling_level_kernel.resize(num_levels);
+
+    for (int l = 0; l < num_levels; l++)
+    {
+        occa::properties level_properties = properties;
+        level_properties["defines/N_X"] = poly_degree[l] + 1;
 
-    MPI_Barrier(MPI_COMM_WORLD);
-
-    if (proc_id > 0)
-    {
-        initialize_arrays_kernel = device.buildKernel("subdomain.okl", "initialize_arrays", properties);
-        stiffness_matrix_1_kernel = device.buildKernel("subdomain.okl", "stiffness_matrix_1", properties);
-        stiffness_matrix_2_kernel = device.buildKernel("subdomain.okl", "stiffness_matrix_2", properties);
-        inner_product_kernel = device.buildKernel("subdomain.okl", "inner_product", properties);
-        weighted_inner_product_kernel = device.buildKernel("subdomain.okl", "weighted_inner_product", properties);
-        projection_inner_products_kernel = device.buildKernel("subdomain.okl", "projection_inner_products", properties);
-        solution_and_residual_update_kernel = device.buildKernel("subdomain.okl", "solution_and_residual_update", properties);
-        search_update_inner_product_kernel = device.buildKernel("subdomain.okl", "search_update_inner_product", properties);
-        residual_and_search_update_kernel = device.buildKernel("subdomain.okl", "residual_and_search_update", properties);
-
-        copy_from_domain_data_kernel = device.buildKernel("subdomain.okl", "copy_from_domain_data", properties);
-        copy_to_domain_data_kernel = device.buildKernel("subdomain.okl", "copy_to_domain_data", properties);
-        if (dim >= 1) restriction_1_kernel = device.buildKernel("subdomain.okl", "restriction_1", properties);
-        if (dim >= 2) restriction_2_kernel = device.buildKernel("subdomain.okl", "restriction_2", properties);
-        if (dim >= 3) restriction_3_kernel = device.buildKernel("subdomain.okl", "restriction_3", properties);
+        fdm_contraction_level_kernel[l] = kernel_registry.get("subdomain.okl", "fdm_contraction_level", level_properties);
+        fdm_scaling_level_kernel[l] = kernel_registry.get("subdomain.okl", "fdm_scaling_level", level_properties);
     }
 
-    MPI_Barrier(MPI_COMM_WORLD);
+    diagonal_scaling_kernel = kernel_registry.get("subdomain.okl", "diagonal_scaling", properties);
+    inner_product_kernel = kernel_registry.get("subdomain.okl", "inner_product", properties);
+    weighted_inner_product_kernel = kernel_registry.get("subdomain.okl", "weighted_inner_product", properties);
+    projection_inner_products_kernel = kernel_registry.get("subdomain.okl", "projection_inner_products", properties);
+    gram_matrix_kernel = kernel_registry.get("subdomain.okl", "gram_matrix", properties);
+    solution_and_residual_update_kernel = kernel_registry.get("subdomain.okl", "solution_and_residual_update", properties);
+    search_update_inner_product_kernel = kernel_registry.get("subdomain.okl", "search_update_inner_product", properties);
+    residual_and_search_update_kernel = kernel_registry.get("subdomain.okl", "residual_and_search_update", properties);
+
+    copy_from_domain_data_kernel = kernel_registry.get("subdomain.okl", "copy_from_domain_data", properties);
+    copy_to_domain_data_kernel = kernel_registry.get("subdomain.okl", "copy_to_domain_data", properties);
+    if (dim >= 1) restriction_1_kernel = kernel_registry.get("subdomain.okl", "restriction_1", properties);
+    if (dim >= 2) restriction_2_kernel = kernel_registry.get("subdomain.okl", "restriction_2", properties);
+    if (dim >= 3) restriction_3_kernel = kernel_registry.get("subdomain.okl", "restriction_3", properties);
+
+    // Fused tree restriction (degree sequence fixed at build time, one element per block)
+    use_fused_restriction = false;
+
+#if FUSED_RESTRICTION == 1
+    int tree_buffer_size = std::pow(poly_degree[0] + 1, dim);
+    int tree_J_size = 0;
+
+    for (int l = 0; l < num_levels - 1; l++) tree_J_size += (poly_degree[l] + 1) * (poly_degree[l + 1] + 1);
+
+    // Two element buffers and the interpolators must fit in the portable 48 KB of static shared memory
+    if ((num_levels > 1) and ((2 * tree_buffer_size + tree_J_size) * (int)(sizeof(DType)) <= 48 * 1024))
+    {
+        occa::properties tree_properties = properties;
+
+        std::string tree_degrees_str;
+        tree_degrees_str += "const int tree_n[] = { ";
+        for (int l = 0; l < num_levels - 1; l++) tree_degrees_str += std::to_string(poly_degree[l] + 1) + ", ";
+        tree_degrees_str += std::to_string(poly_degree[num_levels - 1] + 1) + " }";
+
+        tree_properties["defines/TREE_DEGREES"] = tree_degrees_str;
+        tree_properties["defines/NUM_TREE_LEVELS"] = num_levels;
+        tree_properties["defines/TREE_BUFFER_SIZE"] = tree_buffer_size;
+        tree_properties["defines/TREE_J_SIZE"] = tree_J_size;
+
+        fused_restriction_kernel = kernel_registry.get("subdomain.okl", "fused_restriction", tree_properties);
+        use_fused_restriction = true;
+    }
+#endif
+}
+
+// Per level choice between the matrix-free kernels and stored element matrices (timed on this device, low degrees only)
+template<typename DType>
+void Subdomain<DType>::select_level_operators()
+{
+    subdomain_operator.element_matrix.assign(num_levels, occa::memory());
+
+#if (LEVEL_KERNELS == 1) && (ELEMENT_MATRIX_DEGREE > 0)
+    occa::memory u_tmp = arena.get<DType>(element_matrix_handle[0]);
+    occa::memory Au_tmp = arena.get<DType>(element_matrix_handle[1]);
+
+    const int num_tests = 10;
+
+    for (int l = 0; l < num_levels; l++)
+    {
+        if (poly_degree[l] > ELEMENT_MATRIX_DEGREE) continue;
+
+        int offset = subdomain_operator.level_offset[l];
+        int points = subdomain_operator.level_points[l];
+        int n_elem_points = (int)(std::pow(poly_degree[l] + 1, dim));
+
+        occa::memory K;
+        double t_free = 0.0;
+        double t_stored = 0.0;
+
+        if (points > 0)
+        {
+            // Columns of the element matrices from the matrix-free stiffness of the unit vectors (the mass term stays separate)
+            K = device_malloc<DType>((long long)(points) * n_elem_points);
+
+            for (int q = 0; q < n_elem_points; q++)
+            {
+                unit_vector_level_kernel[l](u_tmp, q, offset, points);
+                stiffness_matrix_level(l, Au_tmp, u_tmp, (DType)(1.0), (DType)(0.0));
+                element_matrix_column_level_kernel[l](K, Au_tmp, q, offset, points);
+            }
+
+            // Best of a few applications of each variant
+            for (int test = 0; test < num_tests; test++)
+            {
+                device.finish();
+                auto t_start = std::chrono::high_resolution_clock::now();
+
+                stiffness_matrix_level(l, Au_tmp, u_tmp, h1, h2);
+
+                device.finish();
+                auto t_middle = std::chrono::high_resolution_clock::now();
+
+                stiffness_matrix_element_level_kernel[l](Au_tmp, K, u_tmp, subdomain_operator.mass_fact, h1, h2, offset, points);
+
+                device.finish();
+                auto t_stop = std::chrono::high_resolution_clock::now();
+
+                double t_free_test = std::chrono::duration<double>(t_middle - t_start).count();
+                double t_stored_test = std::chrono::duration<double>(t_stop - t_middle).count();
+
+                t_free = (test == 0) ? t_free_test : std::min(t_free, t_free_test);
+                t_stored = (test == 0) ? t_stored_test : std::min(t_stored, t_stored_test);
+            }
+        }
+
+        // Every rank decides on the slowest rank's timings, so the level runs the same variant everywhere
+        double t_level[2] = { t_free, t_stored };
+        MPI_Allreduce(MPI_IN_PLACE, t_level, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+        t_free = t_level[0];
+        t_stored = t_level[1];
+
+        if (t_stored < t_free)
+            subdomain_operator.element_matrix[l] = K;
+        else if (K.isInitialized())
+            K.free();
+
+        rstdout("Subdomain level N = %d: %s element operator (%.3g us matrix-free, %.3g us stored)\n", poly_degree[l], 
+                (t_stored < t_free) ? "stored" : "matrix-free", t_free * 1.0e6, t_stored * 1.0e6);
+    }
+#endif
+}
+
+template<typename DType>
+void Subdomain<DType>::prebuild_kernels(int poly_degree_, int poly_reduction_, const char *domain_data_type)
+{
+    // Kernels only depend on the polynomial levels, so an empty subdomain is enough
+    Subdomain<DType> subdomain;
+
+    subdomain.poly_degree.push_back(poly_degree_);
+
+    while (subdomain.poly_degree.back() > 1)
+        subdomain.poly_degree.push_back(std::max(subdomain.poly_degree.back() - poly_reduction_, 1));
+
+    subdomain.num_levels = subdomain.poly_degree.size();
+    subdomain.build_kernels(domain_data_type);
+}
+
+template<typename DType>
+Subdomain<DType>::Subdomain()
+{
+
 }
 
 template<typename DType>
 Subdomain<DType>::~Subdomain()
 {
+#if COARSE_EXCHANGE == 1
+    // Communicators left after MPI_Finalize can no longer be released
+    int finalized;
+    MPI_Finalized(&finalized);
 
+    if ((!finalized) and (coarse_comm != MPI_COMM_NULL)) MPI_Comm_free(&coarse_comm);
+#endif
 }
 
 // Member functions
@@ -3950,6 +4555,34 @@ void Subdomain<DType>::stiffness_matrix(occa::memory &Au, occa::memory &u)
 
     superdomain_operator.A.multiply(Au_sup, u_sup);
 
+#if LEVEL_KERNELS == 1
+    // Levels are independent, so they may run on their own streams once the inputs on the default stream are ready
+    if (concurrent_levels) device.finish();
+
+    for (int l = 0; l < num_levels; l++)
+    {
+        if (subdomain_operator.level_points[l] == 0) continue;
+        if (concurrent_levels) device.setStream(level_stream[l]);
+
+        if (subdomain_operator.element_matrix[l].isInitialized())
+        {
+            stiffness_matrix_element_level_kernel[l](Au_sub_l, subdomain_operator.element_matrix[l], 
+                                                     u_sub_l, subdomain_operator.mass_fact, h1, h2, 
+                                                     subdomain_operator.level_offset[l], 
+                                                     subdomain_operator.level_points[l]);
+        }
+        else
+        {
+            stiffness_matrix_level(l, Au_sub_l, u_sub_l, h1, h2);
+        }
+    }
+
+    if (concurrent_levels)
+    {
+        device.setStream(default_stream);
+        for (auto &stream : level_stream) stream.finish();
+    }
+#else
     stiffness_matrix_1_kernel(work_dev_ptr, u_sub_l, 
                               subdomain_operator.D_hat_ptr, 
                               subdomain_operator.offset, 
@@ -3963,7 +4596,41 @@ void Subdomain<DType>::stiffness_matrix(occa::memory &Au, occa::memory &u)
                               subdomain_operator.offset, 
                               subdomain_operator.vertex, 
                               subdomain_operator.level, 
+                              u_sub_l, subdomain_operator.mass_fact, h1, h2, 
                               subdomain_operator.num_points);
+#endif
+}
+
+// Matrix-free stiffness of one level: fused in shared memory where the element fits, otherwise two passes through the work arrays
+template<typename DType>
+void Subdomain<DType>::stiffness_matrix_level(int l, occa::memory &Au_sub_l, occa::memory &u_sub_l, DType h1_, DType h2_)
+{
+    int offset = subdomain_operator.level_offset[l];
+    int points = subdomain_operator.level_points[l];
+
+    if (use_fused_level[l])
+    {
+        int n_elem_points = (int)(std::pow(poly_degree[l] + 1, dim));
+
+        stiffness_matrix_fused_level_kernel[l](Au_sub_l, u_sub_l, 
+                                               subdomain_operator.D_hat[l], 
+                                               subdomain_operator.geom_fact_ptr, 
+                                               subdomain_operator.mass_fact, h1_, h2_, 
+                                               offset, points / n_elem_points);
+    }
+    else
+    {
+        // Levels write disjoint ranges of the work arrays, so concurrent level streams stay safe
+        stiffness_matrix_1_level_kernel[l](work_dev_ptr, u_sub_l, 
+                                           subdomain_operator.D_hat[l], 
+                                           subdomain_operator.geom_fact_ptr, 
+                                           offset, points);
+
+        stiffness_matrix_2_level_kernel[l](Au_sub_l, work_dev_ptr, 
+                                           subdomain_operator.D_hat[l], 
+                                           u_sub_l, subdomain_operator.mass_fact, h1_, h2_, 
+                                           offset, points);
+    }
 }
 
 template<typename DType>
@@ -3984,6 +4651,171 @@ void Subdomain<DType>::direct_stiffness_summation(occa::memory &QQtu, occa::memo
     QQtu_sup.copyFrom(work_dev[1].slice(subdomain_operator.num_extended_dofs, superdomain_operator.num_extended_dofs), superdomain_operator.num_extended_dofs * sizeof(DType));
 }
 
+// New coefficients of (h1 A + h2 B) u, the operators are recombined along the hierarchies built at setup
+template<typename DType>
+void Subdomain<DType>::refresh_coefficients(DType h1_, DType h2_)
+{
+    if (!keep_coefficients)
+    {
+        pstdout("The subdomain operators were set up without HELMHOLTZ_REFRESH, the coefficients cannot change\n");
+        quit();
+    }
+
+    h1 = h1_;
+    h2 = h2_;
+
+    // Assembled superdomain operator
+    if (superdomain_operator.A.num_nnz > 0)
+    {
+        auto &A_sup = superdomain_operator.A;
+        std::vector<DType> A_sup_val(A_sup.num_nnz);
+
+        for (int ptr = 0; ptr < A_sup.num_nnz; ptr++) A_sup_val[ptr] = h1 * A_sup.host_val[ptr];
+
+        for (int row = 0; row < A_sup.num_rows; row++)
+            if (superdomain_operator.diag_ptr[row] >= 0)
+                A_sup_val[superdomain_operator.diag_ptr[row]] += h2 * superdomain_operator.mass_diag[row];
+
+        A_sup.val.copyFrom(A_sup_val.data(), A_sup.num_nnz * sizeof(DType));
+    }
+
+    // AMG preconditioner (the interpolation is kept, the smoothers follow the new diagonal and spectrum)
+    if (use_preconditioner)
+    {
+        for (int l = 0; l < num_levels_fem; l++)
+        {
+            std::vector<Float> A_val(K_val_fem[l].size());
+            std::vector<Float> D_val(A_fem[l].num_rows);
+
+            for (unsigned int ptr = 0; ptr < A_val.size(); ptr++) A_val[ptr] = h1 * K_val_fem[l][ptr] + h2 * M_val_fem[l][ptr];
+
+            for (int i = 0; i < A_fem[l].num_rows; i++)
+            {
+                Float diag = std::abs(h1 * K_diag_fem[l][i] + h2 * M_diag_fem[l][i]);
+                D_val[i] = (diag > 0.0) ? 1.0 / std::sqrt(diag) : 0.0;
+            }
+
+            if (strcmp(A_fem[l].mem_loc, "host") == 0)
+            {
+                memcpy(A_fem[l].val, A_val.data(), A_val.size() * sizeof(Float));
+                memcpy(D_val_fem[l].data, D_val.data(), D_val.size() * sizeof(Float));
+            }
+            else
+            {
+                cudaMemcpy(A_fem[l].val, A_val.data(), A_val.size() * sizeof(Float), cudaMemcpyHostToDevice);
+                cudaMemcpy(D_val_fem[l].data, D_val.data(), D_val.size() * sizeof(Float), cudaMemcpyHostToDevice);
+            }
+        }
+
+        element_operator_fem.scale = h1;
+
+        coarse_solver_fem.initialize(A_fem[num_levels_fem - 1], coarse_inverse_cutoff);
+
+        // Chebyshev coefficients of 1/x scale as c_k / s^(k + 1) when the eigenvalue interval scales by s
+        const int num_power_iterations = 10;
+
+        for (int l = 0; l < num_levels_fem - 1; l++)
+        {
+            Float lambda = scaled_max_eigenvalue(A_fem[l], D_val_fem[l], v_fem[l], w_fem[l], r_fem[l], num_power_iterations);
+
+            if ((lambda <= 0.0) or (lambda_fem[l] <= 0.0)) continue;
+
+            Float s = lambda / lambda_fem[l];
+
+            for (int k = 0; k < cheby_order; k++)
+                coefs_fem[l].data[k] /= std::pow(s, k + 1);
+
+            lambda_fem[l] = lambda;
+        }
+
+#if USE_CUDA_GRAPH == 1
+        cudaGraphExecDestroy(down_leg_instance);
+        cudaGraphDestroy(down_leg_graph);
+        cudaGraphExecDestroy(up_leg_instance);
+        cudaGraphDestroy(up_leg_graph);
+
+        capture_cycle_graphs();
+#endif
+    }
+
+    // Fast diagonalization preconditioner (the element scaling reads h1 and h2 directly)
+    if (use_preconditioner and (local_preconditioner == 1) and (superdomain_operator.num_extended_dofs > 0))
+    {
+        superdomain_operator.A.diagonal(fdm_diagonal);
+
+        fdm_diagonal.copyTo(work_hst[0].data(), superdomain_operator.num_extended_dofs * sizeof(DType));
+        for (int i = 0; i < superdomain_operator.num_extended_dofs; i++) work_hst[0][i] = (work_hst[0][i] != 0.0) ? 1.0 / work_hst[0][i] : 0.0;
+        fdm_diagonal.copyFrom(work_hst[0].data(), superdomain_operator.num_extended_dofs * sizeof(DType));
+    }
+}
+
+// Captures the device legs of the V-cycle (the Chebyshev coefficients are baked into the graphs)
+template<typename DType>
+void Subdomain<DType>::capture_cycle_graphs()
+{
+#if USE_CUDA_GRAPH == 1
+    cudaStreamBeginCapture(cuda_stream, cudaStreamCaptureModeGlobal);
+
+    for (int l = 0; l <= level_cutoff; l++)
+    {
+        // Smooth solution
+        if (l > 0) u_fem[l].set_to_value(0.0);
+
+        scaled_residual(r_fem[l], w_fem[l], A_fem[l], u_fem[l], f_fem[l], D_val_fem[l], coefs_fem[l].data[cheby_order - 1], work_dev_fem[l]);
+
+        for (int p = cheby_order - 2; p >= 0; p--)
+            polynomial_evaluation(w_fem[l], v_fem[l], A_fem[l], r_fem[l], D_val_fem[l], coefs_fem[l].data[p], work_dev_fem[l]);
+
+        update_field(u_fem[l], w_fem[l], D_val_fem[l]);
+
+        // Compute residual
+        v_fem[l].copy_from(f_fem[l]);
+        A_fem[l].matvec(v_fem[l], u_fem[l], - 1.0, 1.0);
+
+        // Restrict
+        if (l == level_cutoff)
+        {
+            R_fem[l].matvec(work_dev_fem[l + 1], v_fem[l]);
+            f_fem[l + 1].copy_from(work_dev_fem[l + 1]);
+        }
+        else
+        {
+            R_fem[l].matvec(f_fem[l + 1], v_fem[l]);
+        }
+    }
+
+    cudaStreamEndCapture(cuda_stream, &down_leg_graph);
+    cudaGraphInstantiate(&down_leg_instance, down_leg_graph, NULL, NULL, 0);
+
+    cudaStreamBeginCapture(cuda_stream, cudaStreamCaptureModeGlobal);
+
+    for (int l = level_cutoff + 1; l > 0; l--)
+    {
+        // Coarse grid correction
+        if (l - 1 == level_cutoff)
+        {
+            work_dev_fem[l].copy_from(u_fem[l]);
+            P_fem[l - 1].matvec(u_fem[l - 1], work_dev_fem[l], 1.0, 1.0);
+        }
+        else
+        {
+            P_fem[l - 1].matvec(u_fem[l - 1], u_fem[l], 1.0, 1.0);
+        }
+
+        // Smooth solution
+        scaled_residual(r_fem[l - 1], w_fem[l - 1], A_fem[l - 1], u_fem[l - 1], f_fem[l - 1], D_val_fem[l - 1], coefs_fem[l - 1].data[cheby_order - 1], work_dev_fem[l - 1]);
+
+        for (int p = cheby_order - 2; p >= 0; p--)
+            polynomial_evaluation(w_fem[l - 1], v_fem[l - 1], A_fem[l - 1], r_fem[l - 1], D_val_fem[l - 1], coefs_fem[l - 1].data[p], work_dev_fem[l - 1]);
+
+        update_field(u_fem[l - 1], w_fem[l - 1], D_val_fem[l - 1]);
+    }
+
+    cudaStreamEndCapture(cuda_stream, &up_leg_graph);
+    cudaGraphInstantiate(&up_leg_instance, up_leg_graph, NULL, NULL, 0);
+#endif
+}
+
 template<typename DType>
 void Subdomain<DType>::low_order_preconditioner(occa::memory &z, occa::memory &r)
 {
@@ -4077,15 +4909,7 @@ void Subdomain<DType>::low_order_preconditioner(occa::memory &z, occa::memory &r
         // Coarse grid lolve
         timer.start("subdomain.preconditioner.coarse_grid_solver");
 
-        memcpy(hypre_VectorData(hypre_ParVectorLocalVector(hypre_ParAMGDataFArray(amg_data)[num_levels_fem - 1])), 
-               f_fem[num_levels_fem - 1].data, 
-               f_fem[num_levels_fem - 1].size * sizeof(Float));
-
-        hypre_GaussElimSolve(amg_data, num_levels_fem - 1, 9);
-
-        memcpy(u_fem[num_levels_fem - 1].data, 
-               hypre_VectorData(hypre_ParVectorLocalVector(hypre_ParAMGDataUArray(amg_data)[num_levels_fem - 1])), 
-               u_fem[num_levels_fem - 1].size * sizeof(Float));
+        coarse_solver_fem.solve(u_fem[num_levels_fem - 1], f_fem[num_levels_fem - 1]);
 
         timer.stop("subdomain.preconditioner.coarse_grid_solver");
 
@@ -4146,11 +4970,212 @@ void Subdomain<DType>::low_order_preconditioner(occa::memory &z, occa::memory &r
     Q_int.multiply(work_dev[0], work_dev[1]);
     timer.stop("subdomain.preconditioner.unassemble_composite");
 
-    occa::memory z_sub_l = z.slice(0, subdomain_operator.num_points);
-    occa::memory z_sup = z.slice(subdomain_operator.num_points, superdomain_operator.num_extended_dofs);
-
+    occa::memory z_sub_l = z.slice(0, subdomain_operator.num_points);
+    occa::memory z_sup = z.slice(subdomain_operator.num_points, superdomain_operator.num_extended_dofs);
+
+    timer.start("subdomain.preconditioner.unassemble_subdomain");
+    subdomain_operator.Q.multiply(z_sub_l, work_dev[0]);
+    timer.stop("subdomain.preconditioner.unassemble_subdomain");
+
+    timer.start("subdomain.preconditioner.memcpy");
+    z_sup.copyFrom(work_sup, superdomain_operator.num_extended_dofs * sizeof(DType));
+    timer.stop("subdomain.preconditioner.memcpy");
+}
+
+// V-cycle of the low-order hierarchy below its finest level, from the composite residual in f_fem[0] to u_fem[1]
+template<typename DType>
+void Subdomain<DType>::coarse_correction()
+{
+    timer.start("subdomain.preconditioner.coarse_grid_solver");
+
+    // Restrict
+    if (level_cutoff == 0)
+    {
+        R_fem[0].matvec(work_dev_fem[1], f_fem[0]);
+        f_fem[1].copy_from(work_dev_fem[1]);
+    }
+    else
+    {
+        R_fem[0].matvec(f_fem[1], f_fem[0]);
+    }
+
+    // Down leg
+    for (int l = 1; l < num_levels_fem - 1; l++)
+    {
+        // Smooth solution
+        u_fem[l].set_to_value(0.0);
+
+        scaled_residual(r_fem[l], w_fem[l], A_fem[l], u_fem[l], f_fem[l], D_val_fem[l], coefs_fem[l].data[cheby_order - 1], work_dev_fem[l]);
+
+        for (int p = cheby_order - 2; p >= 0; p--)
+            polynomial_evaluation(w_fem[l], v_fem[l], A_fem[l], r_fem[l], D_val_fem[l], coefs_fem[l].data[p], work_dev_fem[l]);
+
+        update_field(u_fem[l], w_fem[l], D_val_fem[l]);
+
+        // Compute residual
+        v_fem[l].copy_from(f_fem[l]);
+        A_fem[l].matvec(v_fem[l], u_fem[l], - 1.0, 1.0);
+
+        // Restrict
+        if (l == level_cutoff)
+        {
+            R_fem[l].matvec(work_dev_fem[l + 1], v_fem[l]);
+            f_fem[l + 1].copy_from(work_dev_fem[l + 1]);
+        }
+        else
+        {
+            R_fem[l].matvec(f_fem[l + 1], v_fem[l]);
+        }
+    }
+
+    coarse_solver_fem.solve(u_fem[num_levels_fem - 1], f_fem[num_levels_fem - 1]);
+
+    // Up leg
+    for (int l = num_levels_fem - 1; l > 1; l--)
+    {
+        // Coarse grid correction
+        if (l - 1 == level_cutoff)
+        {
+            work_dev_fem[l].copy_from(u_fem[l]);
+            P_fem[l - 1].matvec(u_fem[l - 1], work_dev_fem[l], 1.0, 1.0);
+        }
+        else
+        {
+            P_fem[l - 1].matvec(u_fem[l - 1], u_fem[l], 1.0, 1.0);
+        }
+
+        // Smooth solution
+        scaled_residual(r_fem[l - 1], w_fem[l - 1], A_fem[l - 1], u_fem[l - 1], f_fem[l - 1], D_val_fem[l - 1], coefs_fem[l - 1].data[cheby_order - 1], work_dev_fem[l - 1]);
+
+        for (int p = cheby_order - 2; p >= 0; p--)
+            polynomial_evaluation(w_fem[l - 1], v_fem[l - 1], A_fem[l - 1], r_fem[l - 1], D_val_fem[l - 1], coefs_fem[l - 1].data[p], work_dev_fem[l - 1]);
+
+        update_field(u_fem[l - 1], w_fem[l - 1], D_val_fem[l - 1]);
+    }
+
+    timer.stop("subdomain.preconditioner.coarse_grid_solver");
+}
+
+// Two-level additive Schwarz: weighted element solves by fast diagonalization (Jacobi on the superdomain block) plus the
+// low-order coarse correction, z = Q (W R^T F^{-1} R W + P_0 C^{-1} R_0) Q^T r
+template<typename DType>
+void Subdomain<DType>::fast_diagonalization_preconditioner(occa::memory &z, occa::memory &r)
+{
+    occa::memory r_sub_l = r.slice(0, subdomain_operator.num_points);
+    occa::memory r_sup = r.slice(subdomain_operator.num_points, superdomain_operator.num_extended_dofs);
+    occa::memory z_sub_l = z.slice(0, subdomain_operator.num_points);
+    occa::memory z_sup = z.slice(subdomain_operator.num_points, superdomain_operator.num_extended_dofs);
+
+    occa::memory work_sub = work_dev[0].slice(0, subdomain_operator.num_extended_dofs);
+    occa::memory work_sup = work_dev[0].slice(subdomain_operator.num_extended_dofs, superdomain_operator.num_extended_dofs);
+    occa::memory work_sub_l = work_dev[1].slice(0, subdomain_operator.num_points);
+
+    // Composite residual
+    timer.start("subdomain.preconditioner.assemble_subdomain");
+    subdomain_operator.Qt.multiply(work_sub, r_sub_l);
+    timer.stop("subdomain.preconditioner.assemble_subdomain");
+
+    timer.start("subdomain.preconditioner.memcpy");
+    work_sup.copyFrom(r_sup, superdomain_operator.num_extended_dofs * sizeof(DType));
+    timer.stop("subdomain.preconditioner.memcpy");
+
+    timer.start("subdomain.preconditioner.assemble_composite");
+    Qt_int.multiply(work_dev[1], work_dev[0]);
+    timer.stop("subdomain.preconditioner.assemble_composite");
+
+    // Coarse correction (left in u_fem[1] until the element corrections are assembled)
+    timer.start("subdomain.preconditioner.memcpy");
+    cudaMemcpy(f_fem[0].data, work_dev[1].ptr(), f_fem[0].size * sizeof(Float), cudaMemcpyDeviceToDevice);
+    timer.stop("subdomain.preconditioner.memcpy");
+
+    coarse_correction();
+
+    // Weighted composite residual, scattered back to the elements
+    timer.start("subdomain.preconditioner.vector_operations");
+    diagonal_scaling_kernel(work_dev[1], work_dev[1], fdm_weight, Qt_int.num_rows);
+    timer.stop("subdomain.preconditioner.vector_operations");
+
+    timer.start("subdomain.preconditioner.unassemble_composite");
+    Q_int.multiply(work_dev[0], work_dev[1]);
+    timer.stop("subdomain.preconditioner.unassemble_composite");
+
+    timer.start("subdomain.preconditioner.unassemble_subdomain");
+    subdomain_operator.Q.multiply(z_sub_l, work_sub);
+    timer.stop("subdomain.preconditioner.unassemble_subdomain");
+
+    // Element inverses (S x S x S) Lambda^{-1} (S x S x S)^T, contracting one direction per launch (the result ends in the work array)
+    timer.start("subdomain.preconditioner.fast_diagonalization");
+
+    for (int l = 0; l < num_levels; l++)
+    {
+        if (subdomain_operator.level_points[l] == 0) continue;
+
+        int offset = subdomain_operator.level_offset[l];
+        int points = subdomain_operator.level_points[l];
+        occa::memory *x = &z_sub_l;
+        occa::memory *y = &work_sub_l;
+
+        for (int d = 0; d < dim; d++)
+        {
+            fdm_contraction_level_kernel[l](*y, *x, fdm_S[l], fdm_bc[l], 1, d, offset, points);
+            std::swap(x, y);
+        }
+
+        fdm_scaling_level_kernel[l](*y, *x, fdm_lambda[l], fdm_bc[l], fdm_scale[l], h1, h2, offset, points);
+        std::swap(x, y);
+
+        for (int d = 0; d < dim; d++)
+        {
+            fdm_contraction_level_kernel[l](*y, *x, fdm_S[l], fdm_bc[l], 0, d, offset, points);
+            std::swap(x, y);
+        }
+    }
+
+    timer.stop("subdomain.preconditioner.fast_diagonalization");
+
+    // Jacobi on the superdomain block
+    timer.start("subdomain.preconditioner.vector_operations");
+    diagonal_scaling_kernel(work_sup, work_sup, fdm_diagonal, superdomain_operator.num_extended_dofs);
+    timer.stop("subdomain.preconditioner.vector_operations");
+
+    // Weighted assembly of the element corrections
+    timer.start("subdomain.preconditioner.assemble_subdomain");
+    subdomain_operator.Qt.multiply(work_sub, work_sub_l);
+    timer.stop("subdomain.preconditioner.assemble_subdomain");
+
+    timer.start("subdomain.preconditioner.assemble_composite");
+    Qt_int.multiply_weight(work_dev[1], work_dev[0], fdm_weight);
+    timer.stop("subdomain.preconditioner.assemble_composite");
+
+    // Prolongated coarse correction added to the element corrections
+    timer.start("subdomain.preconditioner.memcpy");
+    cudaMemcpy(u_fem[0].data, work_dev[1].ptr(), u_fem[0].size * sizeof(Float), cudaMemcpyDeviceToDevice);
+    timer.stop("subdomain.preconditioner.memcpy");
+
+    timer.start("subdomain.preconditioner.coarse_grid_solver");
+
+    if (level_cutoff == 0)
+    {
+        work_dev_fem[1].copy_from(u_fem[1]);
+        P_fem[0].matvec(u_fem[0], work_dev_fem[1], 1.0, 1.0);
+    }
+    else
+    {
+        P_fem[0].matvec(u_fem[0], u_fem[1], 1.0, 1.0);
+    }
+
+    timer.stop("subdomain.preconditioner.coarse_grid_solver");
+
+    timer.start("subdomain.preconditioner.memcpy");
+    cudaMemcpy(work_dev[1].ptr(), u_fem[0].data, u_fem[0].size * sizeof(Float), cudaMemcpyDeviceToDevice);
+    timer.stop("subdomain.preconditioner.memcpy");
+
+    timer.start("subdomain.preconditioner.unassemble_composite");
+    Q_int.multiply(work_dev[0], work_dev[1]);
+    timer.stop("subdomain.preconditioner.unassemble_composite");
+
     timer.start("subdomain.preconditioner.unassemble_subdomain");
-    subdomain_operator.Q.multiply(z_sub_l, work_dev[0]);
+    subdomain_operator.Q.multiply(z_sub_l, work_sub);
     timer.stop("subdomain.preconditioner.unassemble_subdomain");
 
     timer.start("subdomain.preconditioner.memcpy");
@@ -4158,12 +5183,37 @@ void Subdomain<DType>::low_order_preconditioner(occa::memory &z, occa::memory &r
     timer.stop("subdomain.preconditioner.memcpy");
 }
 
+template<typename DType>
+void Subdomain<DType>::preconditioner(occa::memory &z, occa::memory &r)
+{
+    if (local_preconditioner == 1)
+        fast_diagonalization_preconditioner(z, r);
+    else
+        low_order_preconditioner(z, r);
+}
+
 template<typename DType>
 void Subdomain<DType>::flexible_conjugate_gradient(occa::memory &u_l, occa::memory &f_l, bool print_history, bool use_relative)
 {
     // Collect tree data
+    flexible_conjugate_gradient_tree(f_l);
+
+    // Local solve
+    flexible_conjugate_gradient_local(print_history, use_relative);
+
+    // Subdomain solution
+    copy_solution(u_l);
+}
+
+template<typename DType>
+void Subdomain<DType>::flexible_conjugate_gradient_tree(occa::memory &f_l)
+{
     tree_operator(r_k, f_l);
+}
 
+template<typename DType>
+void Subdomain<DType>::flexible_conjugate_gradient_local(bool print_history, bool use_relative)
+{
     // Initialize arrays
     timer.start("subdomain.vector_operations");
     math.set_to_value(u_k, 0.0, num_values);
@@ -4188,7 +5238,7 @@ void Subdomain<DType>::flexible_conjugate_gradient(occa::memory &u_l, occa::memo
     timer.start("subdomain.preconditioner");
 
     if (use_preconditioner)
-        low_order_preconditioner(z_k, r_k);
+        preconditioner(z_k, r_k);
     else
         direct_stiffness_summation(z_k, r_k);
 
@@ -4243,7 +5293,7 @@ void Subdomain<DType>::flexible_conjugate_gradient(occa::memory &u_l, occa::memo
         timer.start("subdomain.preconditioner");
 
         if (use_preconditioner)
-            low_order_preconditioner(z_k, r_kp1);
+            preconditioner(z_k, r_kp1);
         else
             direct_stiffness_summation(z_k, r_kp1);
 
@@ -4261,10 +5311,7 @@ void Subdomain<DType>::flexible_conjugate_gradient(occa::memory &u_l, occa::memo
     }
 
     num_iterations += iter;
-
-    timer.start("subdomain.vector_operations");
-    copy_to_domain_data_kernel(u_l, u_k, levels[0].num_points);
-    timer.stop("subdomain.vector_operations");
+    last_iterations = iter;
 }
 
 template<typename DType>
@@ -4306,12 +5353,55 @@ void Subdomain<DType>::assembled_inner_product(DType &uv, occa::memory &u, occa:
     for (int b = 0; b < num_blocks; b++) uv += work_hst[0][b];
 }
 
+// Inner products of u with the first n assembled basis vectors in one pass
+template<typename DType>
+void Subdomain<DType>::assembled_inner_products(DType *uv, occa::memory &u, int n)
+{
+    occa::memory u_sub_l = u.slice(0, subdomain_operator.num_points);
+    occa::memory u_sup = u.slice(subdomain_operator.num_points, superdomain_operator.num_extended_dofs);
+    occa::memory u_work_sub = work_dev[0].slice(0, subdomain_operator.num_extended_dofs);
+    occa::memory u_work_sup = work_dev[0].slice(subdomain_operator.num_extended_dofs, superdomain_operator.num_extended_dofs);
+
+    subdomain_operator.Qt.multiply_weight(u_work_sub, u_sub_l, norm_weight);
+    u_sup.copyTo(u_work_sup, superdomain_operator.num_extended_dofs * sizeof(DType));
+
+    V_assembled.multi_dot(uv, work_dev[0], norm_weight, n);
+}
+
+template<typename DType>
+void Subdomain<DType>::assemble_basis_vector(int i)
+{
+    occa::memory V_sub_l = V[i].slice(0, subdomain_operator.num_points);
+    occa::memory V_sup = V[i].slice(subdomain_operator.num_points, superdomain_operator.num_extended_dofs);
+    occa::memory V_assembled_sub = V_assembled[i].slice(0, subdomain_operator.num_extended_dofs);
+    occa::memory V_assembled_sup = V_assembled[i].slice(subdomain_operator.num_extended_dofs, superdomain_operator.num_extended_dofs);
+
+    subdomain_operator.Qt.multiply_weight(V_assembled_sub, V_sub_l, norm_weight);
+    V_sup.copyTo(V_assembled_sup, superdomain_operator.num_extended_dofs * sizeof(DType));
+}
+
 template<typename DType>
 void Subdomain<DType>::generalized_minimum_residual(occa::memory &u_l, occa::memory &f_l, bool print_history, bool use_relative)
 {
     // Collect tree data
+    generalized_minimum_residual_tree(f_l);
+
+    // Local solve
+    generalized_minimum_residual_local(print_history, use_relative);
+
+    // Subdomain solution
+    copy_solution(u_l);
+}
+
+template<typename DType>
+void Subdomain<DType>::generalized_minimum_residual_tree(occa::memory &f_l)
+{
     tree_operator(f, f_l);
+}
 
+template<typename DType>
+void Subdomain<DType>::generalized_minimum_residual_local(bool print_history, bool use_relative)
+{
     // Initialize arrays
     timer.start("subdomain.vector_operations");
     initialize_arrays(u_k, r_k, f);
@@ -4363,8 +5453,19 @@ void Subdomain<DType>::generalized_minimum_residual(occa::memory &u_l, occa::mem
 
         timer.start("subdomain.vector_operations");
         math.vector_scaling(V[0], 1.0 / gamma[0], r_k, num_values);
+        assemble_basis_vector(0);
         timer.stop("subdomain.vector_operations");
 
+#if SUBDOMAIN_S_STEP == 1
+        // Falls through to Arnoldi when the basis is too ill-conditioned for CholQR
+        if (s_step_cycle(std::min(num_vectors, max_iterations - iter), iter, gamma[0], r_0_norm, print_history, use_relative, converged))
+        {
+            if (converged) break;
+            outer++;
+            continue;
+        }
+#endif
+
         for (j = 0; j < num_vectors; j++)
         {
             iter++;
@@ -4372,7 +5473,7 @@ void Subdomain<DType>::generalized_minimum_residual(occa::memory &u_l, occa::mem
 
             if (use_preconditioner)
             {
-                low_order_preconditioner(Z[j], V[j]);
+                preconditioner(Z[j], V[j]);
             }
             else
             {
@@ -4386,20 +5487,20 @@ void Subdomain<DType>::generalized_minimum_residual(occa::memory &u_l, occa::mem
             timer.stop("subdomain.operator_application");
 
             // 2-pass Gram-Schmidt (1st pass)
-            for (int i = 0; i < j + 1; i++)
-            {
-                timer.start("subdomain.inner_products");
-                assembled_inner_product(H[i][j], q_k, V[i]);
-                timer.stop("subdomain.inner_products");
-            }
+            timer.start("subdomain.inner_products");
+            assembled_inner_products(basis_coefs.data(), q_k, j + 1);
+            timer.stop("subdomain.inner_products");
 
             for (int i = 0; i < j + 1; i++)
             {
-                timer.start("subdomain.vector_operations");
-                math.vector_vector_addition(q_k, 1.0, q_k, - H[i][j], V[i], num_values);
-                timer.stop("subdomain.vector_operations");
+                H[i][j] = basis_coefs[i];
+                basis_coefs[i] = - basis_coefs[i];
             }
 
+            timer.start("subdomain.vector_operations");
+            V.linear_combination(q_k, basis_coefs.data(), j + 1);
+            timer.stop("subdomain.vector_operations");
+
             // Apply Given's rotation to new column
             for (int i = 0; i < j; i++)
             {
@@ -4454,6 +5555,7 @@ void Subdomain<DType>::generalized_minimum_residual(occa::memory &u_l, occa::mem
 
             timer.start("subdomain.vector_operations");
             math.vector_scaling(V[j + 1], 1.0 / alpha_j, q_k, num_values);
+            assemble_basis_vector(j + 1);
             timer.stop("subdomain.vector_operations");
         }
 
@@ -4470,22 +5572,248 @@ void Subdomain<DType>::generalized_minimum_residual(occa::memory &u_l, occa::mem
         }
 
         // Sum Arnoldi vectors
-        for (int i = 0; i < j + 1; i++)
-        {
-            timer.start("subdomain.vector_operations");
-            math.vector_vector_addition(u_k, 1.0, u_k, c_gmres[i], Z[i], num_values);
-            timer.stop("subdomain.vector_operations");
-        }
+        timer.start("subdomain.vector_operations");
+        Z.linear_combination(u_k, c_gmres.data(), j + 1);
+        timer.stop("subdomain.vector_operations");
 
         if (converged) break;
         outer++;
     }
 
+    num_iterations += iter;
+    last_iterations = iter;
+}
+
+template<typename DType>
+bool Subdomain<DType>::s_step_cycle(int num_steps, int &iter, DType r_norm, DType r_0_norm, bool print_history, bool use_relative, bool &converged)
+{
+    int s = num_steps;
+
+    // Change of basis: A M V_i = B[i - 1][i] V_{i - 1} + B[i][i] V_i + B[i + 1][i] V_{i + 1}
+    std::vector<std::vector<double>> B(s + 1, std::vector<double>(s, 0.0));
+
+    for (int i = 0; i < s; i++)
+    {
+        if (s_step_half_width > 0.0)
+        {
+            B[i][i] = s_step_center;
+            B[i + 1][i] = (i == 0) ? s_step_half_width : 0.5 * s_step_half_width;
+            if (i > 0) B[i - 1][i] = 0.5 * s_step_half_width;
+        }
+        else
+        {
+            B[i][i] = s_step_center;
+            B[i + 1][i] = 1.0;
+        }
+    }
+
+    // Basis with back-to-back preconditioner and operator applications
+    for (int i = 0; i < s; i++)
+    {
+        if (use_preconditioner)
+        {
+            preconditioner(Z[i], V[i]);
+        }
+        else
+        {
+            timer.start("subdomain.preconditioner.identity");
+            direct_stiffness_summation(Z[i], V[i]);
+            timer.stop("subdomain.preconditioner.identity");
+        }
+
+        timer.start("subdomain.operator_application");
+        stiffness_matrix(V[i + 1], Z[i]);
+        timer.stop("subdomain.operator_application");
+
+        timer.start("subdomain.vector_operations");
+        math.vector_vector_addition(V[i + 1], 1.0 / B[i + 1][i], V[i + 1], - B[i][i] / B[i + 1][i], V[i], num_values);
+        if (i > 0) math.vector_vector_addition(V[i + 1], 1.0, V[i + 1], - B[i - 1][i] / B[i + 1][i], V[i - 1], num_values);
+        timer.stop("subdomain.vector_operations");
+    }
+
+    // Gram matrix of the assembled basis with a single reduction
+    timer.start("subdomain.inner_products");
+    int num_assembled = subdomain_operator.num_extended_dofs + superdomain_operator.num_extended_dofs;
+    int num_assembled_blocks = (num_assembled + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    int num_pairs = ((s + 1) * (s + 2)) / 2;
+
+    for (int i = 0; i < s + 1; i++) assemble_basis_vector(i);
+
+    gram_matrix_kernel(work_dev[0], V_assembled_ptr, norm_weight, s + 1, num_assembled, num_assembled_blocks);
+    work_dev[0].copyTo(work_hst[0].data(), num_pairs * num_assembled_blocks * sizeof(DType));
+
+    std::vector<std::vector<double>> G(s + 1, std::vector<double>(s + 1, 0.0));
+
+    for (int a = 0, pair = 0; a < s + 1; a++)
+    {
+        for (int b = a; b < s + 1; b++, pair++)
+        {
+            for (int k = 0; k < num_assembled_blocks; k++) G[a][b] += work_hst[0][k + pair * num_assembled_blocks];
+            G[b][a] = G[a][b];
+        }
+    }
+    timer.stop("subdomain.inner_products");
+
+    // CholQR: G = R^T R (the orthonormal basis Q = V R^{-1} is never formed)
+    std::vector<std::vector<double>> R(s + 1, std::vector<double>(s + 1, 0.0));
+
+    for (int i = 0; i < s + 1; i++)
+    {
+        double pivot = G[i][i];
+        for (int k = 0; k < i; k++) pivot -= R[k][i] * R[k][i];
+
+        if (pivot <= epsilon * G[i][i]) return false;
+
+        R[i][i] = std::sqrt(pivot);
+
+        for (int j = i + 1; j < s + 1; j++)
+        {
+            double R_ij = G[i][j];
+            for (int k = 0; k < i; k++) R_ij -= R[k][i] * R[k][j];
+            R[i][j] = R_ij / R[i][i];
+        }
+    }
+
+    // Hessenberg matrix of A M in the Q basis: H = R B R_s^{-1}
+    std::vector<std::vector<double>> H_s(s + 1, std::vector<double>(s, 0.0));
+
+    for (int r = 0; r < s + 1; r++)
+    {
+        for (int j = 0; j < s; j++)
+        {
+            double RB_rj = 0.0;
+            for (int k = r; k < s + 1; k++) RB_rj += R[r][k] * B[k][j];
+            for (int k = 0; k < j; k++) RB_rj -= H_s[r][k] * R[k][j];
+
+            H_s[r][j] = RB_rj / R[j][j];
+        }
+    }
+
+    std::vector<std::vector<double>> H_ritz = H_s;
+
+    // Least squares with Givens rotations, one column per step
+    std::vector<double> c(s), sn(s), g(s + 1, 0.0);
+    g[0] = r_norm * R[0][0];
+
+    int m = s;
+
+    for (int j = 0; j < s; j++)
+    {
+        iter++;
+
+        for (int i = 0; i < j; i++)
+        {
+            double h_ij = H_s[i][j];
+            H_s[i][j] = c[i] * h_ij + sn[i] * H_s[i + 1][j];
+            H_s[i + 1][j] = - sn[i] * h_ij + c[i] * H_s[i + 1][j];
+        }
+
+        double alpha_j = H_s[j + 1][j];
+        double beta_j = std::sqrt(H_s[j][j] * H_s[j][j] + alpha_j * alpha_j);
+
+        c[j] = H_s[j][j] / beta_j;
+        sn[j] = alpha_j / beta_j;
+        H_s[j][j] = beta_j;
+        g[j + 1] = - sn[j] * g[j];
+        g[j] = c[j] * g[j];
+
+        DType residual = std::abs(g[j + 1]);
+        if (print_history) pstdout("- Iter %3d: | residual_norm = %24.16g | relative_residual_norm = %24.16g | \n", iter, residual, residual / r_0_norm);
+
+        if ((alpha_j == 0.0) or (use_relative and (residual / r_0_norm < tolerance)) or ((not use_relative) and (residual < tolerance)) or (iter >= max_iterations))
+        {
+            converged = true;
+            m = j + 1;
+            break;
+        }
+    }
+
+    // Coefficients in the V basis: R_m c = y with H_m y = g
+    std::vector<double> y(m);
+
+    for (int k = m - 1; k >= 0; k--)
+    {
+        y[k] = g[k];
+        for (int i = k + 1; i < m; i++) y[k] -= H_s[k][i] * y[i];
+        y[k] /= H_s[k][k];
+    }
+
+    for (int k = m - 1; k >= 0; k--)
+    {
+        for (int i = k + 1; i < m; i++) y[k] -= R[k][i] * y[i];
+        y[k] /= R[k][k];
+    }
+
     timer.start("subdomain.vector_operations");
-    copy_to_domain_data_kernel(u_l, u_k, levels[0].num_points);
+    for (int i = 0; i < m; i++) basis_coefs[i] = (DType)(y[i]);
+    Z.linear_combination(u_k, basis_coefs.data(), m);
     timer.stop("subdomain.vector_operations");
 
-    num_iterations += iter;
+    // Ritz values of this cycle bound the Chebyshev interval of the next one (unshifted QR on the small Hessenberg block)
+    std::vector<std::vector<double>> T(m, std::vector<double>(m));
+    for (int i = 0; i < m; i++) for (int j = 0; j < m; j++) T[i][j] = H_ritz[i][j];
+
+    bool singular = false;
+
+    for (int sweep = 0; (sweep < 100) and (not singular); sweep++)
+    {
+        std::vector<std::vector<double>> Q_t(m, std::vector<double>(m)), R_t(m, std::vector<double>(m, 0.0));
+
+        for (int j = 0; (j < m) and (not singular); j++)
+        {
+            for (int i = 0; i < m; i++) Q_t[j][i] = T[i][j];
+
+            for (int k = 0; k < j; k++)
+            {
+                for (int i = 0; i < m; i++) R_t[k][j] += Q_t[k][i] * Q_t[j][i];
+                for (int i = 0; i < m; i++) Q_t[j][i] -= R_t[k][j] * Q_t[k][i];
+            }
+
+            for (int i = 0; i < m; i++) R_t[j][j] += Q_t[j][i] * Q_t[j][i];
+            R_t[j][j] = std::sqrt(R_t[j][j]);
+
+            singular = (R_t[j][j] == 0.0);
+            if (not singular) for (int i = 0; i < m; i++) Q_t[j][i] /= R_t[j][j];
+        }
+
+        if (singular) break;
+
+        for (int i = 0; i < m; i++)
+        {
+            for (int j = 0; j < m; j++)
+            {
+                T[i][j] = 0.0;
+                for (int k = i; k < m; k++) T[i][j] += R_t[i][k] * Q_t[j][k];
+            }
+        }
+    }
+
+    double ritz_min = T[0][0];
+    double ritz_max = T[0][0];
+
+    for (int i = 1; i < m; i++)
+    {
+        ritz_min = std::min(ritz_min, T[i][i]);
+        ritz_max = std::max(ritz_max, T[i][i]);
+    }
+
+    if (std::isfinite(ritz_min) and std::isfinite(ritz_max) and (ritz_min > 0.0))
+    {
+        s_step_center = 0.5 * (ritz_max + ritz_min);
+        s_step_half_width = 0.5 * (ritz_max - ritz_min);
+    }
+
+    return true;
+}
+
+template<typename DType>
+void Subdomain<DType>::copy_solution(occa::memory &u_l)
+{
+    occa::memory u_part = u_l.slice(part_offset, part_points);
+
+    timer.start("subdomain.vector_operations");
+    copy_to_domain_data_kernel(u_part, u_k, part_points);
+    timer.stop("subdomain.vector_operations");
 }
 
 template<typename DType>
@@ -4573,7 +5901,9 @@ void Subdomain<DType>::tree_operator(occa::memory &Tu, occa::memory &u)
 
     timer.start("subdomain.tree_construction.subdomain");
 
-    for (int l = 0; l < num_levels - 1; l++)
+    if (use_fused_restriction) fused_restriction_kernel(work_dev[0], J_tree, levels[0].num_elements);
+
+    for (int l = 0; (l < num_levels - 1) and (not use_fused_restriction); l++)
     {
         int N_f = levels[l].poly_degree;
         int N_c = levels[l + 1].poly_degree;
@@ -4617,13 +5947,34 @@ void Subdomain<DType>::tree_operator(occa::memory &Tu, occa::memory &u)
 
     // Get coarse grid
     timer.start("subdomain.tree_exchange.superdomain");
+#if COARSE_EXCHANGE == 1
+    DType *coarse_data = work_hst[0].data() + levels[num_levels - 1].offset;
+    for (unsigned int i = 0; i < coarse_send_idx.size(); i++) coarse_send_buffer[i] = coarse_data[coarse_send_idx[i]];
+
+#if PRECONDITIONER_WIRE > 0
+    coarse_wire_send.pack(coarse_send_buffer.data());
+    MPI_Neighbor_alltoallv(coarse_wire_send.data(), coarse_wire_send.wire_count.data(), coarse_wire_send.wire_offset.data(), coarse_wire_send.datatype, coarse_wire_recv.data(), coarse_wire_recv.wire_count.data(), coarse_wire_recv.wire_offset.data(), coarse_wire_recv.datatype, coarse_comm);
+    coarse_wire_recv.unpack(work_hst[1].data());
+#else
+    MPI_Neighbor_alltoallv(coarse_send_buffer.data(), coarse_send_count.data(), coarse_send_offset.data(), (typeid(DType) == typeid(double)) ? MPI_DOUBLE : MPI_FLOAT, work_hst[1].data(), coarse_recv_count.data(), coarse_recv_offset.data(), (typeid(DType) == typeid(double)) ? MPI_DOUBLE : MPI_FLOAT, coarse_comm);
+#endif
+#else
     memcpy(work_hst[1].data() + proc_offset[proc_id], work_hst[0].data() + levels[num_levels - 1].offset, levels[num_levels - 1].num_points * sizeof(DType));
+
+#if PRECONDITIONER_WIRE > 0
+    // Own points are not unpacked, so they stay exact
+    coarse_wire_recv.pack(work_hst[1].data(), proc_id);
+    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, coarse_wire_recv.data(), coarse_wire_recv.wire_count.data(), coarse_wire_recv.wire_offset.data(), coarse_wire_recv.datatype, MPI_COMM_WORLD);
+    for (int p = 0; p < num_procs; p++) if (p != proc_id) coarse_wire_recv.unpack(work_hst[1].data(), p);
+#else
     MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, work_hst[1].data(), proc_count.data(), proc_offset.data(), (typeid(DType) == typeid(double)) ? MPI_DOUBLE : MPI_FLOAT, MPI_COMM_WORLD);
+#endif
+#endif
     timer.stop("subdomain.tree_exchange.superdomain");
 
     // Subdomain data
     timer.start("subdomain.tree_exchange.subdomain");
-    gslib_gs(work_hst[0].data(), gs_type, gs_add, 0, gs_handle, NULL);
+    gather_scatter.apply(work_hst[0].data(), PRECONDITIONER_WIRE > 0);
     timer.stop("subdomain.tree_exchange.subdomain");
 
     timer.start("subdomain.tree_exchange.cpu_to_gpu");
@@ -4645,126 +5996,158 @@ void Subdomain<DType>::tree_operator(occa::memory &Tu, occa::memory &u)
     timer.stop("subdomain.tree_construction.superdomain");
 }
 
-// Visit output
+// Memory
 template<typename DType>
-void Subdomain<DType>::output(std::string output_name, int num_fields, ...)
+void Subdomain<DType>::memory_usage()
 {
-    // Silo database
-    DBSetDeprecateWarnings(0);
-    DBfile *silo_file = NULL;
-    char silo_name[80];
-
-    sprintf(silo_name, "%s.%d.silo", output_name.c_str(), proc_id);
-    silo_file = DBCreate(silo_name, DB_CLOBBER, DB_LOCAL, "Field data", DB_PDB);
-
-    if (silo_file == NULL)
+    auto operator_usage = [&](const char *name, Stiffness_Operator<DType> &op)
     {
-        printf("ERROR: Couldn't create Silo file for \"p = %d\"\n", proc_id);
-
-        MPI_Finalize();
-        exit(EXIT_FAILURE);
-    }
-
-    // Mesh
-    int num_vertices = (dim == 2) ? 4 : 8;
-    int num_points = 0; for (auto &elem : elements) num_points += elem.num_points;
-    int num_elements = (int)(elements.size());
-    int num_low_order_elems = 0; for (auto &elem : elements) num_low_order_elems += std::pow(elem.poly_degree, dim);
-    int num_low_order_points = num_low_order_elems * num_vertices;
-
-    std::vector<int> element_offset(num_elements);
-    for (int e = 1; e < num_elements; e++) element_offset[e] = element_offset[e - 1] + elements[e - 1].num_points;
-
-    std::vector<int> low_order_elements(num_low_order_points);
-    int offset = 0;
+        memory.add(name, op.Q.memory_usage());
+        memory.add(name, op.Qt.memory_usage());
+        memory.add(name, op.A.memory_usage());
+        memory.add(name, op.P.memory_usage());
+        memory.add(name, op.Pt.memory_usage());
+        for (auto &D : op.D_hat) memory.add(name, D);
+        memory.add(name, op.D_hat_ptr);
+        for (int g = 0; g < NUM_GEOM_FACTS; g++) memory.add(name, op.geom_fact[g]);
+        memory.add(name, op.geom_fact_ptr);
+        memory.add(name, op.mass_fact);
+        for (auto &K : op.element_matrix) memory.add(name, K);
+        memory.add(name, op.element);
+        memory.add(name, op.vertex);
+        memory.add(name, op.level);
+        memory.add(name, op.offset);
+    };
 
-    if (dim == 2)
+    auto vector_usage = [&](std::vector<amg::Vector> &vectors)
     {
-        for (int e = 0; e < num_elements; e++)
+        for (auto &vec : vectors)
         {
-            auto &elem = elements[e];
-            int n_x = elem.n_x;
-
-            for (int s_y = 0; s_y < elem.poly_degree; s_y++)
-            {
-                for (int s_x = 0; s_x < elem.poly_degree; s_x++)
-                {
-                    low_order_elements[offset++] = element_offset[e] + (s_x + 0) + (s_y + 0) * n_x;
-                    low_order_elements[offset++] = element_offset[e] + (s_x + 1) + (s_y + 0) * n_x;
-                    low_order_elements[offset++] = element_offset[e] + (s_x + 1) + (s_y + 1) * n_x;
-                    low_order_elements[offset++] = element_offset[e] + (s_x + 0) + (s_y + 1) * n_x;
-                }
-            }
+            const char *name = strcmp(vec.mem_loc, "host") ? "subdomain.device.preconditioner" : "subdomain.host.preconditioner";
+            memory.add(name, (long long)(vec.size) * sizeof(Float));
         }
-    }
-    else
+    };
+
+    auto matrix_usage = [&](std::vector<amg::CSR_Matrix> &matrices)
     {
-        for (int e = 0; e < num_elements; e++)
+        for (auto &mat : matrices)
         {
-            auto &elem = elements[e];
-            int n_x = elem.n_x;
-            int n_xy = n_x * n_x;
-
-            for (int s_z = 0; s_z < elem.poly_degree; s_z++)
-            {
-                for (int s_y = 0; s_y < elem.poly_degree; s_y++)
-                {
-                    for (int s_x = 0; s_x < elem.poly_degree; s_x++)
-                    {
-                        low_order_elements[offset++] = element_offset[e] + (s_x + 0) + (s_y + 0) * n_x + (s_z + 0) * n_xy;
-                        low_order_elements[offset++] = element_offset[e] + (s_x + 1) + (s_y + 0) * n_x + (s_z + 0) * n_xy;
-                        low_order_elements[offset++] = element_offset[e] + (s_x + 1) + (s_y + 1) * n_x + (s_z + 0) * n_xy;
-                        low_order_elements[offset++] = element_offset[e] + (s_x + 0) + (s_y + 1) * n_x + (s_z + 0) * n_xy;
-                        low_order_elements[offset++] = element_offset[e] + (s_x + 0) + (s_y + 0) * n_x + (s_z + 1) * n_xy;
-                        low_order_elements[offset++] = element_offset[e] + (s_x + 1) + (s_y + 0) * n_x + (s_z + 1) * n_xy;
-                        low_order_elements[offset++] = element_offset[e] + (s_x + 1) + (s_y + 1) * n_x + (s_z + 1) * n_xy;
-                        low_order_elements[offset++] = element_offset[e] + (s_x + 0) + (s_y + 1) * n_x + (s_z + 1) * n_xy;
-                    }
-                }
-            }
+            const char *name = strcmp(mat.mem_loc, "host") ? "subdomain.device.preconditioner" : "subdomain.host.preconditioner";
+            memory.add(name, (long long)(mat.num_rows + 1) * sizeof(int) + (long long)(mat.num_nnz) * (sizeof(int) + sizeof(Float)));
         }
-    }
-
-    std::vector<DType> x, y, z;
+    };
 
-    if (dim >= 1)
+    // Host
+    for (auto &elem : elements) memory.add("subdomain.host.mesh", elem.memory_usage());
+    for (auto &work : work_hst) memory.add("subdomain.host.work", work);
+    for (auto &J : J_cf) memory.add("subdomain.host.work", J.second.first);
+    for (auto &D : D_hat) memory.add("subdomain.host.work", D.first);
+    memory.add("subdomain.host.work", coarse_send_idx);
+    memory.add("subdomain.host.work", coarse_send_buffer);
+    memory.add("subdomain.host.work", coarse_wire_send.memory_usage());
+    memory.add("subdomain.host.work", coarse_wire_recv.memory_usage());
+
+    if (keep_coefficients)
     {
-        x.resize(num_points);
-
-        for (int e = 0; e < num_elements; e++)
-        {
-            auto &elem = elements[e];
-            memcpy(x.data() + element_offset[e], elem.x.data(), elem.num_points * sizeof(DType));
-        }
+        memory.add("subdomain.host.work", superdomain_operator.A.host_ptr);
+        memory.add("subdomain.host.work", superdomain_operator.A.host_col);
+        memory.add("subdomain.host.work", superdomain_operator.A.host_val);
+        memory.add("subdomain.host.work", superdomain_operator.mass_diag);
+        memory.add("subdomain.host.work", superdomain_operator.diag_ptr);
     }
 
-    if (dim >= 2)
+    // Device
+    for (auto &J : J_cf) memory.add("subdomain.device.operator", J.second.second);
+    memory.add("subdomain.device.operator", J_cf_ptr);
+    memory.add("subdomain.device.operator", J_tree);
+    for (auto &D : D_hat) memory.add("subdomain.device.operator", D.second);
+    memory.add("subdomain.device.operator", D_hat_ptr);
+    memory.add("subdomain.device.operator", Qt_coarse.memory_usage());
+    memory.add("subdomain.device.operator", Q_int.memory_usage());
+    memory.add("subdomain.device.operator", Qt_int.memory_usage());
+    memory.add("subdomain.device.operator", QQt_int.memory_usage());
+    operator_usage("subdomain.device.operator", subdomain_operator);
+    operator_usage("subdomain.device.operator", superdomain_operator);
+
+    // Work arrays, solver vectors and bases are reported by the arena
+    memory.add("subdomain.device.solver", work_dev_ptr);
+    memory.add("subdomain.device.solver", norm_weight);
+    memory.add("subdomain.device.solver", inner_weight);
+    memory.add("subdomain.device.solver", V.memory_usage());
+    memory.add("subdomain.device.solver", Z.memory_usage());
+    memory.add("subdomain.device.solver", V_assembled.memory_usage());
+    memory.add("subdomain.device.solver", V_assembled_ptr);
+
+    // Preconditioner
+    if (use_preconditioner)
     {
-        y.resize(num_points);
-
-        for (int e = 0; e < num_elements; e++)
+        matrix_usage(A_fem);
+        memory.add("subdomain.device.preconditioner", element_operator_fem.memory_usage());
+        matrix_usage(P_fem);
+        matrix_usage(R_fem);
+        vector_usage(D_val_fem);
+        vector_usage(coefs_fem);
+        vector_usage(work_hst_fem);
+        vector_usage(work_dev_fem);
+        vector_usage(f_fem);
+        vector_usage(u_fem);
+        vector_usage(r_fem);
+        vector_usage(v_fem);
+        vector_usage(w_fem);
+
+        memory.add("subdomain.host.preconditioner", coarse_solver_fem.memory_usage());
+
+        if (keep_coefficients)
         {
-            auto &elem = elements[e];
-            memcpy(y.data() + element_offset[e], elem.y.data(), elem.num_points * sizeof(DType));
+            for (auto &K : K_val_fem) memory.add("subdomain.host.preconditioner", K);
+            for (auto &M : M_val_fem) memory.add("subdomain.host.preconditioner", M);
+            for (auto &K : K_diag_fem) memory.add("subdomain.host.preconditioner", K);
+            for (auto &M : M_diag_fem) memory.add("subdomain.host.preconditioner", M);
         }
     }
 
-    if (dim >= 3)
+    if (use_preconditioner and (local_preconditioner == 1))
     {
-        z.resize(num_points);
+        for (auto &S : fdm_S) memory.add("subdomain.device.preconditioner", S);
+        for (auto &lambda : fdm_lambda) memory.add("subdomain.device.preconditioner", lambda);
+        for (auto &scale : fdm_scale) memory.add("subdomain.device.preconditioner", scale);
+        for (auto &bc : fdm_bc) memory.add("subdomain.device.preconditioner", bc);
+        memory.add("subdomain.device.preconditioner", fdm_weight);
+        memory.add("subdomain.device.preconditioner", fdm_diagonal);
+    }
+}
 
-        for (int e = 0; e < num_elements; e++)
-        {
-            auto &elem = elements[e];
-            memcpy(z.data() + element_offset[e], elem.z.data(), elem.num_points * sizeof(DType));
-        }
+template<typename DType>
+void Subdomain<DType>::release_host_data(bool keep_mesh)
+{
+    // Interpolators and reference operators are only read on the host during setup
+    for (auto &J : J_cf) std::vector<DType>().swap(J.second.first);
+    for (auto &D : D_hat) std::vector<DType>().swap(D.first);
+
+    if (keep_mesh)
+    {
+        for (auto &elem : elements) elem.release(true);
+    }
+    else
+    {
+        std::vector<Element<DType>>().swap(elements);
     }
+}
 
-    DType *coordinates[] = { x.data(), y.data(), z.data() };
-    DBPutZonelist(silo_file, "elements", num_low_order_elems, dim, low_order_elements.data(), num_low_order_points, 0, &num_vertices, &num_low_order_elems, 1);
-    DBPutUcdmesh(silo_file, "mesh", dim, NULL, coordinates, num_points, num_low_order_elems, "elements", NULL, (typeid(DType) == typeid(double)) ? DB_DOUBLE : DB_FLOAT, NULL);
-    
-    // Fields
+// Visit output
+template<typename DType>
+void Subdomain<DType>::output(std::string output_name, int num_fields, ...)
+{
+    // Each rank writes its own block and rank 0 a multi-block index
+    silo_writer.wait();
+    silo_writer.clear();
+
+    // Mesh (coordinates do not change between outputs)
+    if (not silo_writer.has_mesh())
+        for (auto &elem : elements) silo_writer.add_element(elem.poly_degree, elem.x.data(), elem.y.data(), elem.z.data());
+
+    // Fields (only the device-to-host copies are synchronous)
+    int num_points = 0; for (auto &elem : elements) num_points += elem.num_points;
     char *field_name;
     occa::memory field_data;
 
@@ -4777,15 +6160,18 @@ void Subdomain<DType>::output(std::string output_name, int num_fields, ...)
         field_data = va_arg(args, occa::memory);
         field_data.copyTo(work_hst[0].data(), num_points * sizeof(DType));
 
+        silo_writer.add_field(field_name);
+
         for (auto &elem : elements)
+        {
             for (int vid = 0; vid < elem.num_points; vid++)
                 work_hst[1][elem.offset + vid] = work_hst[0][elem.loc_num[vid]];
 
-        DBPutUcdvar1(silo_file, field_name, "mesh", work_hst[1].data(), num_points, NULL, 0, (typeid(DType) == typeid(double)) ? DB_DOUBLE : DB_FLOAT, DB_NODECENT, NULL);
+            silo_writer.add_field_values(elem.poly_degree, work_hst[1].data() + elem.offset);
+        }
     }
 
     va_end(args);
 
-    // Free data
-    DBClose(silo_file);
+    silo_writer.write(output_name);
 }
@@ -0,0 +1,59 @@
+/*
+ * Subdomain group header file
+ */
+
+// Headers
+#include <memory>
+#include "config.hpp"
+#include "subdomain.hpp"
+#include "thread_pool.hpp"
+#include "timer.hpp"
+
+// Class declaration
+#ifndef SUBDOMAIN_GROUP_HPP
+#define SUBDOMAIN_GROUP_HPP
+
+template<typename DType>
+class Subdomain_Group
+{
+    private:
+        // Subdomains of this rank
+        std::vector<std::unique_ptr<Subdomain<DType>>> parts;
+        std::vector<int> task_order;
+
+        // Workers for the local solves
+        Thread_Pool<int> thread_pool;
+
+        void update_iterations();
+
+    public:
+        // Member variables
+        const char *data_type = (typeid(DType) == typeid(double)) ? "double" : "float";
+
+        // Constructor and destructor
+        template<typename PType>
+        Subdomain_Group(std::unordered_map<int, PType>&, int, int, int = 1, int = 1, int = 1, int = 1, int = SUBDOMAIN_PRECONDITIONER);
+        ~Subdomain_Group();
+
+        // Solver
+        int num_parts;
+        int num_iterations = 0;
+        DType tolerance;
+
+        // Inner iterations of every call (maximum over the parts)
+        std::vector<int> call_iterations;
+
+        // Member functions
+        void set_tolerance(DType);
+        void refresh_coefficients(DType, DType);
+        void flexible_conjugate_gradient(occa::memory&, occa::memory&);
+        void generalized_minimum_residual(occa::memory&, occa::memory&);
+
+        // Memory
+        void memory_usage();
+        void release_host_data(bool = false);
+};
+
+#include "subdomain_group.tpp"
+
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Subdomain group template file
+ */
+
+// Headers
+#include <algorithm>
+#include "subdomain_group.hpp"
+
+// Constructor and destructor
+template<typename DType>
+template<typename PType>
+Subdomain_Group<DType>::Subdomain_Group(std::unordered_map<int, PType> &domains, int poly_degree, int poly_reduction, int subdomain_overlap, int superdomain_overlap, int num_parts_, int num_threads, int local_preconditioner)
+{
+    // Every rank needs the same number of parts for the collective setup and tree exchanges
+    num_parts = std::max(num_parts_, 1);
+
+    int min_local_elements = domains[poly_degree].num_local_elements;
+    MPI_Allreduce(MPI_IN_PLACE, &min_local_elements, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+    if (min_local_elements < num_parts)
+    {
+        rstdout("ERROR: %d subdomains per rank requested but some rank only has %d elements\n", num_parts, min_local_elements);
+        quit();
+    }
+
+    for (int p = 0; p < num_parts; p++)
+    {
+        if (num_parts > 1) rstdout("- Subdomain part %d of %d\n", p + 1, num_parts);
+
+        // Parts run on different threads, so they must not share kernel objects
+        kernel_registry.scope = p;
+        parts.push_back(std::unique_ptr<Subdomain<DType>>(new Subdomain<DType>(domains, poly_degree, poly_reduction, subdomain_overlap, superdomain_overlap, p, num_parts, local_preconditioner)));
+    }
+
+    kernel_registry.scope = 0;
+
+    tolerance = parts[0]->tolerance;
+
+    // Largest subdomains first to shorten the tail of the concurrent phase
+    for (int p = 0; p < num_parts; p++) task_order.push_back(p);
+    std::stable_sort(task_order.begin(), task_order.end(), [&](int a, int b) { return parts[a]->num_values > parts[b]->num_values; });
+
+    if (num_parts > 1) thread_pool.initialize(std::min(num_threads, num_parts));
+}
+
+template<typename DType>
+Subdomain_Group<DType>::~Subdomain_Group()
+{
+
+}
+
+// Member functions
+template<typename DType>
+void Subdomain_Group<DType>::flexible_conjugate_gradient(occa::memory &u_l, occa::memory &f_l)
+{
+    if (num_parts == 1)
+    {
+        parts[0]->flexible_conjugate_gradient(u_l, f_l);
+        update_iterations();
+        return;
+    }
+
+    // Collect tree data (communication stays on this thread, in the same part order on every rank)
+    for (auto &part : parts) part->flexible_conjugate_gradient_tree(f_l);
+
+    // Local solves
+    timer.start("subdomain.concurrent_solve");
+    thread_pool.run(task_order, [&](int p) { parts[p]->flexible_conjugate_gradient_local(); });
+    timer.stop("subdomain.concurrent_solve");
+
+    // Subdomain solutions (each part owns a disjoint chunk of the local elements)
+    for (auto &part : parts) part->copy_solution(u_l);
+
+    update_iterations();
+}
+
+template<typename DType>
+void Subdomain_Group<DType>::generalized_minimum_residual(occa::memory &u_l, occa::memory &f_l)
+{
+    if (num_parts == 1)
+    {
+        parts[0]->generalized_minimum_residual(u_l, f_l);
+        update_iterations();
+        return;
+    }
+
+    // Collect tree data (communication stays on this thread, in the same part order on every rank)
+    for (auto &part : parts) part->generalized_minimum_residual_tree(f_l);
+
+    // Local solves
+    timer.start("subdomain.concurrent_solve");
+    thread_pool.run(task_order, [&](int p) { parts[p]->generalized_minimum_residual_local(); });
+    timer.stop("subdomain.concurrent_solve");
+
+    // Subdomain solutions (each part owns a disjoint chunk of the local elements)
+    for (auto &part : parts) part->copy_solution(u_l);
+
+    update_iterations();
+}
+
+template<typename DType>
+void Subdomain_Group<DType>::set_tolerance(DType part_tolerance)
+{
+    // 'tolerance' keeps the fixed value, only the parts see the per-call one
+    for (auto &part : parts) part->tolerance = part_tolerance;
+}
+
+template<typename DType>
+void Subdomain_Group<DType>::refresh_coefficients(DType h1, DType h2)
+{
+    for (auto &part : parts) part->refresh_coefficients(h1, h2);
+}
+
+template<typename DType>
+void Subdomain_Group<DType>::update_iterations()
+{
+    num_iterations = 0;
+    int last_iterations = 0;
+
+    for (auto &part : parts) num_iterations = std::max(num_iterations, part->num_iterations);
+    for (auto &part : parts) last_iterations = std::max(last_iterations, part->last_iterations);
+
+    call_iterations.push_back(last_iterations);
+}
+
+// Memory
+template<typename DType>
+void Subdomain_Group<DType>::memory_usage()
+{
+    for (auto &part : parts) part->memory_usage();
+}
+
+template<typename DType>
+void Subdomain_Group<DType>::release_host_data(bool keep_mesh)
+{
+    for (auto &part : parts) part->release_host_data(keep_mesh);
+}
@@ -0,0 +1,55 @@
+/*
+ * Thread pool class declaration
+ */
+
+// Headers
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+
+// Class definition
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+template<typename TType = int>
+class Thread_Pool
+{
+    private:
+        // Member variables
+        std::vector<std::thread> workers;
+        std::vector<std::deque<TType>> queues;
+        std::vector<std::unique_ptr<std::mutex>> queue_mutex;
+
+        std::function<void(TType)> task;
+        std::mutex pool_mutex;
+        std::condition_variable start_cv;
+        std::condition_variable done_cv;
+        int generation = 0;
+        int num_busy = 0;
+        bool shutdown = false;
+
+        // Utility functions
+        void worker_loop(int);
+        bool next_task(int, TType&);
+
+    public:
+        // Member variables
+        int num_threads = 0;
+
+        // Constructor
+        Thread_Pool();
+        ~Thread_Pool();
+
+        // Utility functions
+        void initialize(int);
+        void run(const std::vector<TType>&, std::function<void(TType)>);
+};
+
+#include "thread_pool.tpp"
+
+#endif
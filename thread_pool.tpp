@@ -0,0 +1,117 @@
+/*
+ * Thread pool definition
+ */
+
+// Headers
+#include "thread_pool.hpp"
+
+// Functions definition
+template<typename TType>
+Thread_Pool<TType>::Thread_Pool()
+{
+
+}
+
+template<typename TType>
+Thread_Pool<TType>::~Thread_Pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        shutdown = true;
+    }
+
+    start_cv.notify_all();
+
+    for (auto &worker : workers) worker.join();
+}
+
+template<typename TType>
+void Thread_Pool<TType>::initialize(int num_threads_)
+{
+    num_threads = std::max(num_threads_, 1);
+
+    queues.resize(num_threads);
+
+    for (int w = 0; w < num_threads; w++) queue_mutex.push_back(std::unique_ptr<std::mutex>(new std::mutex));
+    for (int w = 0; w < num_threads; w++) workers.push_back(std::thread(&Thread_Pool<TType>::worker_loop, this, w));
+}
+
+template<typename TType>
+void Thread_Pool<TType>::run(const std::vector<TType> &tasks, std::function<void(TType)> task_)
+{
+    // Deal tasks round-robin so every worker starts with the most expensive ones it owns
+    for (unsigned int t = 0; t < tasks.size(); t++) queues[t % num_threads].push_back(tasks[t]);
+
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        task = task_;
+        num_busy = num_threads;
+        generation++;
+    }
+
+    start_cv.notify_all();
+
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    done_cv.wait(lock, [&] { return num_busy == 0; });
+}
+
+template<typename TType>
+void Thread_Pool<TType>::worker_loop(int w)
+{
+    int seen_generation = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex);
+            start_cv.wait(lock, [&] { return shutdown or (generation != seen_generation); });
+
+            if (shutdown) return;
+
+            seen_generation = generation;
+        }
+
+        TType t;
+
+        while (next_task(w, t)) task(t);
+
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            num_busy--;
+        }
+
+        done_cv.notify_one();
+    }
+}
+
+template<typename TType>
+bool Thread_Pool<TType>::next_task(int w, TType &t)
+{
+    // Own queue from the front
+    {
+        std::lock_guard<std::mutex> lock(*queue_mutex[w]);
+
+        if (not queues[w].empty())
+        {
+            t = queues[w].front();
+            queues[w].pop_front();
+            return true;
+        }
+    }
+
+    // Steal from the back of the other queues
+    for (int s = 1; s < num_threads; s++)
+    {
+        int v = (w + s) % num_threads;
+        std::lock_guard<std::mutex> lock(*queue_mutex[v]);
+
+        if (not queues[v].empty())
+        {
+            t = queues[v].back();
+            queues[v].pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
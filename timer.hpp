@@ -6,8 +6,14 @@
 #include <chrono>
 #include <occa.hpp>
 #include <cstring>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 
+#if PERF_COUNTERS == 1
+#include "perf_counters.hpp"
+#endif
+
 // Class definition
 #ifndef TIMER_HPP
 #define TIMER_HPP
@@ -21,8 +27,19 @@ class Timer
         std::unordered_map<const char*, std::chrono::_V2::high_resolution_clock::time_point> t_stop;
         std::unordered_map<const char*, std::vector<DType>> t_total;
         DType t_sync;
+        std::thread::id t_owner;
+
+        // Worker threads: start times and totals per thread
+        std::unordered_map<std::thread::id, std::unordered_map<const char*, std::chrono::_V2::high_resolution_clock::time_point>> t_thread_start;
+        std::unordered_map<const char*, std::unordered_map<std::thread::id, DType>> t_thread_total;
+        std::mutex t_thread_mutex;
 
     public:
+#if PERF_COUNTERS == 1
+        // Member variables
+        Perf_Counters<long long> counters;
+#endif
+
         // Constructor
         Timer();
         ~Timer();
@@ -35,6 +52,8 @@ class Timer
         DType total(const char*);
         DType total(const char*, const char*);
         void total(const char*, std::string&);
+        DType thread_total(const char*, const char*);
+        std::vector<const char*> thread_regions();
 };
 
 #include "timer.tpp"
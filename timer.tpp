@@ -10,7 +10,7 @@
 template<typename DType>
 Timer<DType>::Timer()
 {
-
+    t_owner = std::this_thread::get_id();
 }
 
 template<typename DType>
@@ -47,15 +47,45 @@ void Timer<DType>::initialize()
 template<typename DType>
 void Timer<DType>::start(const char *name, bool global_synchronize)
 {
+    // Worker threads may not synchronize the device or call MPI, so they only keep their own wall time
+    if (std::this_thread::get_id() != t_owner)
+    {
+        std::lock_guard<std::mutex> lock(t_thread_mutex);
+        t_thread_start[std::this_thread::get_id()][name] = std::chrono::_V2::high_resolution_clock::now();
+
+        return;
+    }
+
     device.finish();
     if (global_synchronize) MPI_Barrier(MPI_COMM_WORLD);
     t_start[name] = std::chrono::_V2::high_resolution_clock::now();
+
+#if PERF_COUNTERS == 1
+    counters.start(name);
+#endif
 }
 
 template<typename DType>
 void Timer<DType>::stop(const char *name, bool global_synchronize)
 {
+    if (std::this_thread::get_id() != t_owner)
+    {
+        std::chrono::_V2::high_resolution_clock::time_point t_now = std::chrono::_V2::high_resolution_clock::now();
+
+        std::lock_guard<std::mutex> lock(t_thread_mutex);
+        std::chrono::duration<DType> t_elapsed = std::chrono::duration_cast<std::chrono::duration<DType>>(t_now - t_thread_start[std::this_thread::get_id()][name]);
+
+        t_thread_total[name][std::this_thread::get_id()] += t_elapsed.count();
+
+        return;
+    }
+
     device.finish();
+
+#if PERF_COUNTERS == 1
+    counters.stop(name);
+#endif
+
     t_stop[name] = std::chrono::_V2::high_resolution_clock::now();
 
     std::chrono::duration<DType> t_elapsed = std::chrono::duration_cast<std::chrono::duration<DType>>(t_stop[name] - t_start[name]);
@@ -72,6 +102,8 @@ void Timer<DType>::reset(const char *name)
 {
     for (int p = 0; p < num_procs; p++)
         t_total[name][p] = 0.0;
+
+    t_thread_total.erase(name);
 }
 
 template<typename DType>
@@ -123,3 +155,40 @@ void Timer<DType>::total(const char *name, std::string &output)
         output += word;
     }
 }
+
+/*
+ * Regions timed on worker threads, aggregated over the threads of this rank ("max" is the critical path, "sum" the busy time)
+ */
+template<typename DType>
+DType Timer<DType>::thread_total(const char *name, const char *type)
+{
+    DType t_max = 0.0;
+    DType t_sum = 0.0;
+
+    for (auto &thread : t_thread_total[name])
+    {
+        t_max = std::max(t_max, thread.second);
+        t_sum += thread.second;
+    }
+
+    if (!strcmp(type, "max"))
+        return t_max;
+    else if (!strcmp(type, "sum"))
+        return t_sum;
+    else if (!strcmp(type, "mean"))
+        return (t_thread_total[name].size() > 0) ? t_sum / (DType)(t_thread_total[name].size()) : 0.0;
+    else
+        return - 1.0;
+}
+
+template<typename DType>
+std::vector<const char*> Timer<DType>::thread_regions()
+{
+    std::vector<const char*> names;
+
+    for (auto &region : t_thread_total) names.push_back(region.first);
+
+    std::sort(names.begin(), names.end(), [](const char *a, const char *b) { return strcmp(a, b) < 0; });
+
+    return names;
+}
@@ -0,0 +1,48 @@
+/*
+ * Wire format header file
+ */
+
+// Headers
+#include <vector>
+#include "config.hpp"
+
+// Class declaration
+#ifndef WIRE_FORMAT_HPP
+#define WIRE_FORMAT_HPP
+
+// Reduced precision packing of a set of messages (float words, or 16-bit mantissas after one shared exponent per message)
+template<typename DType>
+class Wire_Format
+{
+    private:
+        std::vector<int> count;
+        std::vector<int> offset;
+        std::vector<char> buffer;
+
+        int word_size = sizeof(float);
+
+    public:
+        // Member variables
+        int mode = PRECONDITIONER_WIRE;
+        MPI_Datatype datatype = MPI_FLOAT;
+
+        std::vector<int> wire_count;
+        std::vector<int> wire_offset;
+
+        // Constructor and destructor
+        Wire_Format();
+        ~Wire_Format();
+
+        // Member functions
+        void setup(const std::vector<int>&, const std::vector<int>&);
+        void pack(const DType*);
+        void pack(const DType*, int);
+        void unpack(DType*);
+        void unpack(DType*, int);
+        char* data();
+        long long memory_usage();
+};
+
+#include "wire_format.tpp"
+
+#endif
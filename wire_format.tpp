@@ -0,0 +1,115 @@
+/*
+ * Wire format template file
+ */
+
+// Headers
+#include <cmath>
+#include <cstring>
+#include "wire_format.hpp"
+
+// Constructor and destructor
+template<typename DType>
+Wire_Format<DType>::Wire_Format()
+{
+
+}
+
+template<typename DType>
+Wire_Format<DType>::~Wire_Format()
+{
+
+}
+
+// Member functions
+template<typename DType>
+void Wire_Format<DType>::setup(const std::vector<int> &count_, const std::vector<int> &offset_)
+{
+    count = count_;
+    offset = offset_;
+
+    word_size = (mode == 2) ? sizeof(short) : sizeof(float);
+    datatype = (mode == 2) ? MPI_SHORT : MPI_FLOAT;
+
+    int num_messages = (int)(count.size());
+    int num_words = 0;
+
+    wire_count.resize(num_messages);
+    wire_offset.resize(num_messages);
+
+    for (int m = 0; m < num_messages; m++)
+    {
+        wire_count[m] = (mode == 2) ? count[m] + 1 : count[m];
+        wire_offset[m] = num_words;
+        num_words += wire_count[m];
+    }
+
+    buffer.resize((size_t)(num_words) * word_size);
+}
+
+template<typename DType>
+void Wire_Format<DType>::pack(const DType *u)
+{
+    for (int m = 0; m < (int)(count.size()); m++) pack(u, m);
+}
+
+template<typename DType>
+void Wire_Format<DType>::pack(const DType *u, int m)
+{
+    const DType *u_m = u + offset[m];
+
+    if (mode != 2)
+    {
+        float *wire = (float*)(buffer.data()) + wire_offset[m];
+        for (int i = 0; i < count[m]; i++) wire[i] = (float)(u_m[i]);
+
+        return;
+    }
+
+    // Exponent of the largest magnitude first, then mantissas scaled to 15 bits
+    short *wire = (short*)(buffer.data()) + wire_offset[m];
+    double max_value = 0.0;
+    int exponent = 0;
+
+    for (int i = 0; i < count[m]; i++) max_value = std::max(max_value, std::abs((double)(u_m[i])));
+    if (max_value > 0.0) std::frexp(max_value, &exponent);
+
+    wire[0] = (short)(exponent);
+    for (int i = 0; i < count[m]; i++) wire[i + 1] = (short)(std::lround(std::ldexp((double)(u_m[i]), 14 - exponent)));
+}
+
+template<typename DType>
+void Wire_Format<DType>::unpack(DType *u)
+{
+    for (int m = 0; m < (int)(count.size()); m++) unpack(u, m);
+}
+
+template<typename DType>
+void Wire_Format<DType>::unpack(DType *u, int m)
+{
+    DType *u_m = u + offset[m];
+
+    if (mode != 2)
+    {
+        const float *wire = (const float*)(buffer.data()) + wire_offset[m];
+        for (int i = 0; i < count[m]; i++) u_m[i] = (DType)(wire[i]);
+
+        return;
+    }
+
+    const short *wire = (const short*)(buffer.data()) + wire_offset[m];
+    int exponent = wire[0];
+
+    for (int i = 0; i < count[m]; i++) u_m[i] = (DType)(std::ldexp((double)(wire[i + 1]), exponent - 14));
+}
+
+template<typename DType>
+char* Wire_Format<DType>::data()
+{
+    return buffer.data();
+}
+
+template<typename DType>
+long long Wire_Format<DType>::memory_usage()
+{
+    return (long long)(buffer.size());
+}